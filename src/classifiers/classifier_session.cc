@@ -0,0 +1,121 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#include <classifiers/classifier_session.hh>
+
+#include <net/message_io.hh>
+#include <util/util.hh>
+
+void Classifier_Server_session::run_session()
+{
+    try {
+        exchange_keys();
+        setup_session();
+        
+        // main loop to catch requests
+        unsigned int n_queries = 0;
+        for (bool should_exit = false; !should_exit; ) {
+            Classifier_Request request = readMessageFromSocket<Classifier_Request>(socket_);
+            
+            switch (request.type()) {
+                case Classifier_Request_Request_Type_CLASSIFY:
+                    classify();
+                    n_queries++;
+                    break;
+                    
+                case Classifier_Request_Request_Type_CLASSIFY_BATCH:
+                    cout << id_ << ": Batch of " << request.batch_size() << " queries" << endl;
+                    classify_batch(request.batch_size());
+                    n_queries += request.batch_size();
+                    break;
+                    
+                case Classifier_Request_Request_Type_CLASSIFY_TOP_K:
+                    classify_top_k(request.top_k());
+                    n_queries++;
+                    break;
+                    
+                case Classifier_Request_Request_Type_DISCONNECT:
+                    should_exit = true;
+                    break;
+            }
+        }
+        cout << id_ << ": " << n_queries << " classifications" << endl;
+        
+    } catch (std::exception& e) {
+        std::cout << "Exception: " << e.what() << std::endl;
+    }
+}
+
+void Classifier_Server_session::classify_batch(size_t n_queries)
+{
+    for (size_t i = 0; i < n_queries; i++) {
+        classify();
+    }
+}
+
+void Classifier_Server_session::classify_top_k(size_t n_top)
+{
+    throw std::runtime_error("Top-k classification is not supported by this classifier");
+}
+
+
+Classifier_Client::Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, Key_dependencies_descriptor key_deps_desc, unsigned int keysize, unsigned int lambda)
+: Client(io_service,state,key_deps_desc,keysize,lambda), session_started_(false)
+{
+    
+}
+
+void Classifier_Client::start_session()
+{
+    if (session_started_) {
+        return;
+    }
+    
+    // get public keys
+    RESET_BYTE_COUNT
+    exchange_keys();
+    setup_session();
+#ifdef BENCHMARK
+    const double to_kB = 1 << 10;
+    cout << "Session setup: " <<  (IOBenchmark::byte_count()/to_kB) << " kB" << endl;
+    cout << IOBenchmark::interaction_count() << " interactions" << endl;
+#endif
+    session_started_ = true;
+}
+
+void Classifier_Client::disconnect()
+{
+    if (session_started_) {
+        send_classifier_request(Classifier_Request_Request_Type_DISCONNECT);
+        session_started_ = false;
+    }
+}
+
+void Classifier_Client::send_classifier_request(Classifier_Request_Request_Type type, size_t n)
+{
+    Classifier_Request request;
+    request.set_type(type);
+    if (type == Classifier_Request_Request_Type_CLASSIFY_BATCH) {
+        request.set_batch_size(n);
+    }else if (type == Classifier_Request_Request_Type_CLASSIFY_TOP_K) {
+        request.set_top_k(n);
+    }
+    sendMessageToSocket<Classifier_Request>(socket_,request);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#pragma once
+
+#include <mpc/lsic.hh>
+#include <mpc/private_comparison.hh>
+#include <mpc/enc_comparison.hh>
+#include <mpc/rev_enc_comparison.hh>
+#include <mpc/linear_enc_argmax.hh>
+#include <mpc/tree_enc_argmax.hh>
+
+#include <net/client.hh>
+#include <net/server.hh>
+
+#include <proto_src/classifier_requests.pb.h>
+
+// A session of a classifier server: after the key exchange (and the session
+// setup, e.g. sending the model), the client asks for as many classifications
+// as it wants, and ends the session with a DISCONNECT request.
+class Classifier_Server_session : public Server_session{
+public:
+    Classifier_Server_session(Server *server, gmp_randstate_t state, unsigned int id, tcp::socket &socket)
+    : Server_session(server,state,id,socket) {};
+    
+    void run_session();
+    
+protected:
+    // called once, after the key exchange
+    virtual void setup_session() {};
+    // serves a CLASSIFY request
+    virtual void classify() = 0;
+    // serves a CLASSIFY_BATCH request
+    // by default, the batch is served as n_queries classifications
+    virtual void classify_batch(size_t n_queries);
+    // serves a CLASSIFY_TOP_K request
+    // by default, the request is not supported and the session ends
+    virtual void classify_top_k(size_t n_top);
+};
+
+
+class Classifier_Client : public Client{
+public:
+    Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, Key_dependencies_descriptor key_deps_desc, unsigned int keysize, unsigned int lambda);
+    
+    // exchange the keys and setup the session, only the first time it is called
+    void start_session();
+    void disconnect();
+    
+protected:
+    // called once, after the key exchange
+    virtual void setup_session() {};
+    // n is the batch size for CLASSIFY_BATCH and the number of classes for CLASSIFY_TOP_K
+    void send_classifier_request(Classifier_Request_Request_Type type, size_t n = 0);
+    
+    bool session_started_;
+};
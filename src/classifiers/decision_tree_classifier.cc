@@ -72,79 +72,75 @@ Server_session* Decision_tree_Classifier_Server::create_new_server_session(tcp::
 //    delete this;
 //}
 
-void Decision_tree_Classifier_Server_session::run_session()
+void Decision_tree_Classifier_Server_session::setup_session()
 {
-    try {
-        exchange_keys();
-        
-        bool useShallowCircuit = true;
-        EncryptedArray ea(server_->fhe_context(), server_->fhe_G());
-
-        ScopedTimer *t;
-        RESET_BYTE_COUNT
-        RESET_BENCHMARK_TIMER
-
-        // get the query
-        vector<mpz_class> query;
-        query = read_int_array_from_socket(socket_);
-        
-        vector<pair <vector<long>,long> > criteria = tree_server_->criteria();
-
-        vector<mpz_class> node_values(tree_server_->n_variables());
-        
-        t = new ScopedTimer("Server: Compute dot product");
-        // compute all the dot products
-        for (size_t i = 0; i < node_values.size(); i++) {
-            node_values[i] = client_paillier_->dot_product(query, get<0>(criteria[i]));
-        }
-        delete t;
-
-        // compare
-        vector<mpz_class> c_b_gm(tree_server_->n_variables());
-        
-        t = new ScopedTimer("Server: Compare");
-        for (size_t i = 0; i < node_values.size(); i++) {
-            mpz_class c_treshold = client_paillier_->encrypt(get<1>(criteria[i]));
-            c_b_gm[i] = enc_comparison_enc_result(node_values[i],c_treshold,64,GC_PROTOCOL);
-        }
-        delete t;
-
-        // convert
-        vector<Ctxt> c_b_fhe;
-
-        t = new ScopedTimer("Server: Change encryption scheme");
-        for (size_t i = 0; i < node_values.size(); i++) {
-            // duplicate everything
-            vector<mpz_class> duplicates(ea.size(),c_b_gm[i]);
-            c_b_fhe.push_back(change_encryption_scheme(duplicates));
-        }
-        delete t;
-
-        // evaluate the polynomial
-
-        t = new ScopedTimer("Server: Evaluation");
-        Ctxt c_r = evalPoly_FHE(tree_server_->model_poly(), c_b_fhe,ea,useShallowCircuit);
-        delete t;
-        
-        // send the result back to the client
-        send_fhe_ctxt_to_socket(socket_, c_r);
+    ea_ = new EncryptedArray(server_->fhe_context(), server_->fhe_G());
+}
 
-#ifdef BENCHMARK
-        cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
-        cout << IOBenchmark::byte_count() << " exchanged bytes" << endl;
-        cout << IOBenchmark::interaction_count() << " interactions" << endl;
-#endif
+void Decision_tree_Classifier_Server_session::classify()
+{
+    bool useShallowCircuit = true;
+    const EncryptedArray &ea = *ea_;
 
-        
-    } catch (std::exception& e) {
-        std::cout << "Exception: " << e.what() << std::endl;
+    ScopedTimer *t;
+    RESET_BYTE_COUNT
+    RESET_BENCHMARK_TIMER
+
+    // get the query
+    vector<mpz_class> query;
+    query = read_int_array_from_socket(socket_);
+    
+    vector<pair <vector<long>,long> > criteria = tree_server_->criteria();
+
+    vector<mpz_class> node_values(tree_server_->n_variables());
+    
+    t = new ScopedTimer("Server: Compute dot product");
+    // compute all the dot products
+    for (size_t i = 0; i < node_values.size(); i++) {
+        node_values[i] = client_paillier_->dot_product(query, get<0>(criteria[i]));
     }
+    delete t;
+
+    // compare: all the nodes are evaluated in one batch
+    vector<mpz_class> c_b_gm;
+    vector<mpz_class> c_tresholds(node_values.size());
     
-    delete this;
+    t = new ScopedTimer("Server: Compare");
+    for (size_t i = 0; i < node_values.size(); i++) {
+        c_tresholds[i] = client_paillier_->encrypt(get<1>(criteria[i]));
+    }
+    c_b_gm = multiple_enc_comparison_enc_result(node_values,c_tresholds,64,ADAPTIVE_PROTOCOL);
+    delete t;
+
+    // convert
+    vector<Ctxt> c_b_fhe;
+
+    t = new ScopedTimer("Server: Change encryption scheme");
+    for (size_t i = 0; i < node_values.size(); i++) {
+        // duplicate everything
+        vector<mpz_class> duplicates(ea.size(),c_b_gm[i]);
+        c_b_fhe.push_back(change_encryption_scheme(duplicates));
+    }
+    delete t;
+
+    // evaluate the polynomial
+
+    t = new ScopedTimer("Server: Evaluation");
+    Ctxt c_r = evalPoly_FHE(tree_server_->model_poly(), c_b_fhe,ea,useShallowCircuit);
+    delete t;
+    
+    // send the result back to the client
+    send_fhe_ctxt_to_socket(socket_, c_r, compression_);
+
+#ifdef BENCHMARK
+    cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
+    cout << IOBenchmark::byte_count() << " exchanged bytes" << endl;
+    cout << IOBenchmark::interaction_count() << " interactions" << endl;
+#endif
 }
 
 Decision_tree_Classifier_Client::Decision_tree_Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, vector<long> &query, unsigned int n_nodes)
-: Client(io_service,state,Decision_tree_Classifier_Server::key_deps_descriptor(),keysize,0), query_(query), n_nodes_(n_nodes)
+: Classifier_Client(io_service,state,Decision_tree_Classifier_Server::key_deps_descriptor(),keysize,0), query_(query), n_nodes_(n_nodes)
 {
     
 }
@@ -185,13 +181,14 @@ Decision_tree_Classifier_Client::Decision_tree_Classifier_Client(boost::asio::io
 
 void Decision_tree_Classifier_Client::run()
 {
-    RESET_BYTE_COUNT
-    exchange_keys();
-#ifdef BENCHMARK
-    const double to_kB = 1 << 10;
-    cout << "Key exchange: " <<  (IOBenchmark::byte_count()/to_kB) << " kB" << endl;
-    cout << IOBenchmark::interaction_count() << " interactions" << endl;
-#endif
+    long v = classify(query_);
+    cout << "Classification result: " << v << endl;
+}
+
+long Decision_tree_Classifier_Client::classify(const vector<long> &query)
+{
+    start_session();
+    send_classifier_request(Classifier_Request_Request_Type_CLASSIFY);
 
     EncryptedArray ea(*fhe_context_, fhe_G_);
 
@@ -200,9 +197,9 @@ void Decision_tree_Classifier_Client::run()
     RESET_BENCHMARK_TIMER
 
     // send our query encrypted under paillier
-    vector<mpz_class> enc_query(query_.size());
-    for (size_t i = 0; i < query_.size(); i++) {
-        enc_query[i] = paillier_->encrypt(query_[i]);
+    vector<mpz_class> enc_query(query.size());
+    for (size_t i = 0; i < query.size(); i++) {
+        enc_query[i] = paillier_->encrypt(query[i]);
     }
     
     send_int_array_to_socket(socket_,enc_query);
@@ -211,10 +208,8 @@ void Decision_tree_Classifier_Client::run()
     
     t = new ScopedTimer("Client: Compute criteria");
 
-    for (unsigned int i = 0; i < n_nodes_; i++) {
-        // for now, do it over 64 bits
-        help_enc_comparison_enc_result(64, GC_PROTOCOL);
-    }
+    // for now, do it over 64 bits
+    multiple_help_enc_comparison_enc_result(n_nodes_, 64, ADAPTIVE_PROTOCOL);
     delete t;
 
     t = new ScopedTimer("Client: Change encryption scheme");
@@ -235,12 +230,11 @@ void Decision_tree_Classifier_Client::run()
     delete t;
 
 #ifdef BENCHMARK
+    const double to_kB = 1 << 10;
     cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
     cout << (IOBenchmark::byte_count()/to_kB) << " exchanged kB" << endl;
     cout << IOBenchmark::interaction_count() << " interactions" << endl;
 #endif
 
-    cout << "Classification result: " << v << endl;
+    return v;
 }
-
-
@@ -30,6 +30,7 @@
 
 #include <net/client.hh>
 #include <net/server.hh>
+#include <classifiers/classifier_session.hh>
 
 #include <tree/tree.hh>
 #include <tree/m_variate_poly.hh>
@@ -62,23 +63,29 @@ protected:
 };
 
 
-class  Decision_tree_Classifier_Server_session : public Server_session{
+class  Decision_tree_Classifier_Server_session : public Classifier_Server_session{
 public:
     
     Decision_tree_Classifier_Server_session(Decision_tree_Classifier_Server *server, gmp_randstate_t state, unsigned int id, tcp::socket &socket)
-    : Server_session(server,state,id,socket), tree_server_(server) {};
-    
-    void run_session();
+    : Classifier_Server_session(server,state,id,socket), tree_server_(server), ea_(NULL) {};
+    ~Decision_tree_Classifier_Server_session() { delete ea_; }
     
 protected:
+    void setup_session();
+    void classify();
+    
     Decision_tree_Classifier_Server *tree_server_;
+    EncryptedArray *ea_;
 };
 
-class Decision_tree_Classifier_Client : public Client{
+class Decision_tree_Classifier_Client : public Classifier_Client{
 public:
     Decision_tree_Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, vector<long> &query, unsigned int n_nodes);
     
+    // classify the query given to the constructor
     void run();
+    // can be called several times in the same session
+    long classify(const vector<long> &query);
     
 protected:
     vector<long> query_;
@@ -44,59 +44,70 @@ Server_session* Linear_Classifier_Server::create_new_server_session(tcp::socket
     return new Linear_Classifier_Server_session(this, rand_state_, n_clients_++, socket);
 }
 
-void Linear_Classifier_Server_session::run_session()
+void Linear_Classifier_Server_session::classify()
 {
-    try {
-        exchange_keys();
-        
-        ScopedTimer *t;
-        RESET_BYTE_COUNT
-        RESET_BENCHMARK_TIMER
+    ScopedTimer *t;
+    RESET_BYTE_COUNT
+    RESET_BENCHMARK_TIMER
 
-        t = new ScopedTimer("Server: Compute dot product");
-        help_compute_dot_product(linear_server_->enc_model(),true);
-        delete t;
-        
-        t = new ScopedTimer("Server: Compare enc data");
-        help_enc_comparison(linear_server_->bit_size(), GC_PROTOCOL);
-        delete t;
+    t = new ScopedTimer("Server: Compute dot product");
+    help_compute_dot_product(linear_server_->enc_model(),true);
+    delete t;
+    
+    t = new ScopedTimer("Server: Compare enc data");
+    help_enc_comparison(linear_server_->bit_size(), ADAPTIVE_PROTOCOL);
+    delete t;
 
 #ifdef BENCHMARK
-        cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
-        cout << IOBenchmark::byte_count() << " exchanged bytes" << endl;
-        cout << IOBenchmark::interaction_count() << " interactions" << endl;
+    cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
+    cout << IOBenchmark::byte_count() << " exchanged bytes" << endl;
+    cout << IOBenchmark::interaction_count() << " interactions" << endl;
 #endif
+}
+void Linear_Classifier_Server_session::classify_batch(size_t n_queries)
+{
+    ScopedTimer *t;
+    RESET_BYTE_COUNT
+    RESET_BENCHMARK_TIMER
 
-    } catch (std::exception& e) {
-        std::cout << "Exception: " << e.what() << std::endl;
-    }
+    t = new ScopedTimer("Server: Compute dot products");
+    help_compute_dot_product(linear_server_->enc_model(),true);
+    delete t;
     
-    delete this;
+    t = new ScopedTimer("Server: Compare enc data");
+    multiple_help_enc_comparison(n_queries, linear_server_->bit_size(), ADAPTIVE_PROTOCOL);
+    delete t;
+
+#ifdef BENCHMARK
+    cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
+    cout << IOBenchmark::byte_count() << " exchanged bytes" << endl;
+    cout << IOBenchmark::interaction_count() << " interactions" << endl;
+#endif
 }
 
 
 Linear_Classifier_Client::Linear_Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, unsigned int lambda, const vector<mpz_class> &vals, size_t bit_size)
-: Client(io_service,state,Linear_Classifier_Server::key_deps_descriptor(),keysize,lambda), bit_size_(bit_size),values_(vals)
+: Classifier_Client(io_service,state,Linear_Classifier_Server::key_deps_descriptor(),keysize,lambda), bit_size_(bit_size),values_(vals)
 {
     
 }
 
 bool Linear_Classifier_Client::run()
 {
-    // get public keys
-    RESET_BYTE_COUNT
-    exchange_keys();
-#ifdef BENCHMARK
-    const double to_kB = 1 << 10;
-    cout << "Key exchange: " <<  (IOBenchmark::byte_count()/to_kB) << " kB" << endl;
-    cout << IOBenchmark::interaction_count() << " interactions" << endl;
-#endif
+    start_session();
+    return classify(values_);
+}
+
+bool Linear_Classifier_Client::classify(const vector<mpz_class> &vals)
+{
+    start_session();
+    send_classifier_request(Classifier_Request_Request_Type_CLASSIFY);
     
     ScopedTimer *t;
     RESET_BYTE_COUNT
     RESET_BENCHMARK_TIMER
     // prepare data
-    vector <mpz_class> x = values_;
+    vector <mpz_class> x = vals;
     x.push_back(-1);
     
     t = new ScopedTimer("Client: Compute dot product");
@@ -107,15 +118,49 @@ bool Linear_Classifier_Client::run()
 
     t = new ScopedTimer("Client: Compare enc data");
     // build the comparator over encrypted data
-    bool result = enc_comparison(v,w,bit_size_,GC_PROTOCOL);
+    bool result = enc_comparison(v,w,bit_size_,ADAPTIVE_PROTOCOL);
     delete t;
 #ifdef BENCHMARK
+    const double to_kB = 1 << 10;
     cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
     cout << (IOBenchmark::byte_count()/to_kB) << " exchanged kB" << endl;
     cout << IOBenchmark::interaction_count() << " interactions" << endl;
 #endif
     return result;
 }
+vector<bool> Linear_Classifier_Client::classify_batch(const vector<vector<mpz_class>> &vals)
+{
+    start_session();
+    if (vals.empty()) {
+        return vector<bool>();
+    }
+    send_classifier_request(Classifier_Request_Request_Type_CLASSIFY_BATCH, vals.size());
+    
+    ScopedTimer *t;
+    RESET_BYTE_COUNT
+    RESET_BENCHMARK_TIMER
+    // prepare data
+    vector<vector<mpz_class>> xs(vals);
+    for (size_t i = 0; i < xs.size(); i++) {
+        xs[i].push_back(-1);
+    }
+    
+    t = new ScopedTimer("Client: Compute dot products");
+    vector<mpz_class> v = multiple_compute_dot_product(xs);
+    vector<mpz_class> w(v.size(), 1); // encryptions of 0
+    delete t;
+
+    t = new ScopedTimer("Client: Compare enc data");
+    vector<bool> results = multiple_enc_comparison(v,w,bit_size_,ADAPTIVE_PROTOCOL);
+    delete t;
+#ifdef BENCHMARK
+    const double to_kB = 1 << 10;
+    cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
+    cout << (IOBenchmark::byte_count()/to_kB) << " exchanged kB" << endl;
+    cout << IOBenchmark::interaction_count() << " interactions" << endl;
+#endif
+    return results;
+}
 
 
 Bench_Linear_Classifier_Server::Bench_Linear_Classifier_Server(gmp_randstate_t state, unsigned int keysize, unsigned int lambda, const vector<mpz_class> &model, size_t bit_size, unsigned int nRounds)
@@ -143,7 +188,7 @@ void Bench_Linear_Classifier_Server_session::run_session()
             
             help_compute_dot_product(linear_server_->enc_model(),true);
             
-            help_enc_comparison(linear_server_->bit_size(), GC_PROTOCOL);
+            help_enc_comparison(linear_server_->bit_size(), ADAPTIVE_PROTOCOL);
             
             server_time += GET_BENCHMARK_TIME;
 //            cout << "Round #" << i << " done" << endl;
@@ -156,8 +201,6 @@ void Bench_Linear_Classifier_Server_session::run_session()
     } catch (std::exception& e) {
         std::cout << "Exception: " << e.what() << std::endl;
     }
-    
-    delete this;
 }
 
 
@@ -198,7 +241,7 @@ void Bench_Linear_Classifier_Client::run()
         
         dot_prod_time += t.lap_ms();
         // build the comparator over encrypted data
-        bool result = enc_comparison(v,w,bit_size_,GC_PROTOCOL);
+        bool result = enc_comparison(v,w,bit_size_,ADAPTIVE_PROTOCOL);
         compare_time += t.lap_ms();
 
         client_time += GET_BENCHMARK_TIME;
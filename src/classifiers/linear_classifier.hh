@@ -30,6 +30,7 @@
 
 #include <net/client.hh>
 #include <net/server.hh>
+#include <classifiers/classifier_session.hh>
 
 using namespace std;
 
@@ -53,24 +54,30 @@ class  Linear_Classifier_Server : public Server{
 };
 
 
-class  Linear_Classifier_Server_session : public Server_session{
+class  Linear_Classifier_Server_session : public Classifier_Server_session{
     public:
     
     Linear_Classifier_Server_session(Linear_Classifier_Server *server, gmp_randstate_t state, unsigned int id, tcp::socket &socket)
-    : Server_session(server,state,id,socket), linear_server_(server) {};
-    
-    void run_session();
+    : Classifier_Server_session(server,state,id,socket), linear_server_(server) {};
     
     protected:
+    void classify();
+    // the model is sent once and all the comparisons are run together
+    void classify_batch(size_t n_queries);
+    
     Linear_Classifier_Server *linear_server_;
 };
 
 
-class Linear_Classifier_Client : public Client{
+class Linear_Classifier_Client : public Classifier_Client{
 public:
     Linear_Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, unsigned int lambda, const vector<mpz_class> &vals, size_t bit_size);
 
+    // classify the values given to the constructor
     bool run();
+    // can be called several times in the same session
+    bool classify(const vector<mpz_class> &vals);
+    vector<bool> classify_batch(const vector<vector<mpz_class>> &vals);
     
 protected:
     size_t bit_size_;
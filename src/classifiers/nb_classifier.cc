@@ -29,8 +29,9 @@
 #include <protobuf/protobuf_conversion.hh>
 #include <net/message_io.hh>
 #include <util/util.hh>
+#include <util/threadpool.hh>
 
-static const COMPARISON_PROTOCOL comparison_prot__ = GC_PROTOCOL;
+static const COMPARISON_PROTOCOL comparison_prot__ = ADAPTIVE_PROTOCOL;
 
 Naive_Bayes_Classifier_Server::Naive_Bayes_Classifier_Server(gmp_randstate_t state, unsigned int keysize, unsigned int lambda, const vector<vector<vector<double>>> &conditionals_vec, const vector<double> &prior_vec)
 : Server(state, Naive_Bayes_Classifier_Server::key_deps_descriptor(), keysize, lambda)
@@ -116,82 +117,127 @@ Server_session* Naive_Bayes_Classifier_Server::create_new_server_session(tcp::so
     return new Naive_Bayes_Classifier_Server_session(this, rand_state_, n_clients_++, socket);
 }
 
-void Naive_Bayes_Classifier_Server_session::run_session()
+void Naive_Bayes_Classifier_Server_session::setup_session()
 {
-    try {
-        exchange_keys();
-        
-        ScopedTimer *t;
-        RESET_BYTE_COUNT
-        RESET_BENCHMARK_TIMER
+    ScopedTimer t("Server: Send model");
 
-        // send the encrypted probabilities
-        Protobuf::BigIntArray prior_prob_message = convert_to_message(nb_server_->enc_prior_prob());
-        sendMessageToSocket(socket_, prior_prob_message);
+    // send the encrypted probabilities
+    Protobuf::BigIntArray prior_prob_message = convert_to_message(nb_server_->enc_prior_prob());
+    sendMessageToSocket(socket_, prior_prob_message);
 
-        Protobuf::BigIntMatrix_Collection cond_prob_message = convert_to_message(nb_server_->enc_cond_prob());
-        sendMessageToSocket(socket_, cond_prob_message);
-        
-        // help for the encrypted argmax
-        unsigned int cat_count = nb_server_->categories_count();
-        cout << "Categories count " << cat_count << endl;
-        
-        unsigned int features_count = nb_server_->features_count();
-        
-        Tree_EncArgmax_Helper helper(54+cat_count,cat_count,server_->paillier());
+    Protobuf::BigIntMatrix_Collection cond_prob_message = convert_to_message(nb_server_->enc_cond_prob());
+    sendMessageToSocket(socket_, cond_prob_message);
+}
+
+void Naive_Bayes_Classifier_Server_session::classify()
+{
+    RESET_BYTE_COUNT
+    RESET_BENCHMARK_TIMER
+
+    // help for the encrypted argmax
+    unsigned int cat_count = nb_server_->categories_count();
+    cout << "Categories count " << cat_count << endl;
+    
+    unsigned int features_count = nb_server_->features_count();
+    
+    if (cat_count <= CONSTANT_ROUND_ARGMAX_MAX_CATEGORIES) {
+        run_enc_argmax(cat_count,54+cat_count,comparison_prot__);
+    }else{
+        Tree_EncArgmax_Helper helper(54+cat_count,cat_count,server_->paillier(),server_->paillier_constants());
         run_tree_enc_argmax(helper,comparison_prot__);
-        
-//        Linear_EncArgmax_Helper helper(54+features_count,cat_count,server_->paillier());
-//        run_linear_enc_argmax(helper,comparison_prot__);
-        
+    }
+    
+//    Linear_EncArgmax_Helper helper(54+features_count,cat_count,server_->paillier());
+//    run_linear_enc_argmax(helper,comparison_prot__);
+    
 #ifdef BENCHMARK
-        cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
-        cout << IOBenchmark::byte_count() << " exchanged bytes" << endl;
-        cout << IOBenchmark::interaction_count() << " interactions" << endl;
+    cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
+    cout << IOBenchmark::byte_count() << " exchanged bytes" << endl;
+    cout << IOBenchmark::interaction_count() << " interactions" << endl;
 #endif
+}
+void Naive_Bayes_Classifier_Server_session::classify_batch(size_t n_queries)
+{
+    RESET_BYTE_COUNT
+    RESET_BENCHMARK_TIMER
 
-    } catch (std::exception& e) {
-        std::cout << "Exception: " << e.what() << std::endl;
+    unsigned int cat_count = nb_server_->categories_count();
+    vector<Tree_EncArgmax_Helper*> helpers(n_queries);
+    for (size_t i = 0; i < n_queries; i++) {
+        helpers[i] = new Tree_EncArgmax_Helper(54+cat_count,cat_count,server_->paillier(),server_->paillier_constants());
     }
     
-    delete this;
-}
-
-
-Naive_Bayes_Classifier_Client::Naive_Bayes_Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, unsigned int lambda, const vector<unsigned int> &features_value)
-: Client(io_service,state,Naive_Bayes_Classifier_Server::key_deps_descriptor(),keysize,lambda), features_value_(features_value)
-{
+    multiple_run_tree_enc_argmax(helpers,comparison_prot__);
+    
+    for (size_t i = 0; i < n_queries; i++) {
+        delete helpers[i];
+    }
     
+#ifdef BENCHMARK
+    cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
+    cout << IOBenchmark::byte_count() << " exchanged bytes" << endl;
+    cout << IOBenchmark::interaction_count() << " interactions" << endl;
+#endif
 }
 
-bool Naive_Bayes_Classifier_Client::run()
+void Naive_Bayes_Classifier_Server_session::classify_top_k(size_t n_top)
 {
-    // get public keys
     RESET_BYTE_COUNT
-    exchange_keys();
+    RESET_BENCHMARK_TIMER
+
+    unsigned int cat_count = nb_server_->categories_count();
+    if (n_top == 0 || n_top > cat_count) {
+        throw std::runtime_error("Invalid number of categories");
+    }
+    
+    run_enc_top_k(cat_count,54+cat_count,n_top,comparison_prot__);
+    
 #ifdef BENCHMARK
-    const double to_kB = 1 << 10;
-    cout << "Key exchange: " <<  (IOBenchmark::byte_count()/to_kB) << " kB" << endl;
+    cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
+    cout << IOBenchmark::byte_count() << " exchanged bytes" << endl;
     cout << IOBenchmark::interaction_count() << " interactions" << endl;
 #endif
+}
+
+
+Naive_Bayes_Classifier_Client::Naive_Bayes_Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, unsigned int lambda, const vector<unsigned int> &features_value)
+: Classifier_Client(io_service,state,Naive_Bayes_Classifier_Server::key_deps_descriptor(),keysize,lambda), features_value_(features_value)
+{
     
-    ScopedTimer *t;
-    RESET_BYTE_COUNT
-    RESET_BENCHMARK_TIMER
-    
+}
+
+void Naive_Bayes_Classifier_Client::setup_session()
+{
     // get the prior and the conditionnal probabilities
-    t = new ScopedTimer("Model transmission");
+    ScopedTimer t("Model transmission");
     enc_prior_vec_ = convert_from_message(readMessageFromSocket<Protobuf::BigIntArray>(socket_));
     enc_conditionals_vec_ = convert_from_message(readMessageFromSocket<Protobuf::BigIntMatrix_Collection>(socket_));
-    delete t;
+}
+
+bool Naive_Bayes_Classifier_Client::run()
+{
+    start_session();
     
     if (features_value_.size() == 0) {
         generate_random_feature_values();
     }
     
+    classify(features_value_);
+    return true;
+}
+
+size_t Naive_Bayes_Classifier_Client::classify(const vector<unsigned int> &features_value)
+{
+    start_session();
+    send_classifier_request(Classifier_Request_Request_Type_CLASSIFY);
+    
+    ScopedTimer *t;
+    RESET_BYTE_COUNT
+    RESET_BENCHMARK_TIMER
+    
     t = new ScopedTimer("Prob computation");
     
-    vector<mpz_class> cat_prob = cat_probabilities();
+    vector<mpz_class> cat_prob = cat_probabilities(features_value);
 
     delete t;
     
@@ -200,20 +246,101 @@ bool Naive_Bayes_Classifier_Client::run()
     unsigned int cat_count = cat_prob.size();
     t = new ScopedTimer("Argmax");
     
-    Tree_EncArgmax_Owner owner(cat_prob,54+cat_count,*server_paillier_,rand_state_, lambda_);
-    run_tree_enc_argmax(owner,comparison_prot__);
+    size_t category;
+    if (cat_count <= CONSTANT_ROUND_ARGMAX_MAX_CATEGORIES) {
+        category = run_enc_argmax(cat_prob,54+cat_count,comparison_prot__);
+    }else{
+        Tree_EncArgmax_Owner owner(cat_prob,54+cat_count,*server_paillier_,rand_state_, lambda_);
+        category = run_tree_enc_argmax(owner,comparison_prot__);
+    }
 
 //    Linear_EncArgmax_Owner owner(cat_prob,54+features_count,*server_paillier_,rand_state_, lambda_);
-//    run_linear_enc_argmax(owner,comparison_prot__);
+//    size_t category = run_linear_enc_argmax(owner,comparison_prot__);
 
     delete t;
     
 #ifdef BENCHMARK
+    const double to_kB = 1 << 10;
     cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
     cout << (IOBenchmark::byte_count()/to_kB) << " exchanged kB" << endl;
     cout << IOBenchmark::interaction_count() << " interactions" << endl;
 #endif
-    return true;
+    return category;
+}
+
+vector<size_t> Naive_Bayes_Classifier_Client::classify_batch(const vector<vector<unsigned int>> &features_values)
+{
+    start_session();
+    if (features_values.empty()) {
+        return vector<size_t>();
+    }
+    send_classifier_request(Classifier_Request_Request_Type_CLASSIFY_BATCH, features_values.size());
+    
+    ScopedTimer *t;
+    RESET_BYTE_COUNT
+    RESET_BENCHMARK_TIMER
+    
+    size_t n = features_values.size();
+    vector<vector<mpz_class>> cat_probs(n);
+
+    t = new ScopedTimer("Prob computation");
+    ThreadPool::shared().parallel_for(0, n, [this,&cat_probs,&features_values](size_t i)
+                                      {
+                                          cat_probs[i] = cat_probabilities(features_values[i]);
+                                      }, n_threads_);
+    delete t;
+    
+    unsigned int cat_count = cat_probs[0].size();
+    t = new ScopedTimer("Argmax");
+    
+    vector<Tree_EncArgmax_Owner*> owners(n);
+    for (size_t i = 0; i < n; i++) {
+        owners[i] = new Tree_EncArgmax_Owner(cat_probs[i],54+cat_count,*server_paillier_,rand_state_, lambda_);
+    }
+    
+    vector<size_t> categories = multiple_run_tree_enc_argmax(owners,comparison_prot__);
+    
+    for (size_t i = 0; i < n; i++) {
+        delete owners[i];
+    }
+    delete t;
+    
+#ifdef BENCHMARK
+    const double to_kB = 1 << 10;
+    cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
+    cout << (IOBenchmark::byte_count()/to_kB) << " exchanged kB" << endl;
+    cout << IOBenchmark::interaction_count() << " interactions" << endl;
+#endif
+    return categories;
+}
+
+vector<size_t> Naive_Bayes_Classifier_Client::classify_top_k(const vector<unsigned int> &features_value, size_t n_top)
+{
+    start_session();
+    send_classifier_request(Classifier_Request_Request_Type_CLASSIFY_TOP_K, n_top);
+    
+    ScopedTimer *t;
+    RESET_BYTE_COUNT
+    RESET_BENCHMARK_TIMER
+    
+    t = new ScopedTimer("Prob computation");
+    vector<mpz_class> cat_prob = cat_probabilities(features_value);
+    delete t;
+    
+    unsigned int cat_count = cat_prob.size();
+    t = new ScopedTimer("Top-k");
+    
+    vector<size_t> categories = run_enc_top_k(cat_prob,54+cat_count,n_top,comparison_prot__);
+    
+    delete t;
+    
+#ifdef BENCHMARK
+    const double to_kB = 1 << 10;
+    cout << "Benchmark: " << GET_BENCHMARK_TIME << " ms" << endl;
+    cout << (IOBenchmark::byte_count()/to_kB) << " exchanged kB" << endl;
+    cout << IOBenchmark::interaction_count() << " interactions" << endl;
+#endif
+    return categories;
 }
 
 void Naive_Bayes_Classifier_Client::generate_random_feature_values()
@@ -228,7 +355,7 @@ void Naive_Bayes_Classifier_Client::generate_random_feature_values()
     }
 }
 
-vector<mpz_class> Naive_Bayes_Classifier_Client::cat_probabilities() const
+vector<mpz_class> Naive_Bayes_Classifier_Client::cat_probabilities(const vector<unsigned int> &features_value) const
 {
     // for each category, compute the probabily to be in this category given the features values
     
@@ -240,7 +367,7 @@ vector<mpz_class> Naive_Bayes_Classifier_Client::cat_probabilities() const
         for (size_t j = 0; j < enc_conditionals_vec_[0].size(); j++) {
             // loop over features
             
-            unsigned int val = features_value_[j];
+            unsigned int val = features_value[j];
             // cat_prob[i] = cat_prob[i] + enc_prior_vec_[i][j][val]
             cat_prob[i] = server_paillier_->add(cat_prob[i],enc_conditionals_vec_[i][j][val]);
         }
@@ -30,9 +30,14 @@
 
 #include <net/client.hh>
 #include <net/server.hh>
+#include <classifiers/classifier_session.hh>
 
 using namespace std;
 
+// up to this number of categories, the argmax compares all the pairs in one round
+// instead of running the tree argmax
+#define CONSTANT_ROUND_ARGMAX_MAX_CATEGORIES 6
+
 class  Naive_Bayes_Classifier_Server : public Server{
     public:
     Naive_Bayes_Classifier_Server(gmp_randstate_t state, unsigned int keysize, unsigned int lambda, const vector<vector<vector<double>>> &conditionals_vec, const vector<double> &prior_vec);
@@ -60,28 +65,42 @@ class  Naive_Bayes_Classifier_Server : public Server{
 };
 
 
-class  Naive_Bayes_Classifier_Server_session : public Server_session{
+class  Naive_Bayes_Classifier_Server_session : public Classifier_Server_session{
     public:
     
     Naive_Bayes_Classifier_Server_session(Naive_Bayes_Classifier_Server *server, gmp_randstate_t state, unsigned int id, tcp::socket &socket)
-    : Server_session(server,state,id,socket), nb_server_(server) {};
-    
-    void run_session();
+    : Classifier_Server_session(server,state,id,socket), nb_server_(server) {};
     
     protected:
+    // the encrypted model is sent once per session
+    void setup_session();
+    void classify();
+    // the comparisons of the rounds of all the argmax are run together
+    void classify_batch(size_t n_queries);
+    void classify_top_k(size_t n_top);
+    
     Naive_Bayes_Classifier_Server *nb_server_;
 };
 
 
-class Naive_Bayes_Classifier_Client : public Client{
+class Naive_Bayes_Classifier_Client : public Classifier_Client{
 public:
     Naive_Bayes_Classifier_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, unsigned int lambda, const vector<unsigned int> &features_value);
 
+    // classify the features given to the constructor (random ones if empty)
     bool run();
-    vector<mpz_class> cat_probabilities() const;
+    // can be called several times in the same session, the model is only received once
+    // returns the category
+    size_t classify(const vector<unsigned int> &features_value);
+    vector<size_t> classify_batch(const vector<vector<unsigned int>> &features_values);
+    // returns the n_top most likely categories, the most likely first
+    vector<size_t> classify_top_k(const vector<unsigned int> &features_value, size_t n_top);
+    vector<mpz_class> cat_probabilities(const vector<unsigned int> &features_value) const;
     void generate_random_feature_values();
 
 protected:
+    void setup_session();
+
     size_t bit_size_;
     
     vector<unsigned int> features_value_;
@@ -63,7 +63,7 @@ static void test_linear_classifier_client(const string &hostname, unsigned int m
         
         bool result = client.run();
         
-//        client.disconnect();
+        client.disconnect();
         
         cout << "Result : " << result << endl;
     }
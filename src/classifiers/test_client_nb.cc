@@ -81,7 +81,7 @@ static void test_nb_classifier_client(const string &hostname)
         
         client.run();
         
-//        client.disconnect();
+        client.disconnect();
         
     }
     catch (std::exception& e)
@@ -89,7 +89,7 @@ static void test_tree_classifier_client(const string &hostname)
         
         client.run();
         
-//        client.disconnect();
+        client.disconnect();
         
     }
     catch (std::exception& e)
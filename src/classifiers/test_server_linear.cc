@@ -96,7 +96,7 @@ static void bench_linear_classifier_server(const vector<mpz_class> &model, unsig
     
     cout << "Init server" << endl;
     Bench_Linear_Classifier_Server server(randstate,1024,100,model,nbits_max, nRounds);
-    server.set_threads_per_session(2);
+    server.set_crypto_thread_budget(2);
     
     cout << "Start server" << endl;
     server.run();
@@ -93,6 +93,8 @@ class Paillier_priv : public Paillier {
 class Paillier_priv_fast : public Paillier_priv {
 public:
     Paillier_priv_fast(const std::vector<mpz_class> &sk, gmp_randstate_t state);
+    // same format as the constructor's
+    std::vector<mpz_class> privkey() const { return { p, q, g, g_star_ }; }
     void precompute_powers();
     mpz_class compute_g_star_power(const mpz_class &x);
     static std::vector<mpz_class> keygen(gmp_randstate_t state, uint nbits = 1024);
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#include <assert.h>
+#include <crypto/paillier_pool.hh>
+#include <util/threadpool.hh>
+
+using namespace std;
+
+// encryptions computed by a refill task before it gives the worker back
+#define REFILL_BATCH_SIZE 16
+
+Paillier_constants_pool::Paillier_constants_pool(const vector<mpz_class> &pk, gmp_randstate_t state, size_t capacity, size_t low_watermark)
+: capacity_(capacity), low_watermark_(min(low_watermark, capacity)), paillier_(NULL), refilling_(false), done_(false)
+{
+    assert(capacity_ > 0);
+
+    // the pool must not reuse the randomness of the caller's state
+    mpz_class seed;
+    mpz_urandomb(seed.get_mpz_t(), state, 256);
+
+    gmp_randstate_t pool_state;
+    gmp_randinit_default(pool_state);
+    gmp_randseed(pool_state, seed.get_mpz_t());
+    paillier_ = new Paillier(pk, pool_state);
+    gmp_randclear(pool_state);
+
+    // seeds of the callers' encryptions when a stock is empty
+    mpz_urandomb(seed.get_mpz_t(), state, 256);
+    gmp_randinit_default(seed_state_);
+    gmp_randseed(seed_state_, seed.get_mpz_t());
+
+    lock_guard<mutex> lock(mtx_);
+    schedule_refill();
+}
+
+Paillier_constants_pool::~Paillier_constants_pool()
+{
+    future<void> refill;
+    {
+        lock_guard<mutex> lock(mtx_);
+        done_ = true;
+        refill = move(refill_);
+    }
+    if (refill.valid()) {
+        ThreadPool::shared().wait(refill);
+    }
+
+    delete paillier_;
+    gmp_randclear(seed_state_);
+}
+
+vector<mpz_class> Paillier_constants_pool::zeros(size_t n)
+{
+    return take(zeros_, 0, n);
+}
+
+vector<mpz_class> Paillier_constants_pool::ones(size_t n)
+{
+    return take(ones_, 1, n);
+}
+
+size_t Paillier_constants_pool::available_zeros() const
+{
+    lock_guard<mutex> lock(mtx_);
+    return zeros_.size();
+}
+
+size_t Paillier_constants_pool::available_ones() const
+{
+    lock_guard<mutex> lock(mtx_);
+    return ones_.size();
+}
+
+vector<mpz_class> Paillier_constants_pool::take(deque<mpz_class> &stock, long constant, size_t n)
+{
+    vector<mpz_class> res;
+    res.reserve(n);
+    mpz_class seed;
+
+    {
+        lock_guard<mutex> lock(mtx_);
+        while (res.size() < n && !stock.empty()) {
+            res.push_back(stock.front());
+            stock.pop_front();
+        }
+        schedule_refill();
+
+        if (res.size() < n) {
+            mpz_urandomb(seed.get_mpz_t(), seed_state_, 256);
+        }
+    }
+
+    // the stock is empty: compute the others here, without waiting for the refill
+    if (res.size() < n) {
+        generate_unshared(constant, n - res.size(), seed, res);
+    }
+
+    return res;
+}
+
+void Paillier_constants_pool::generate_unshared(long constant, size_t n, const mpz_class &seed, vector<mpz_class> &out)
+{
+    gmp_randstate_t state;
+    gmp_randinit_default(state);
+    gmp_randseed(state, seed.get_mpz_t());
+    Paillier paillier(paillier_->pubkey(), state);
+    gmp_randclear(state);
+
+    for (size_t i = 0; i < n; i++) {
+        out.push_back(paillier.encrypt(constant));
+    }
+}
+
+void Paillier_constants_pool::generate(long constant, size_t n, vector<mpz_class> &out)
+{
+    lock_guard<mutex> lock(gen_mtx_);
+    for (size_t i = 0; i < n; i++) {
+        out.push_back(paillier_->encrypt(constant));
+    }
+}
+
+void Paillier_constants_pool::store(deque<mpz_class> &stock, const vector<mpz_class> &batch)
+{
+    // fill() and a refill task can run at the same time: drop what does not fit
+    size_t n = min(batch.size(), capacity_ - min(stock.size(), capacity_));
+    stock.insert(stock.end(), batch.begin(), batch.begin() + n);
+}
+
+void Paillier_constants_pool::fill()
+{
+    for (;;) {
+        size_t missing_zeros, missing_ones;
+        {
+            lock_guard<mutex> lock(mtx_);
+            missing_zeros = capacity_ - min(zeros_.size(), capacity_);
+            missing_ones = capacity_ - min(ones_.size(), capacity_);
+        }
+        if (missing_zeros == 0 && missing_ones == 0) {
+            return;
+        }
+
+        vector<mpz_class> z, o;
+        generate(0, missing_zeros, z);
+        generate(1, missing_ones, o);
+
+        lock_guard<mutex> lock(mtx_);
+        store(zeros_, z);
+        store(ones_, o);
+    }
+}
+
+void Paillier_constants_pool::schedule_refill()
+{
+    if (refilling_ || done_) {
+        return;
+    }
+    if (zeros_.size() >= low_watermark_ && ones_.size() >= low_watermark_) {
+        return;
+    }
+
+    refilling_ = true;
+    refill_ = ThreadPool::shared().submit([this](){ refill_step(); });
+}
+
+void Paillier_constants_pool::refill_step()
+{
+    long constant;
+    {
+        lock_guard<mutex> lock(mtx_);
+        if (done_ || (zeros_.size() >= capacity_ && ones_.size() >= capacity_)) {
+            refilling_ = false;
+            return;
+        }
+        // refill the smallest stock first
+        constant = (zeros_.size() <= ones_.size()) ? 0 : 1;
+    }
+
+    vector<mpz_class> batch;
+    generate(constant, REFILL_BATCH_SIZE, batch);
+
+    lock_guard<mutex> lock(mtx_);
+    store((constant == 0) ? zeros_ : ones_, batch);
+
+    // give the worker back between the batches
+    if (done_) {
+        refilling_ = false;
+    } else {
+        refill_ = ThreadPool::shared().submit([this](){ refill_step(); });
+    }
+}
+
+vector<mpz_class> parallel_encrypt(const Paillier &p, const vector<mpz_class> &plaintexts, gmp_randstate_t state, unsigned int n_threads)
+{
+    size_t n = plaintexts.size();
+    size_t n_tasks = max<size_t>(1, min<size_t>(n_threads, n));
+    vector<mpz_class> ciphertexts(n);
+
+    // the seeds are drawn here: state is only used by the calling thread
+    vector<mpz_class> seeds(n_tasks);
+    for (size_t t = 0; t < n_tasks; t++) {
+        mpz_urandomb(seeds[t].get_mpz_t(), state, 256);
+    }
+
+    auto encrypt_range = [&p,&plaintexts,&ciphertexts,&seeds,n,n_tasks](size_t t)
+    {
+        gmp_randstate_t task_state;
+        gmp_randinit_default(task_state);
+        gmp_randseed(task_state, seeds[t].get_mpz_t());
+        Paillier task_paillier(p.pubkey(), task_state);
+        gmp_randclear(task_state);
+
+        for (size_t i = t*n/n_tasks; i < (t+1)*n/n_tasks; i++) {
+            ciphertexts[i] = task_paillier.encrypt(plaintexts[i]);
+        }
+    };
+
+    ThreadPool::shared().parallel_for(0, n_tasks, encrypt_range, n_tasks);
+
+    return ciphertexts;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <future>
+#include <crypto/paillier.hh>
+
+// Fresh encryptions of 0 and 1, computed in advance.
+// When one of the two stocks goes below low_watermark, it is refilled up to
+// capacity by tasks of the shared thread pool. If a stock is empty, the
+// missing encryptions are computed by the caller, with its own copy of the
+// key: it never waits for the refill.
+// The pool can be shared between threads: every encryption is given once.
+class Paillier_constants_pool {
+public:
+    Paillier_constants_pool(const std::vector<mpz_class> &pk, gmp_randstate_t state, size_t capacity = 256, size_t low_watermark = 128);
+    // waits for the running refill
+    ~Paillier_constants_pool();
+
+    Paillier_constants_pool(const Paillier_constants_pool&) = delete;
+    Paillier_constants_pool &operator=(const Paillier_constants_pool &) = delete;
+
+    mpz_class zero() { return zeros(1)[0]; }
+    mpz_class one() { return ones(1)[0]; }
+    std::vector<mpz_class> zeros(size_t n);
+    std::vector<mpz_class> ones(size_t n);
+
+    // fills the pool up to capacity, from the calling thread
+    void fill();
+
+    size_t available_zeros() const;
+    size_t available_ones() const;
+    size_t capacity() const { return capacity_; }
+
+protected:
+    std::vector<mpz_class> take(std::deque<mpz_class> &stock, long constant, size_t n);
+    // appends n encryptions of the constant to out
+    void generate(long constant, size_t n, std::vector<mpz_class> &out);
+    // same, with a copy of the key and a random state seeded with seed: does not wait for gen_mtx_
+    void generate_unshared(long constant, size_t n, const mpz_class &seed, std::vector<mpz_class> &out);
+
+    // must be called with mtx_ locked
+    void store(std::deque<mpz_class> &stock, const std::vector<mpz_class> &batch);
+    void schedule_refill();
+    // one batch of the refill, that schedules the next one
+    void refill_step();
+
+    const size_t capacity_, low_watermark_;
+
+    // encryption with its own random state, protected by gen_mtx_
+    Paillier *paillier_;
+    std::mutex gen_mtx_;
+
+    mutable std::mutex mtx_;
+    // protected by mtx_
+    gmp_randstate_t seed_state_;
+    std::deque<mpz_class> zeros_, ones_;
+    bool refilling_;
+    bool done_;
+    std::future<void> refill_;
+};
+
+// Encryptions of the plaintexts under the key of p, by at most n_threads tasks
+// of the shared thread pool. Every task has its own copy of the key, with a
+// random state seeded from state.
+std::vector<mpz_class> parallel_encrypt(const Paillier &p, const std::vector<mpz_class> &plaintexts, gmp_randstate_t state, unsigned int n_threads);
@@ -21,6 +21,7 @@
 #include <assert.h>
 #include <vector>
 #include <crypto/paillier.hh>
+#include <crypto/paillier_pool.hh>
 #include <crypto/gm.hh>
 #include <NTL/ZZ.h>
 #include <gmpxx.h>
@@ -245,6 +246,50 @@ static void paillier_fast_perf(unsigned int k, size_t n_iteration)
     cerr << "decryption: "<<  ((double)t/1000000)/n_iteration <<"ms per cyphertext" << endl;
     
 }
+static void
+test_paillier_pool()
+{
+    cout << "Test Paillier constants pool ..." << flush;
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk = Paillier_priv::keygen(randstate,600);
+    Paillier_priv pp(sk,randstate);
+    
+    Paillier_constants_pool pool(pp.pubkey(),randstate,32,16);
+    pool.fill();
+    assert(pool.available_zeros() == 32);
+    assert(pool.available_ones() == 32);
+    
+    // take more than the pool contains: the others are computed on the fly
+    vector<mpz_class> zeros = pool.zeros(40);
+    vector<mpz_class> ones = pool.ones(40);
+    assert(zeros.size() == 40 && ones.size() == 40);
+    
+    for (size_t i = 0; i < zeros.size(); i++) {
+        assert(pp.decrypt(zeros[i]) == 0);
+        assert(pp.decrypt(ones[i]) == 1);
+        // every encryption is fresh
+        assert(i == 0 || zeros[i] != zeros[i-1]);
+    }
+    assert(pp.decrypt(pool.zero()) == 0);
+    assert(pp.decrypt(pool.one()) == 1);
+    
+    // the same plaintext gets different encryptions in the different tasks
+    vector<mpz_class> plaintexts(10, mpz_class(7));
+    plaintexts[3] = 0;
+    vector<mpz_class> c = parallel_encrypt(pp, plaintexts, randstate, 4);
+    assert(c.size() == plaintexts.size());
+    for (size_t i = 0; i < c.size(); i++) {
+        assert(pp.decrypt(c[i]) == plaintexts[i]);
+        assert(i == 0 || c[i] != c[i-1]);
+    }
+    
+    cout << " passed" << endl;
+}
+
 static void
 test_gm()
 {
@@ -284,6 +329,7 @@ main(int ac, char **av)
 //    test_elgamal();
 	test_paillier();
 	test_paillier_fast();
+	test_paillier_pool();
 	test_gm();
 
     
@@ -0,0 +1,344 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#include <mpc/bitonic_enc_top_k.hh>
+#include <mpc/enc_argmax.hh>
+#include <algorithm>
+
+/*
+ * Bitonic sort for any number of elements (H. W. Lang): the greatest values
+ * go to the lowest wires when descending is true.
+ * For a number of elements that is a power of 2, the merge is the usual
+ * bitonic merge.
+ */
+
+static void add_compare_exchange(size_t i, size_t j, bool descending, vector<Compare_exchange> &ops)
+{
+    ops.push_back(descending ? Compare_exchange(i,j) : Compare_exchange(j,i));
+}
+
+static void bitonic_merge(size_t lo, size_t n, bool descending, vector<Compare_exchange> &ops)
+{
+    if (n <= 1) {
+        return;
+    }
+    
+    // greatest power of 2 lower than n
+    size_t m = 1;
+    while (2*m < n) {
+        m *= 2;
+    }
+    
+    for (size_t i = lo; i < lo+n-m; i++) {
+        add_compare_exchange(i, i+m, descending, ops);
+    }
+    bitonic_merge(lo, m, descending, ops);
+    bitonic_merge(lo+m, n-m, descending, ops);
+}
+
+static void bitonic_sort(size_t lo, size_t n, bool descending, vector<Compare_exchange> &ops)
+{
+    if (n <= 1) {
+        return;
+    }
+    
+    size_t m = n/2;
+    bitonic_sort(lo, m, !descending, ops);
+    bitonic_sort(lo+m, n-m, descending, ops);
+    bitonic_merge(lo, n, descending, ops);
+}
+
+// the operations that can change the first n_top wires, in layers
+static vector< vector<Compare_exchange> > schedule_network(const vector<Compare_exchange> &ops, size_t k, size_t n_top)
+{
+    // going backward, keep the operations that can change a wire we need
+    vector<bool> needed(k, false);
+    for (size_t i = 0; i < min(n_top, k); i++) {
+        needed[i] = true;
+    }
+    
+    vector<Compare_exchange> kept;
+    for (size_t o = ops.size(); o > 0; o--) {
+        const Compare_exchange &op = ops[o-1];
+        if (needed[op.first] || needed[op.second]) {
+            needed[op.first] = needed[op.second] = true;
+            kept.push_back(op);
+        }
+    }
+    reverse(kept.begin(), kept.end());
+    
+    // put every operation in the first layer after the ones using the same wires
+    vector<size_t> wire_depth(k, 0);
+    vector< vector<Compare_exchange> > layers;
+    for (size_t o = 0; o < kept.size(); o++) {
+        size_t d = max(wire_depth[kept[o].first], wire_depth[kept[o].second]);
+        if (d == layers.size()) {
+            layers.push_back(vector<Compare_exchange>());
+        }
+        layers[d].push_back(kept[o]);
+        wire_depth[kept[o].first] = wire_depth[kept[o].second] = d+1;
+    }
+    
+    return layers;
+}
+
+// sort the blocks of b wires (b the smallest power of 2 not lower than n_top) and merge them
+static void block_top_k(size_t k, size_t n_top, vector<Compare_exchange> &ops)
+{
+    size_t b = 1;
+    while (b < min(n_top, k)) {
+        b *= 2;
+    }
+    
+    vector<size_t> blocks;
+    for (size_t lo = 0; lo < k; lo += b) {
+        blocks.push_back(lo);
+        bitonic_sort(lo, min(b, k-lo), true, ops);
+    }
+    
+    // merge the blocks 2 by 2, keeping the b greatest values in the first one
+    while (blocks.size() > 1) {
+        vector<size_t> merged;
+        for (size_t i = 0; i+1 < blocks.size(); i += 2) {
+            size_t first = blocks[i], second = blocks[i+1];
+            size_t second_size = min(b, k-second);
+            
+            // both blocks are sorted: the greatest values of their union are the max of the i-th of the first and of the (b-1-i)-th of the second
+            // (the missing values of a shorter second block are -infinity)
+            for (size_t j = b - second_size; j < b; j++) {
+                add_compare_exchange(first+j, second+b-1-j, true, ops);
+            }
+            // this gives a bitonic sequence
+            bitonic_merge(first, b, true, ops);
+            merged.push_back(first);
+        }
+        if (blocks.size()%2 == 1) {
+            merged.push_back(blocks.back());
+        }
+        blocks = merged;
+    }
+}
+
+vector< vector<Compare_exchange> > bitonic_top_k_network(size_t k, size_t n_top)
+{
+    vector<Compare_exchange> block_ops, sort_ops;
+    block_top_k(k, n_top, block_ops);
+    bitonic_sort(0, k, true, sort_ops);
+    
+    vector< vector<Compare_exchange> > block_network = schedule_network(block_ops, k, n_top);
+    vector< vector<Compare_exchange> > sort_network = schedule_network(sort_ops, k, n_top);
+    
+    // when n_top is close to k, sorting everything can be shallower
+    if (sort_network.size() < block_network.size()) {
+        return sort_network;
+    }
+    return block_network;
+}
+
+Bitonic_EncTopK_Owner::Bitonic_EncTopK_Owner(const vector<mpz_class> &a, size_t n_top, const size_t &l, Paillier &p, gmp_randstate_t state, unsigned int lambda)
+: k_(a.size()), n_top_(min(n_top, a.size())), values_(k_), layer_(0), lambda_(lambda), bit_length_(l), paillier_(p), is_protocol_done_(false)
+{
+    assert(k_ > 0);
+    assert(n_top_ > 0);
+    gmp_randinit_set(randstate_, state);
+    
+    perm_ = genRandomPermutation(k_,randstate_);
+
+    for (size_t i = 0; i < k_; i++) {
+        values_[i] = a[perm_[i]];
+    }
+    
+    network_ = bitonic_top_k_network(k_, n_top_);
+}
+
+vector<mpz_class> Bitonic_EncTopK_Owner::top_values() const
+{
+    assert(is_protocol_done_);
+    return vector<mpz_class>(values_.begin(), values_.begin() + n_top_);
+}
+
+vector<Rev_EncCompare_Owner*> Bitonic_EncTopK_Owner::create_current_round_rev_enc_compare_owners(function<Comparison_protocol_A*()> comparator_creator)
+{
+    const vector<Compare_exchange> &layer = network_[layer_];
+    vector<Rev_EncCompare_Owner*> owners(layer.size());
+    
+    // the result is true if the values must be swapped
+    for (size_t i = 0; i < layer.size(); i++) {
+        owners[i] = new  Rev_EncCompare_Owner(values_[layer[i].first], values_[layer[i].second],bit_length_,paillier_,comparator_creator(),randstate_);
+    }
+    
+    return owners;
+}
+
+vector<mpz_class> Bitonic_EncTopK_Owner::next_round()
+{
+    const vector<Compare_exchange> &layer = network_[layer_];
+    size_t n = layer.size();
+    
+    // the two values of every operation
+    vector<mpz_class> randomized_values(2*n);
+    noise_ = vector<mpz_class>(2*n);
+    
+    for (size_t i = 0; i < n; i++) {
+        mpz_urandomb(noise_[2*i].get_mpz_t(), randstate_, lambda_+bit_length_);
+        mpz_urandomb(noise_[2*i+1].get_mpz_t(), randstate_, lambda_+bit_length_);
+        randomized_values[2*i] = paillier_.add(values_[layer[i].first],paillier_.encrypt(noise_[2*i]));
+        randomized_values[2*i+1] = paillier_.add(values_[layer[i].second],paillier_.encrypt(noise_[2*i+1]));
+    }
+    
+    return randomized_values;
+}
+
+void Bitonic_EncTopK_Owner::update_values(const vector<mpz_class> &rand_max, const vector<mpz_class> &rand_min, const vector<mpz_class> &swap, const vector<mpz_class> &keep)
+{
+    const vector<Compare_exchange> &layer = network_[layer_];
+    size_t n = layer.size();
+    assert(rand_max.size() == n && rand_min.size() == n && swap.size() == n && keep.size() == n);
+    
+    for (size_t i = 0; i < n; i++) {
+        // max = rand_max - (keep ? noise of first : noise of second)
+        mpz_class v = paillier_.sub(rand_max[i], paillier_.constMult(noise_[2*i],keep[i]));
+        values_[layer[i].first] = paillier_.sub(v, paillier_.constMult(noise_[2*i+1],swap[i]));
+        
+        // min = rand_min - (keep ? noise of second : noise of first)
+        v = paillier_.sub(rand_min[i], paillier_.constMult(noise_[2*i],swap[i]));
+        values_[layer[i].second] = paillier_.sub(v, paillier_.constMult(noise_[2*i+1],keep[i]));
+    }
+    
+    layer_++;
+}
+
+void Bitonic_EncTopK_Owner::unpermuteResult(const vector<size_t> &top_perm)
+{
+    assert(top_perm.size() == n_top_);
+    top_ = vector<size_t>(n_top_);
+    
+    for (size_t i = 0; i < n_top_; i++) {
+        assert(top_perm[i] < perm_.size());
+        top_[i] = perm_[top_perm[i]];
+    }
+    
+    is_protocol_done_ = true;
+}
+
+Bitonic_EncTopK_Helper::Bitonic_EncTopK_Helper(const size_t &l, const size_t &k, size_t n_top, Paillier_priv_fast &pp, Paillier_constants_pool *constants)
+: k_(k), n_top_(min(n_top, k)), wires_(k), layer_(0), bit_length_(l), paillier_(pp), constants_(constants)
+{
+    assert(k_ > 0);
+    assert(n_top_ > 0);
+    
+    for (size_t i = 0; i < k_; i++) {
+        wires_[i] = i;
+    }
+    
+    network_ = bitonic_top_k_network(k_, n_top_);
+}
+
+vector<size_t> Bitonic_EncTopK_Helper::permuted_top() const
+{
+    assert(!new_round_needed());
+    return vector<size_t>(wires_.begin(), wires_.begin() + n_top_);
+}
+
+void Bitonic_EncTopK_Helper::update_values(const vector<bool> &comp, const vector<mpz_class> &randomized_values, vector<mpz_class> &rand_max, vector<mpz_class> &rand_min, vector<mpz_class> &swap, vector<mpz_class> &keep)
+{
+    const vector<Compare_exchange> &layer = network_[layer_];
+    size_t n = layer.size();
+    assert(comp.size() == n && randomized_values.size() == 2*n);
+    
+    // we need fresh encryptions of 0 and 1 to ensure security
+    // the values are refreshed by a multiplication by an encryption of 0
+    vector<mpz_class> zeros, ones;
+    if (constants_) {
+        zeros = constants_->zeros(3*n);
+        ones = constants_->ones(n);
+    }else{
+        for (size_t i = 0; i < 3*n; i++) {
+            zeros.push_back(paillier_.encrypt(0));
+        }
+        for (size_t i = 0; i < n; i++) {
+            ones.push_back(paillier_.encrypt(1));
+        }
+    }
+    
+    rand_max = vector<mpz_class>(n);
+    rand_min = vector<mpz_class>(n);
+    swap = vector<mpz_class>(n);
+    keep = vector<mpz_class>(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        const mpz_class &first = randomized_values[2*i];
+        const mpz_class &second = randomized_values[2*i+1];
+        
+        if (comp[i]) {
+            rand_max[i] = paillier_.add(second, zeros[3*i]);
+            rand_min[i] = paillier_.add(first, zeros[3*i+1]);
+            swap[i] = ones[i];
+            keep[i] = zeros[3*i+2];
+            std::swap(wires_[layer[i].first], wires_[layer[i].second]);
+        }else{
+            rand_max[i] = paillier_.add(first, zeros[3*i]);
+            rand_min[i] = paillier_.add(second, zeros[3*i+1]);
+            swap[i] = zeros[3*i+2];
+            keep[i] = ones[i];
+        }
+    }
+    
+    layer_++;
+}
+
+vector<Rev_EncCompare_Helper*> Bitonic_EncTopK_Helper::create_current_round_rev_enc_compare_helpers(function<Comparison_protocol_B*()> comparator_creator)
+{
+    size_t n = network_[layer_].size();
+    vector<Rev_EncCompare_Helper*> helpers(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        helpers[i] = new  Rev_EncCompare_Helper(bit_length_,paillier_,comparator_creator());
+    }
+    
+    return helpers;
+}
+
+void runProtocol(Bitonic_EncTopK_Owner &owner, Bitonic_EncTopK_Helper &helper,function<Comparison_protocol_A*()> comparator_creator_A, function<Comparison_protocol_B*()> comparator_creator_B, gmp_randstate_t state, unsigned int lambda)
+{
+    while (owner.new_round_needed()) {
+        
+        vector<Rev_EncCompare_Owner*> rev_enc_owners = owner.create_current_round_rev_enc_compare_owners(comparator_creator_A);
+        
+        vector<Rev_EncCompare_Helper*> rev_enc_helpers = helper.create_current_round_rev_enc_compare_helpers(comparator_creator_B);
+
+        vector<bool> results (rev_enc_owners.size());
+        for (size_t i = 0; i < rev_enc_owners.size(); i++) {
+            runProtocol(*rev_enc_owners[i],*rev_enc_helpers[i],state, lambda);
+            results[i] = rev_enc_helpers[i]->output();
+            delete rev_enc_owners[i];
+            delete rev_enc_helpers[i];
+        }
+        
+        vector<mpz_class> randomized_values = owner.next_round();
+        
+        vector<mpz_class> rand_max, rand_min, swap, keep;
+        helper.update_values(results, randomized_values, rand_max, rand_min, swap, keep);
+        
+        owner.update_values(rand_max, rand_min, swap, keep);
+    }
+    
+    owner.unpermuteResult(helper.permuted_top());
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#pragma once
+
+#include <utility>
+
+#include <mpc/rev_enc_comparison.hh>
+#include <crypto/paillier_pool.hh>
+
+#include <cstddef>
+#include <functional>
+#include <math/util_gmp_rand.h>
+
+using namespace  std;
+
+// Top-k of encrypted values with a bitonic network.
+// The values are the wires of the network, in a random order. The
+// compare-exchange operations of a layer are independent: they are run as one
+// batch of comparisons, followed by an oblivious swap (as the tree argmax
+// refresh). After the last layer, the first n_top wires hold the n_top
+// greatest values, in decreasing order.
+// The network sorts blocks of b wires (b the power of 2 above n_top) and
+// merges them 2 by 2, keeping the b greatest values: it has
+// O(log^2(b) + log(k/b)*log(b)) layers and O(k*log^2(b)) operations.
+
+// a compare-exchange operation: the greatest value goes to the first wire
+typedef pair<size_t,size_t> Compare_exchange;
+
+// the layers of the network sorting the first n_top wires out of k
+vector< vector<Compare_exchange> > bitonic_top_k_network(size_t k, size_t n_top);
+
+class Bitonic_EncTopK_Owner {
+public:
+    Bitonic_EncTopK_Owner(const vector<mpz_class> &a, size_t n_top, const size_t &l, Paillier &p, gmp_randstate_t state, unsigned int lambda = 100);
+    
+    void unpermuteResult(const vector<size_t> &top_perm);
+    // the indices of the n_top greatest values, the greatest first
+    vector<size_t> output() const { assert(is_protocol_done_); return top_;}
+    // the encryptions of these values, in the same order
+    vector<mpz_class> top_values() const;
+
+    vector<Rev_EncCompare_Owner*> create_current_round_rev_enc_compare_owners(function<Comparison_protocol_A*()> comparator_creator);
+    vector<mpz_class> next_round();
+    // for each operation of the layer: the randomized greatest and lowest values and the encryptions of the swap bit and of its complement
+    void update_values(const vector<mpz_class> &rand_max, const vector<mpz_class> &rand_min, const vector<mpz_class> &swap, const vector<mpz_class> &keep);
+    
+    size_t bit_length() const { return bit_length_; }
+    size_t elements_number() const { return k_; }
+    size_t top_number() const { return n_top_; }
+    
+    bool new_round_needed() const { return layer_ < network_.size(); };
+protected:
+    vector<size_t> perm_; // the permutation used to hide the real order
+    
+    size_t k_; // number of elements
+    size_t n_top_;
+    vector<mpz_class> values_;
+    vector< vector<Compare_exchange> > network_;
+    size_t layer_;
+
+    unsigned int lambda_;
+    size_t bit_length_;
+    gmp_randstate_t randstate_;
+    Paillier paillier_;
+
+    /* intermediate value */
+    vector<mpz_class> noise_;
+    
+    /* final output */
+    bool is_protocol_done_;
+    vector<size_t> top_;
+};
+
+
+class Bitonic_EncTopK_Helper {
+public:
+    // the encryptions of 0 and 1 are taken from constants when it is not NULL
+    Bitonic_EncTopK_Helper(const size_t &l, const size_t &k, size_t n_top, Paillier_priv_fast &pp, Paillier_constants_pool *constants = NULL);
+    
+    void update_values(const vector<bool> &comp, const vector<mpz_class> &randomized_values, vector<mpz_class> &rand_max, vector<mpz_class> &rand_min, vector<mpz_class> &swap, vector<mpz_class> &keep);
+    
+    vector<Rev_EncCompare_Helper*> create_current_round_rev_enc_compare_helpers(function<Comparison_protocol_B*()> comparator_creator);
+
+    // the permuted indices of the n_top greatest values
+    vector<size_t> permuted_top() const;
+    size_t elements_number() const { return k_; }
+    size_t top_number() const { return n_top_; }
+    size_t bit_length() const { return bit_length_; }
+    
+    bool new_round_needed() const { return layer_ < network_.size(); };
+
+protected:
+    size_t k_; // number of elements
+    size_t n_top_;
+    vector<size_t> wires_; // permuted index of the value on each wire
+    vector< vector<Compare_exchange> > network_;
+    size_t layer_;
+    size_t bit_length_;
+
+    Paillier_priv_fast paillier_;
+    Paillier_constants_pool *constants_;
+};
+
+void runProtocol(Bitonic_EncTopK_Owner &owner, Bitonic_EncTopK_Helper &helper,function<Comparison_protocol_A*()> comparator_creator_A, function<Comparison_protocol_B*()> comparator_creator_B, gmp_randstate_t state, unsigned int lambda = 100);
@@ -52,5 +52,6 @@ typedef enum
 {
     LSIC_PROTOCOL = 0,
     DGK_PROTOCOL = 1,
-    GC_PROTOCOL = 2
+    GC_PROTOCOL = 2,
+    ADAPTIVE_PROTOCOL = 3 // resolved by the server, at runtime, to one of the above
 }COMPARISON_PROTOCOL;
\ No newline at end of file
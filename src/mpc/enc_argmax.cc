@@ -20,7 +20,9 @@
 
 #include <mpc/enc_argmax.hh>
 #include <algorithm>
-#include <thread>
+#include <future>
+#include <functional>
+#include <util/threadpool.hh>
 #include <ctime>
 
 
@@ -53,10 +55,8 @@ EncArgmax_Owner::~EncArgmax_Owner()
 
 void EncArgmax_Owner::unpermuteResult(size_t argmax_perm)
 {
-    map<size_t,size_t>::iterator it;
-    it=perm_.find(argmax_perm);
-    
-    i_0_ = it->second;
+    assert(argmax_perm < perm_.size());
+    i_0_ = perm_[argmax_perm];
 
     is_protocol_done_ = true;
 }
@@ -138,19 +138,20 @@ size_t EncArgmax_Helper::permuted_argmax() const
 }
 
 
-map<size_t,size_t> genRandomPermutation(const size_t &n, gmp_randstate_t state)
+vector<size_t> genRandomPermutation(const size_t &n, gmp_randstate_t state)
 {
-    map<size_t,size_t> perm;
+    vector<size_t> perm(n);
     
     for (size_t i = 0; i < n; i++)
     {
         perm[i] = i;
     }
     
-    for (size_t i = 0; i < n; i++)
+    // Fisher-Yates shuffle
+    for (size_t i = n; i > 1; i--)
     {
-        unsigned long randomValue = gmp_urandomm_ui(state,n);
-        swap(perm[i], perm[randomValue]);
+        unsigned long randomValue = gmp_urandomm_ui(state,i);
+        swap(perm[i-1], perm[randomValue]);
     }
     return perm;
 }
@@ -192,25 +193,23 @@ void runProtocol(EncArgmax_Owner &owner, EncArgmax_Helper &helper, gmp_randstate
     size_t m = (k-1)*(k-2)/2;
     m = ceilf( ((float)m)/num_threads);
     
-    thread threads[num_threads];
-    size_t t = 0, c_count = 0, i_begin = 0;
+    ThreadPool &pool = ThreadPool::shared();
+    vector<future<void>> jobs;
+    size_t c_count = 0, i_begin = 0;
     for (size_t i = 0; i < k; i++) {
         c_count += i;
         if (c_count >= m) {
-            threads[t] = thread(threadCall, &owner, &helper, state, lambda, i_begin,i+1);
+            jobs.push_back(pool.submit(bind(threadCall, &owner, &helper, state, lambda, i_begin,i+1)));
             i_begin = i+1;
             c_count = 0;
-            t++;
         }
     }
     if (c_count >0) {
-        threads[t] = thread(threadCall, &owner, &helper, state, lambda, i_begin,k);
-        t++;
+        jobs.push_back(pool.submit(bind(threadCall, &owner, &helper, state, lambda, i_begin,k)));
     }
 
-    size_t t_max = t;
-    for (t = 0; t < t_max; t++) {
-        threads[t].join();
+    for (size_t t = 0; t < jobs.size(); t++) {
+        pool.wait(jobs[t]);
     }
 
     helper.sort();
@@ -22,7 +22,6 @@
 
 #include <mpc/rev_enc_comparison.hh>
 #include <vector>
-#include <map>
 #include <cstddef>
 #include <functional>
 
@@ -44,7 +43,7 @@ public:
     
     
 protected:
-    map<size_t,size_t> perm_; // the permutation used to hide the real order
+    vector<size_t> perm_; // the permutation used to hide the real order
     vector< vector<Rev_EncCompare_Owner*> >comparators_;
     
     size_t k_; // number of elements
@@ -76,7 +75,8 @@ protected:
     bool is_sorted_;
 };
 
-map<size_t,size_t> genRandomPermutation(const size_t &n, gmp_randstate_t state);
+// a uniformly random permutation of [0,n), as an array: perm[i] is the image of i
+vector<size_t> genRandomPermutation(const size_t &n, gmp_randstate_t state);
 
 void runProtocol(EncArgmax_Owner &owner, EncArgmax_Helper &helper, gmp_randstate_t state, unsigned int lambda = 100);
 
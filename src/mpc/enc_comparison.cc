@@ -22,6 +22,7 @@
 #include <gmpxx.h>
 
 #include <mpc/enc_comparison.hh>
+#include <crypto/paillier_pool.hh>
 
 using namespace std;
 
@@ -29,7 +30,11 @@ using namespace std;
 EncCompare_Owner::EncCompare_Owner(const mpz_class &v_a, const mpz_class &v_b, const size_t &l, Paillier &p, Comparison_protocol_B *comparator, gmp_randstate_t state)
 : a_(v_a), b_(v_b), bit_length_(l), paillier_(p),  comparator_(comparator), two_l_(0), is_set_up_(false), is_protocol_done_(false)
 {
-    gmp_randinit_set(randstate_, state);
+    // the owners of a batch are built from the same state: a copy would give them all the same mask r
+    mpz_class seed;
+    mpz_urandomb(seed.get_mpz_t(), state, 256);
+    gmp_randinit_default(randstate_);
+    gmp_randseed(randstate_, seed.get_mpz_t());
     mpz_setbit(two_l_.get_mpz_t(),bit_length_); // set two_l_ to 2^l
 }
 
@@ -48,15 +53,37 @@ void EncCompare_Owner::set_input(const mpz_class &v_a, const mpz_class &v_b)
 // setup runs lines 1 to 4 in the protocol description
 mpz_class EncCompare_Owner::setup(unsigned int lambda)
 {
-    mpz_class x, r, z, c;
+    return blind_difference(paillier_.encrypt(prepare_setup(lambda)));
+}
+
+vector<mpz_class> EncCompare_Owner::batch_setup(const vector<EncCompare_Owner*> &owners, unsigned int lambda, unsigned int n_threads)
+{
+    size_t n = owners.size();
+    vector<mpz_class> plaintexts(n), z(n);
+    
+    if (n == 0) {
+        return z;
+    }
     
-    // x = b + 2^l - a
-    x = paillier_.add(b_,paillier_.encrypt(two_l_));
-    x = paillier_.sub(x,a_);
+    // the GM encryptions are cheap, they stay in this thread
+    for (size_t i = 0; i < n; i++) {
+        assert(owners[i]->paillier_.pubkey() == owners[0]->paillier_.pubkey());
+        plaintexts[i] = owners[i]->prepare_setup(lambda);
+    }
+    
+    vector<mpz_class> c = parallel_encrypt(owners[0]->paillier_, plaintexts, owners[0]->randstate_, n_threads);
+    
+    for (size_t i = 0; i < n; i++) {
+        z[i] = owners[i]->blind_difference(c[i]);
+    }
+    return z;
+}
+
+mpz_class EncCompare_Owner::prepare_setup(unsigned int lambda)
+{
+    mpz_class r, c;
     
     mpz_urandomb(r.get_mpz_t(), randstate_, lambda+bit_length_);
-    // z = x + r
-    z = paillier_.add(x,paillier_.encrypt(r));
 
     // c = r mod 2^l
     c = r % two_l_;
@@ -71,7 +98,15 @@ mpz_class EncCompare_Owner::setup(unsigned int lambda)
 //    cout << "l = " << bit_length_ << endl;
 //    cout << "Owner setup: \nr = " << r << "\t" << r.get_str(2) << "\nr_l = " << r_l << "\nc = " << c << endl;
 //    cout << "2^l = " << two_l_ << endl;
-    return z;
+    return two_l_ + r;
+}
+
+mpz_class EncCompare_Owner::blind_difference(const mpz_class &c_two_l_r) const
+{
+    // z = b + 2^l + r - a
+    // 2^l and r are encrypted together: the encryption of r randomizes z
+    mpz_class z = paillier_.add(b_,c_two_l_r);
+    return paillier_.sub(z,a_);
 }
 
 void EncCompare_Owner::decryptResult(const mpz_class &c_t)
@@ -23,6 +23,8 @@
 using namespace std;
 
 #include<iostream>
+#include <cstring>
+#include <cassert>
 
 #include <justGarble/gates.h>
 
@@ -317,4 +319,56 @@ void runProtocol(GC_Compare_A &party_a, GC_Compare_B &party_b, gmp_randstate_t s
     outputVals[0] = party_a.map_output(party_b.get_output_map());
     
     party_a.unblind(party_b.get_enc_mask());
-}
\ No newline at end of file
+}
+void runProtocol(const vector<GC_Compare_A*> &parties_a, const vector<GC_Compare_B*> &parties_b, gmp_randstate_t state)
+{
+    assert(parties_a.size() == parties_b.size());
+    size_t n = parties_a.size();
+    size_t total_l = 0;
+    
+    for (size_t i = 0; i < n; i++) {
+        parties_a[i]->prepare_circuit();
+        parties_b[i]->prepare_circuit();
+        total_l += parties_a[i]->bit_length();
+    }
+    
+    int *a_inputs = new int[total_l];
+    block *all_a_labels = new block[2*total_l];
+    block *a_labels = new block[total_l];
+    
+    // gather the inputs of every comparison ...
+    for (size_t i = 0, offset = 0; i < n; i++) {
+        size_t l = parties_a[i]->bit_length();
+        vector<bool> a_bits = parties_a[i]->get_a_bits();
+        block *labels = parties_b[i]->get_all_a_input_labels();
+        
+        for (size_t j = 0; j < l; j++) {
+            a_inputs[offset+j] = a_bits[j];
+        }
+        memcpy(all_a_labels + 2*offset, labels, 2*l*sizeof(block));
+        free(labels);
+        
+        offset += l;
+    }
+    
+    // ... so that a single OT is needed for the whole batch
+    extractLabels(a_labels, all_a_labels, a_inputs, total_l);
+    
+    for (size_t i = 0, offset = 0; i < n; i++) {
+        parties_a[i]->set_global_key(parties_b[i]->get_global_key());
+        parties_a[i]->set_garbled_table(parties_b[i]->get_garbled_table());
+        
+        block *b_labels = parties_b[i]->get_b_input_labels();
+        
+        parties_a[i]->evaluateGC(a_labels + offset, b_labels);
+        parties_a[i]->map_output(parties_b[i]->get_output_map());
+        parties_a[i]->unblind(parties_b[i]->get_enc_mask());
+        
+        free(b_labels);
+        offset += parties_a[i]->bit_length();
+    }
+    
+    delete [] a_inputs;
+    delete [] all_a_labels;
+    delete [] a_labels;
+}
@@ -126,4 +126,9 @@ inline void runProtocol(GC_Compare_A *party_a, GC_Compare_B *party_b, gmp_randst
 {
     runProtocol(*party_a,*party_b, state);
 }
+
+// Runs n comparisons at once: the circuits are garbled independently but
+// their tables, labels and output maps are exchanged in contiguous buffers
+// and a single OT gives A the labels of all its inputs
+void runProtocol(const std::vector<GC_Compare_A*> &parties_a, const std::vector<GC_Compare_B*> &parties_b, gmp_randstate_t state);
 #endif /* defined(__ciphermed_proj__garbled_comparison__) */
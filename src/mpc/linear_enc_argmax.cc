@@ -21,23 +21,45 @@
 #include <mpc/linear_enc_argmax.hh>
 #include <mpc/enc_argmax.hh>
 #include <algorithm>
+#include <random>
 
 
+// a random state of its own for the precomputations, seeded from state,
+// or from the random device when there is none (cheaper than drawing a Paillier encryption)
+static void init_derived_randstate(gmp_randstate_t derived, gmp_randstate_t state)
+{
+    mpz_class seed;
+    if (state) {
+        mpz_urandomb(seed.get_mpz_t(), state, 256);
+    }else{
+        random_device rd;
+        for (size_t i = 0; i < 8; i++) {
+            seed = (seed << 32) + rd();
+        }
+    }
+    gmp_randinit_default(derived);
+    gmp_randseed(derived, seed.get_mpz_t());
+}
+
 Linear_EncArgmax_Owner::Linear_EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, Paillier &p, gmp_randstate_t state, unsigned int lambda)
-: a_(a), k_(a.size()), round_count_(0), lambda_(lambda), bit_length_(l), paillier_(p), is_protocol_done_(false)
+: a_(a), k_(a.size()), round_count_(0), lambda_(lambda), bit_length_(l), paillier_(p),
+  blinding_paillier_((init_derived_randstate(blinding_randstate_, state), p.pubkey()), blinding_randstate_), blinding_ready_(false),
+  is_protocol_done_(false)
 {
     assert(k_ > 0);
     gmp_randinit_set(randstate_, state);
     
-    for (size_t i = 0; i < k_; i++) {
-        perm_[i] = k_ -1 - i;
-    }
-
     perm_ = genRandomPermutation(k_,randstate_);
     
     enc_max_ = a_[perm_[0]];
 }
 
+Linear_EncArgmax_Owner::~Linear_EncArgmax_Owner()
+{
+    gmp_randclear(randstate_);
+    gmp_randclear(blinding_randstate_);
+}
+
 Rev_EncCompare_Owner Linear_EncArgmax_Owner::create_current_round_rev_enc_compare_owner(function<Comparison_protocol_A*()> comparator_creator)
 {
     return Rev_EncCompare_Owner(enc_max_, a_[perm_[round_count_+1]],bit_length_,paillier_,comparator_creator(),randstate_);
@@ -48,15 +70,30 @@ Rev_EncCompare_Owner Linear_EncArgmax_Owner::create_current_round_rev_enc_compar
     return Rev_EncCompare_Owner(enc_max_, a_[perm_[round_count_+1]],bit_length_,paillier_,comparator,randstate_);
 
 }
+void Linear_EncArgmax_Owner::precompute_blinding()
+{
+    mpz_urandomb(next_rand_x_.get_mpz_t(), blinding_randstate_, lambda_+bit_length_);
+    mpz_urandomb(next_rand_y_.get_mpz_t(), blinding_randstate_, lambda_+bit_length_);
+    
+    next_enc_rand_x_ = blinding_paillier_.encrypt(next_rand_x_);
+    next_enc_rand_y_ = blinding_paillier_.encrypt(next_rand_y_);
+    
+    blinding_ready_ = true;
+}
+
 void Linear_EncArgmax_Owner::next_round(mpz_class &randomized_enc_max, mpz_class &randomized_value)
 {
     assert(round_count_ < (k_-1));
 
-    mpz_urandomb(rand_x_.get_mpz_t(), randstate_, lambda_+bit_length_);
-    mpz_urandomb(rand_y_.get_mpz_t(), randstate_, lambda_+bit_length_);
+    if (!blinding_ready_) {
+        precompute_blinding();
+    }
+    rand_x_ = next_rand_x_;
+    rand_y_ = next_rand_y_;
+    blinding_ready_ = false;
 
-    randomized_enc_max = paillier_.add(enc_max_,paillier_.encrypt(rand_x_));
-    randomized_value = paillier_.add(a_[perm_[round_count_+1]],paillier_.encrypt(rand_y_));
+    randomized_enc_max = paillier_.add(enc_max_,next_enc_rand_x_);
+    randomized_value = paillier_.add(a_[perm_[round_count_+1]],next_enc_rand_y_);
     
     round_count_++;
 }
@@ -74,31 +111,56 @@ void Linear_EncArgmax_Owner::update_enc_max(const mpz_class &new_enc_max, const
 
 void Linear_EncArgmax_Owner::unpermuteResult(size_t argmax_perm)
 {
-    map<size_t,size_t>::iterator it;
-    it=perm_.find(argmax_perm);
-    
-    i_0_ = it->second;
+    assert(argmax_perm < perm_.size());
+    i_0_ = perm_[argmax_perm];
     
     is_protocol_done_ = true;
 }
 
-Linear_EncArgmax_Helper::Linear_EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp)
-: k_(k), round_count_(0), bit_length_(l), argmax_perm_(0), paillier_(pp)
+// the seed is drawn from the random state of the key
+Linear_EncArgmax_Helper::Linear_EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp, Paillier_constants_pool *constants)
+: k_(k), round_count_(0), bit_length_(l), argmax_perm_(0), paillier_(pp), constants_(constants),
+  update_paillier_((init_derived_randstate(update_randstate_, NULL), pp.pubkey()), update_randstate_), update_ready_(false)
 {
     assert(k_ > 0);
         
 }
 
+Linear_EncArgmax_Helper::~Linear_EncArgmax_Helper()
+{
+    gmp_randclear(update_randstate_);
+}
+
 size_t Linear_EncArgmax_Helper::permuted_argmax() const
 {
     assert(round_count_ < (k_-1));
     return argmax_perm_;
 }
 
+void Linear_EncArgmax_Helper::precompute_update()
+{
+    if (constants_) {
+        vector<mpz_class> zeros = constants_->zeros(2);
+        next_zero_ = zeros[0];
+        next_refresh_ = zeros[1];
+        next_one_ = constants_->one();
+    }else{
+        next_zero_ = update_paillier_.encrypt(0);
+        next_one_ = update_paillier_.encrypt(1);
+        next_refresh_ = update_paillier_.encrypt(0);
+    }
+    
+    update_ready_ = true;
+}
+
 void Linear_EncArgmax_Helper::update_argmax(bool comp, const mpz_class &old_enc_max, const mpz_class &v, size_t index, mpz_class &new_enc_max, mpz_class &x, mpz_class &y)
 {
-    mpz_class zero = paillier_.encrypt(0);
-    mpz_class one = paillier_.encrypt(1);
+    if (!update_ready_) {
+        precompute_update();
+    }
+    mpz_class zero = next_zero_;
+    mpz_class one = next_one_;
+    update_ready_ = false;
     
     if (comp) {
         new_enc_max = v;
@@ -111,7 +173,8 @@ void Linear_EncArgmax_Helper::update_argmax(bool comp, const mpz_class &old_enc_
         y = zero;
     }
     
-    paillier_.refresh(new_enc_max);
+    // refresh with a precomputed encryption of 0
+    new_enc_max = paillier_.add(new_enc_max, next_refresh_);
 }
 
 Rev_EncCompare_Helper Linear_EncArgmax_Helper::rev_enc_compare_helper(function<Comparison_protocol_B*()> comparator_creator)
@@ -20,9 +20,10 @@
 
 #pragma once
 
-#include <map>
+#include <vector>
 
 #include <mpc/rev_enc_comparison.hh>
+#include <crypto/paillier_pool.hh>
 
 #include <cstddef>
 #include <functional>
@@ -33,7 +34,11 @@ using namespace  std;
 class Linear_EncArgmax_Owner {
 public:
     Linear_EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, Paillier &p, gmp_randstate_t state, unsigned int lambda = 100);
-//    ~Linear_EncArgmax_Owner();
+    ~Linear_EncArgmax_Owner();
+    
+    // the random states cannot be shared
+    Linear_EncArgmax_Owner(const Linear_EncArgmax_Owner&) = delete;
+    Linear_EncArgmax_Owner &operator=(const Linear_EncArgmax_Owner &) = delete;
     
     void unpermuteResult(size_t argmax_perm);
     size_t output() const { assert(is_protocol_done_); return i_0_;}
@@ -43,11 +48,15 @@ public:
     void next_round(mpz_class &randomized_enc_max, mpz_class &randomized_value);
     void update_enc_max(const mpz_class &new_enc_max, const mpz_class &x, const mpz_class &y);
     
+    // computes the blinding of the next call to next_round
+    // it does not depend on the comparison, and can run concurrently with it
+    void precompute_blinding();
+    
     size_t bit_length() const { return bit_length_; }
     size_t elements_number() const { return k_; }
 protected:
     vector<mpz_class> a_;
-    map<size_t,size_t> perm_; // the permutation used to hide the real order
+    vector<size_t> perm_; // the permutation used to hide the real order
     
     size_t k_; // number of elements
     size_t round_count_;
@@ -61,6 +70,13 @@ protected:
     mpz_class enc_max_;
     mpz_class rand_x_, rand_y_;
     
+    /* precomputed blinding, with its own key copy and random state to run in another thread */
+    gmp_randstate_t blinding_randstate_;
+    Paillier blinding_paillier_;
+    bool blinding_ready_;
+    mpz_class next_rand_x_, next_rand_y_;
+    mpz_class next_enc_rand_x_, next_enc_rand_y_;
+    
     /* final output */
     bool is_protocol_done_;
     size_t i_0_;
@@ -70,12 +86,20 @@ protected:
 
 class Linear_EncArgmax_Helper {
 public:
-    Linear_EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp);
+    // the encryptions of 0 and 1 are taken from constants when it is not NULL
+    Linear_EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp, Paillier_constants_pool *constants = NULL);
     
-//    ~Linear_EncArgmax_Helper();
+    ~Linear_EncArgmax_Helper();
+    
+    Linear_EncArgmax_Helper(const Linear_EncArgmax_Helper&) = delete;
+    Linear_EncArgmax_Helper &operator=(const Linear_EncArgmax_Helper &) = delete;
     
     void update_argmax(bool comp, const mpz_class &old_enc_max, const mpz_class &v, size_t index, mpz_class &new_enc_max, mpz_class &x, mpz_class &y);
     
+    // computes the encryptions of the next call to update_argmax
+    // it does not depend on the comparison, and can run concurrently with it
+    void precompute_update();
+    
     Rev_EncCompare_Helper rev_enc_compare_helper(function<Comparison_protocol_B*()> comparator_creator);
     Rev_EncCompare_Helper rev_enc_compare_helper(Comparison_protocol_B* comparator);
 
@@ -90,6 +114,13 @@ protected:
     size_t argmax_perm_;
     Paillier_priv_fast paillier_;
     
+    Paillier_constants_pool *constants_;
+    
+    /* precomputed encryptions, with their own key copy and random state to run in another thread */
+    gmp_randstate_t update_randstate_;
+    Paillier update_paillier_;
+    bool update_ready_;
+    mpz_class next_zero_, next_one_, next_refresh_;
 };
 
 void runProtocol(Linear_EncArgmax_Owner &owner, Linear_EncArgmax_Helper &helper,function<Comparison_protocol_A*()> comparator_creator_A, function<Comparison_protocol_B*()> comparator_creator_B, gmp_randstate_t state, unsigned int lambda = 100);
\ No newline at end of file
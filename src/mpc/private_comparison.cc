@@ -20,8 +20,10 @@
 
 #include <mpc/private_comparison.hh>
 
-#include <thread>
+#include <future>
+#include <cassert>
 #include <util/util.hh>
+#include <util/threadpool.hh>
 
 using namespace std;
 
@@ -52,30 +54,10 @@ vector<mpz_class> Compare_B::encrypt_bits_parallel(unsigned int n_threads)
 //    ScopedTimer timer("encrypt_bits_parallel");
     vector<mpz_class> c_b(bit_length_);
     
-    
-    size_t n = bit_length_;
-    size_t m = ceilf( ((float)n)/n_threads);
-    thread threads[n_threads];
-
-    auto job =[this,&c_b](size_t i_start,size_t i_end)
-    {
-        for (size_t i = i_start; i < i_end; i++) {
-            c_b[i] = paillier_.encrypt(mpz_tstbit(b_.get_mpz_t(),i));
-        }
-    };
-
-    size_t t = 0, i_start = 0;
-    
-    for (t = 0; t < n_threads; t++) {
-        threads[t] = thread(job,i_start,min<size_t>(i_start+m,n));
-        i_start += m;
-    }
-    
-    
-    size_t t_max = t;
-    for (t = 0; t < t_max; t++) {
-        threads[t].join();
-    }
+    ThreadPool::shared().parallel_for(0, bit_length_, [this,&c_b](size_t i)
+                                      {
+                                          c_b[i] = paillier_.encrypt(mpz_tstbit(b_.get_mpz_t(),i));
+                                      }, n_threads);
 
     return c_b;
 }
@@ -83,15 +65,20 @@ vector<mpz_class> Compare_B::encrypt_bits_parallel(unsigned int n_threads)
 mpz_class Compare_B::search_zero(const vector<mpz_class> &c)
 {
 //    ScopedTimer timer("search_zero");
+    return encrypt_result(has_zero(c));
+}
+
+bool Compare_B::has_zero(const vector<mpz_class> &c)
+{
     // can be parallelized
     for (size_t i = 0; i < c.size(); i++) {
         if (paillier_.decrypt(c[i]) == 0) {
 //            cout << "Has zero" << endl;
-            return gm_.encrypt(true);
+            return true;
         }
     }
-  
-    return gm_.encrypt(false);
+    
+    return false;
 }
 
 Compare_A::Compare_A(const mpz_class &x, const size_t &l, Paillier &paillier, GM &gm, gmp_randstate_t state)
@@ -119,6 +106,86 @@ std::vector<mpz_class> Compare_A::compute(const std::vector<mpz_class> &c_b, uns
     return c;
 }
 
+void Compare_A::compute_pipelined(const std::vector<mpz_class> &c_b, const std::function<void(const std::vector<mpz_class>&)> &send_chunk, size_t chunk_size, unsigned int n_threads)
+{
+    assert(chunk_size > 0);
+    
+    vector<mpz_class> c_w = compute_w(c_b);
+    vector<mpz_class> c_sums = compute_sums_parallel(c_w, n_threads);
+    
+    // the shuffle is fixed in advance: the j-th output is c[perm[j]]
+    vector<size_t> perm = random_permutation(bit_length_);
+    
+    // draw all the randomness here, the workers only use const methods of paillier_
+    vector<mpz_class> c(bit_length_), r(bit_length_);
+    vector<bool> rerand(bit_length_);
+    const mpz_class n = paillier_.pubkey()[0];
+    long delta = (1-s_)/2;
+    
+    for (size_t j = 0; j < bit_length_; j++) {
+        rerand[j] = (mpz_tstbit(a_.get_mpz_t(),perm[j]) == delta);
+        if (rerand[j]) {
+            mpz_urandomm(r[j].get_mpz_t(),randstate_,n.get_mpz_t());
+        }else{
+            // c_i > 0, see compute_c
+            c[j] = paillier_.random_encryption();
+        }
+    }
+    
+    auto compute_chunk = [this,&c,&c_b,&c_sums,&perm,&r,&rerand,chunk_size](size_t k)
+    {
+        size_t j_end = min<size_t>((k+1)*chunk_size,bit_length_);
+        for (size_t j = k*chunk_size; j < j_end; j++) {
+            if (rerand[j]) {
+                size_t i = perm[j];
+                c[j] = paillier_.constMult(r[j], compute_c_i(c_b[i], c_sums[i], mpz_tstbit(a_.get_mpz_t(),i)));
+            }
+        }
+    };
+    
+    size_t n_chunks = (bit_length_ + chunk_size - 1)/chunk_size;
+    
+    auto chunk = [&c,chunk_size,this](size_t k)
+    {
+        return vector<mpz_class>(c.begin()+k*chunk_size, c.begin()+min<size_t>((k+1)*chunk_size,bit_length_));
+    };
+    
+    if (n_threads < 2) {
+        for (size_t k = 0; k < n_chunks; k++) {
+            compute_chunk(k);
+            send_chunk(chunk(k));
+        }
+        return;
+    }
+    
+    // the chunks are queued in order, the caller sends them as soon as they are done
+    // at most n_threads chunks are in flight
+    ThreadPool &pool = ThreadPool::shared();
+    vector<future<void>> chunk_done(n_chunks);
+    size_t submitted = 0;
+    
+    try {
+        for (size_t k = 0; k < n_chunks; k++) {
+            for (; submitted < n_chunks && submitted < k + n_threads; submitted++) {
+                chunk_done[submitted] = pool.submit([&compute_chunk,submitted](){ compute_chunk(submitted); });
+            }
+            pool.wait(chunk_done[k]);
+            send_chunk(chunk(k));
+        }
+    } catch (...) {
+        // the chunks in flight reference this stack frame: wait for all of them before unwinding
+        for (size_t k = 0; k < submitted; k++) {
+            if (chunk_done[k].valid()) {
+                try {
+                    pool.wait(chunk_done[k]);
+                } catch (...) {
+                }
+            }
+        }
+        throw;
+    }
+}
+
 vector<mpz_class> Compare_A::compute_w(const std::vector<mpz_class> &c_b)
 {
 //    ScopedTimer timer("compute_w");
@@ -150,6 +217,56 @@ vector<mpz_class> Compare_A::compute_sums(const std::vector<mpz_class> &c_w)
     return c_sums;
 }
 
+// c_sums is a suffix product: split it in blocks, scan the blocks in parallel,
+// and then fix each block with the product of the blocks on its right
+vector<mpz_class> Compare_A::compute_sums_parallel(const std::vector<mpz_class> &c_w, unsigned int n_threads)
+{
+    size_t n = bit_length_;
+    
+    if (n_threads < 2 || n < 2*n_threads) {
+        return compute_sums(c_w);
+    }
+    
+    vector<mpz_class> c_sums(n);
+    vector<mpz_class> block_prod(n_threads,1);
+    size_t m = (n + n_threads - 1)/n_threads;
+    
+    // local suffix products of the block [i_start, i_end) and product of its c_w
+    auto scan_job = [this,&c_w,&c_sums,&block_prod,n,m](size_t t)
+    {
+        size_t i_start = t*m, i_end = min<size_t>(i_start+m,n);
+        if (i_start >= i_end) {
+            return;
+        }
+        c_sums[i_end-1] = 1;
+        for (size_t i = i_end-1; i > i_start; i--) {
+            c_sums[i-1] = paillier_.add(c_sums[i],c_w[i]);
+        }
+        block_prod[t] = paillier_.add(c_sums[i_start],c_w[i_start]);
+    };
+    
+    // carry is the product of all the blocks on the right
+    auto fix_job = [this,&c_sums,n,m](size_t t, const mpz_class &carry)
+    {
+        size_t i_start = t*m, i_end = min<size_t>(i_start+m,n);
+        for (size_t i = i_start; i < i_end; i++) {
+            c_sums[i] = paillier_.add(c_sums[i],carry);
+        }
+    };
+    
+    ThreadPool &pool = ThreadPool::shared();
+    pool.parallel_for(0, n_threads, scan_job, n_threads);
+    
+    vector<mpz_class> carries(n_threads,1);
+    for (size_t t = n_threads-1; t > 0; t--) {
+        carries[t-1] = paillier_.add(carries[t],block_prod[t]);
+    }
+    
+    pool.parallel_for(0, n_threads-1, [&fix_job,&carries](size_t t){ fix_job(t,carries[t]); }, n_threads);
+    
+    return c_sums;
+}
+
 vector<mpz_class> Compare_A::compute_c(const std::vector<mpz_class> &c_b,const std::vector<mpz_class> &c_sums, std::vector<size_t> &rerand_indexes)
 {
 //    ScopedTimer timer("compute_c");
@@ -168,27 +285,7 @@ vector<mpz_class> Compare_A::compute_c(const std::vector<mpz_class> &c_b,const s
             c[i] = paillier_.random_encryption();
             continue;
         }
-        c[i] = paillier_.constMult(3,c_sums[i]);
-        
-        c[i] = paillier_.sub(c[i], c_b[i]);
-        
-        
-        switch (a_i+s_) {
-            case 1:
-            c[i] = paillier_.add(c[i], paillier_one_);
-            break;
-            
-            case 2:
-            c[i] = paillier_.add(c[i], paillier_one_*paillier_one_);
-            break;
-            
-            case -1:
-            c[i] = paillier_.sub(c[i], paillier_one_);
-            break;
-            
-            default:
-            break;
-        }
+        c[i] = compute_c_i(c_b[i], c_sums[i], a_i);
         
         rerand_indexes.push_back(i);
         
@@ -198,6 +295,33 @@ vector<mpz_class> Compare_A::compute_c(const std::vector<mpz_class> &c_b,const s
     return c;
 }
 
+mpz_class Compare_A::compute_c_i(const mpz_class &c_b_i, const mpz_class &c_sum_i, long a_i) const
+{
+    mpz_class c_i = paillier_.constMult(3,c_sum_i);
+    
+    c_i = paillier_.sub(c_i, c_b_i);
+    
+    
+    switch (a_i+s_) {
+        case 1:
+        c_i = paillier_.add(c_i, paillier_one_);
+        break;
+        
+        case 2:
+        c_i = paillier_.add(c_i, paillier_one_*paillier_one_);
+        break;
+        
+        case -1:
+        c_i = paillier_.sub(c_i, paillier_one_);
+        break;
+        
+        default:
+        break;
+    }
+    
+    return c_i;
+}
+
 vector<mpz_class> Compare_A::rerandomize(const vector<mpz_class> &c, const std::vector<size_t> &rerand_indexes)
 {
 //    ScopedTimer timer("rerandomize");
@@ -220,29 +344,17 @@ vector<mpz_class> Compare_A::rerandomize_parallel(const vector<mpz_class> &c, co
     
     vector<mpz_class> c_rand(c);
     
-    size_t n = rerand_indexes.size();
-    size_t m = ceilf( ((float)n)/n_threads);
-    thread threads[n_threads];
-    
-    auto job =[this,&c_rand,&rerand_indexes](size_t i_start,size_t i_end)
-    {
-        for (size_t i = i_start; i < i_end; i++) {
-            c_rand[rerand_indexes[i]] = paillier_.scalarize(c_rand[rerand_indexes[i]]);
-        }
-    };
-
-    size_t t = 0, i_start = 0;
-    
-    for (t = 0; t < n_threads; t++) {
-        threads[t] = thread(job,i_start,min<size_t>(i_start+m,n));
-        i_start += m;
+    // same as paillier_.scalarize, but the random scalars are drawn here, not concurrently
+    const mpz_class n = paillier_.pubkey()[0];
+    vector<mpz_class> r(rerand_indexes.size());
+    for (size_t i = 0; i < r.size(); i++) {
+        mpz_urandomm(r[i].get_mpz_t(),randstate_,n.get_mpz_t());
     }
     
-    
-    size_t t_max = t;
-    for (t = 0; t < t_max; t++) {
-        threads[t].join();
-    }
+    ThreadPool::shared().parallel_for(0, rerand_indexes.size(), [this,&c_rand,&rerand_indexes,&r](size_t i)
+                                      {
+                                          c_rand[rerand_indexes[i]] = paillier_.constMult(r[i],c_rand[rerand_indexes[i]]);
+                                      }, n_threads);
     
     return c_rand;
 }
@@ -252,6 +364,17 @@ void Compare_A::shuffle(std::vector<mpz_class> &c)
     random_shuffle(c.begin(),c.end(),[this](int n){ return gmp_urandomm_ui(randstate_,n); });
 }
 
+vector<size_t> Compare_A::random_permutation(size_t n)
+{
+    vector<size_t> perm(n);
+    for (size_t i = 0; i < n; i++) {
+        perm[i] = i;
+    }
+    random_shuffle(perm.begin(),perm.end(),[this](int k){ return gmp_urandomm_ui(randstate_,k); });
+    
+    return perm;
+}
+
 
 void Compare_A::unblind(const mpz_class &t_prime)
 {
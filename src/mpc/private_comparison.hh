@@ -21,6 +21,7 @@
 #pragma once
 
 #include <vector>
+#include <functional>
 #include <gmpxx.h>
 #include <crypto/paillier.hh>
 #include <crypto/gm.hh>
@@ -35,8 +36,13 @@ public:
 
     std::vector<mpz_class> compute(const std::vector<mpz_class> &c_b, unsigned int n_threads = 4);
     
+    // same result as compute, but the shuffled output is produced by chunks of chunk_size elements
+    // each chunk is passed, in order, to send_chunk as soon as it is ready, while the next ones are still computed
+    void compute_pipelined(const std::vector<mpz_class> &c_b, const std::function<void(const std::vector<mpz_class>&)> &send_chunk, size_t chunk_size, unsigned int n_threads = 4);
+    
     std::vector<mpz_class> compute_w(const std::vector<mpz_class> &c_b);
     std::vector<mpz_class> compute_sums(const std::vector<mpz_class> &c_w);
+    std::vector<mpz_class> compute_sums_parallel(const std::vector<mpz_class> &c_w, unsigned int n_threads = 4);
     
     std::vector<mpz_class> compute_c(const std::vector<mpz_class> &c_a,const std::vector<mpz_class> &c_sums, std::vector<size_t> &rerand_indexes);
     
@@ -44,6 +50,7 @@ public:
     std::vector<mpz_class> rerandomize_parallel(const std::vector<mpz_class> &c, const std::vector<size_t> &rerand_indexes, unsigned int n_threads = 4);
     
     void shuffle(std::vector<mpz_class> &c);
+    std::vector<size_t> random_permutation(size_t n);
 
     void unblind(const mpz_class &t_prime);
     
@@ -54,6 +61,9 @@ public:
     mpz_class output() const { return res_; }
     
 protected:
+    // value of c_i, before rerandomization, when a_i == delta
+    mpz_class compute_c_i(const mpz_class &c_b_i, const mpz_class &c_sum_i, long a_i) const;
+
     mpz_class a_;
     long s_;
     size_t bit_length_; // bit length of the numbers to compare
@@ -77,6 +87,10 @@ public:
     
     mpz_class search_zero(const std::vector<mpz_class> &c);
     
+    // to process the values of c by chunks
+    bool has_zero(const std::vector<mpz_class> &c);
+    mpz_class encrypt_result(bool has_zero) { return gm_.encrypt(has_zero); }
+    
     GM_priv gm() const { return gm_; };
     size_t bit_length() const { return bit_length_; }
     virtual void set_bit_length(size_t l) {bit_length_ = l;}
@@ -41,6 +41,8 @@ public:
     
     void set_input(const mpz_class &v_a, const mpz_class &v_b);
     mpz_class setup(unsigned int lambda); // lambda is the parameter for statistical security. r <- [0, 2^{l+lambda}[ \cap \Z
+    // setup of owners with the same Paillier key, the encryptions run in parallel on the shared thread pool
+    static std::vector<mpz_class> batch_setup(const std::vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, unsigned int n_threads);
     mpz_class concludeProtocol(const mpz_class &c_r_l_);
 
     Paillier paillier() const { return paillier_; }
@@ -52,6 +54,12 @@ public:
     mpz_class encrypted_output() const { return c_t_; }
 
 protected:
+    // the setup in two steps, to encrypt 2^l + r out of the object
+    // draws r, sets the comparator up and returns 2^l + r
+    mpz_class prepare_setup(unsigned int lambda);
+    // z = b - a + Enc(2^l + r)
+    mpz_class blind_difference(const mpz_class &c_two_l_r) const;
+    
     mpz_class a_,b_;
     size_t bit_length_;
     Paillier paillier_;
@@ -0,0 +1,252 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#include <mpc/streaming_enc_argmax.hh>
+#include <mpc/enc_argmax.hh>
+
+#include <stdexcept>
+
+// bit length of the candidates indices
+#define STREAMING_INDEX_BITS 64
+
+Streaming_EncArgmax_Owner::Streaming_EncArgmax_Owner(const size_t &l, Paillier &p, gmp_randstate_t state, unsigned int lambda)
+: candidates_count_(0), stream_closed_(false), lambda_(lambda), bit_length_(l), paillier_(p), is_protocol_done_(false)
+{
+    gmp_randinit_set(randstate_, state);
+}
+
+void Streaming_EncArgmax_Owner::add_candidates(const vector<mpz_class> &a)
+{
+    assert(!stream_closed_);
+    
+    for (size_t i = 0; i < a.size(); i++) {
+        local_max_.push_back(a[i]);
+        local_index_.push_back(mpz_class((unsigned long)candidates_count_));
+        index_encrypted_.push_back(false);
+        candidates_count_++;
+    }
+}
+
+void Streaming_EncArgmax_Owner::close_stream()
+{
+    if (candidates_count_ == 0) {
+        throw std::runtime_error("Empty stream: no candidate for the argmax");
+    }
+    stream_closed_ = true;
+}
+
+void Streaming_EncArgmax_Owner::shuffle()
+{
+    vector<size_t> perm = genRandomPermutation(local_max_.size(),randstate_);
+    
+    vector<mpz_class> new_local_max(perm.size()), new_local_index(perm.size());
+    vector<bool> new_index_encrypted(perm.size());
+    
+    for (size_t i = 0; i < perm.size(); i++) {
+        new_local_max[i] = local_max_[perm[i]];
+        new_local_index[i] = local_index_[perm[i]];
+        new_index_encrypted[i] = index_encrypted_[perm[i]];
+    }
+    
+    local_max_ = new_local_max;
+    local_index_ = new_local_index;
+    index_encrypted_ = new_index_encrypted;
+}
+
+vector<Rev_EncCompare_Owner*> Streaming_EncArgmax_Owner::create_current_round_rev_enc_compare_owners(function<Comparison_protocol_A*()> comparator_creator)
+{
+    shuffle();
+    
+    size_t n = local_max_.size()/2;
+    vector<Rev_EncCompare_Owner*> owners(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        owners[i] = new  Rev_EncCompare_Owner(local_max_[2*i], local_max_[2*i+1],bit_length_,paillier_,comparator_creator(),randstate_);
+    }
+    
+    return owners;
+}
+
+vector<mpz_class> Streaming_EncArgmax_Owner::next_round()
+{
+    // we don't care about the last value if the size is odd
+    size_t n = local_max_.size() - (local_max_.size()%2);
+    vector<mpz_class> randomized_values(2*n);
+    noise_ = vector<mpz_class>(n);
+    index_noise_ = vector<mpz_class>(n);
+    
+    for (size_t i = 0; i<n; i++) {
+        mpz_urandomb(noise_[i].get_mpz_t(), randstate_, lambda_+bit_length_);
+        randomized_values[i] = paillier_.add(local_max_[i],paillier_.encrypt(noise_[i]));
+        
+        mpz_urandomb(index_noise_[i].get_mpz_t(), randstate_, lambda_+STREAMING_INDEX_BITS);
+        if (index_encrypted_[i]) {
+            randomized_values[n+i] = paillier_.add(local_index_[i],paillier_.encrypt(index_noise_[i]));
+        }else{
+            randomized_values[n+i] = paillier_.encrypt(local_index_[i] + index_noise_[i]);
+        }
+    }
+    
+    return randomized_values;
+}
+
+void Streaming_EncArgmax_Owner::update_local_max(const vector<mpz_class> &rand_local_max, const vector<mpz_class> &rand_local_index, const vector<mpz_class> &x, const vector<mpz_class> &y)
+{
+    size_t n = local_max_.size();
+    size_t new_size = n/2 + n%2;
+    vector<mpz_class> new_local_max(new_size), new_local_index(new_size); // size of vectors is ceil(n/2)
+    vector<bool> new_index_encrypted(new_size, true);
+    
+    for (size_t i = 0; i < n/2; i++) {
+        new_local_max[i] = paillier_.sub(rand_local_max[i],paillier_.constMult(noise_[2*i],x[i]));
+        new_local_max[i] = paillier_.sub(new_local_max[i],paillier_.constMult(noise_[2*i+1],y[i]));
+        
+        new_local_index[i] = paillier_.sub(rand_local_index[i],paillier_.constMult(index_noise_[2*i],x[i]));
+        new_local_index[i] = paillier_.sub(new_local_index[i],paillier_.constMult(index_noise_[2*i+1],y[i]));
+    }
+    
+    if (n%2 == 1) {
+        new_local_max[new_size-1] = local_max_[n-1];
+        new_local_index[new_size-1] = local_index_[n-1];
+        new_index_encrypted[new_size-1] = index_encrypted_[n-1];
+    }
+    
+    local_max_ = new_local_max;
+    local_index_ = new_local_index;
+    index_encrypted_ = new_index_encrypted;
+}
+
+mpz_class Streaming_EncArgmax_Owner::blinded_argmax()
+{
+    assert(stream_closed_ && local_max_.size() == 1);
+    
+    mpz_urandomb(index_mask_.get_mpz_t(), randstate_, lambda_+STREAMING_INDEX_BITS);
+    if (index_encrypted_[0]) {
+        return paillier_.add(local_index_[0],paillier_.encrypt(index_mask_));
+    }
+    // a single candidate: the index is already known, but the helper must not learn it
+    return paillier_.encrypt(local_index_[0] + index_mask_);
+}
+
+void Streaming_EncArgmax_Owner::unblindResult(const mpz_class &blinded_argmax)
+{
+    mpz_class argmax = blinded_argmax - index_mask_;
+    assert(argmax >= 0 && argmax < candidates_count_);
+    i_0_ = argmax.get_ui();
+    
+    is_protocol_done_ = true;
+}
+
+Streaming_EncArgmax_Helper::Streaming_EncArgmax_Helper(const size_t &l, Paillier_priv_fast &pp, Paillier_constants_pool *constants)
+: bit_length_(l), paillier_(pp), constants_(constants)
+{
+}
+
+void Streaming_EncArgmax_Helper::update_argmax(const vector<bool> &comp, const vector<mpz_class> &randomized_values, vector<mpz_class> &new_enc_max, vector<mpz_class> &new_enc_index, vector<mpz_class> &x, vector<mpz_class> &y)
+{
+    size_t n = comp.size();
+    assert(randomized_values.size() == 4*n);
+    const mpz_class *values = randomized_values.data();
+    const mpz_class *indices = randomized_values.data() + 2*n;
+    
+    new_enc_max = vector<mpz_class>(n);
+    new_enc_index = vector<mpz_class>(n);
+    x = vector<mpz_class>(n);
+    y = vector<mpz_class>(n);
+    
+    // we need fresh encryptions of 0 and 1 to ensure security
+    // the refreshes are multiplications by other encryptions of 0
+    vector<mpz_class> zeros, ones;
+    if (constants_) {
+        zeros = constants_->zeros(3*n);
+        ones = constants_->ones(n);
+    }
+    
+    for (size_t i = 0; i<n; i++) {
+        
+        mpz_class zero = constants_ ? zeros[i] : paillier_.encrypt(0);
+        mpz_class one = constants_ ? ones[i] : paillier_.encrypt(1);
+        
+        size_t selected = comp[i] ? 2*i+1 : 2*i;
+        new_enc_max[i] = values[selected];
+        new_enc_index[i] = indices[selected];
+        x[i] = comp[i] ? zero : one;
+        y[i] = comp[i] ? one : zero;
+        
+        if (constants_) {
+            new_enc_max[i] = paillier_.add(new_enc_max[i], zeros[n+i]);
+            new_enc_index[i] = paillier_.add(new_enc_index[i], zeros[2*n+i]);
+        }else{
+            paillier_.refresh(new_enc_max[i]);
+            paillier_.refresh(new_enc_index[i]);
+        }
+    }
+}
+
+vector<Rev_EncCompare_Helper*> Streaming_EncArgmax_Helper::create_current_round_rev_enc_compare_helpers(size_t n, function<Comparison_protocol_B*()> comparator_creator)
+{
+    vector<Rev_EncCompare_Helper*> helpers(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        helpers[i] = new  Rev_EncCompare_Helper(bit_length_,paillier_,comparator_creator());
+    }
+    
+    return helpers;
+}
+
+void runProtocol(Streaming_EncArgmax_Owner &owner, Streaming_EncArgmax_Helper &helper, function<vector<mpz_class>()> next_chunk, function<Comparison_protocol_A*()> comparator_creator_A, function<Comparison_protocol_B*()> comparator_creator_B, gmp_randstate_t state, unsigned int lambda)
+{
+    while (owner.new_round_needed()) {
+        if (!owner.stream_closed()) {
+            vector<mpz_class> chunk = next_chunk();
+            if (chunk.empty()) {
+                owner.close_stream();
+            }else{
+                owner.add_candidates(chunk);
+            }
+        }
+        
+        if (owner.current_round_size() == 0) {
+            continue;
+        }
+        
+        vector<Rev_EncCompare_Owner*> rev_enc_owners = owner.create_current_round_rev_enc_compare_owners(comparator_creator_A);
+        
+        vector<Rev_EncCompare_Helper*> rev_enc_helpers = helper.create_current_round_rev_enc_compare_helpers(rev_enc_owners.size(), comparator_creator_B);
+        
+        vector<bool> results (rev_enc_owners.size());
+        for (size_t i = 0; i < rev_enc_owners.size(); i++) {
+            runProtocol(*rev_enc_owners[i],*rev_enc_helpers[i],state, lambda);
+            results[i] = rev_enc_helpers[i]->output();
+            delete rev_enc_owners[i];
+            delete rev_enc_helpers[i];
+        }
+        
+        vector<mpz_class> randomized_values = owner.next_round();
+        
+        vector<mpz_class> new_enc_max, new_enc_index, x, y;
+        
+        helper.update_argmax(results, randomized_values, new_enc_max, new_enc_index, x, y);
+        
+        owner.update_local_max(new_enc_max, new_enc_index, x, y);
+    }
+    
+    owner.unblindResult(helper.decrypt_blinded_argmax(owner.blinded_argmax()));
+}
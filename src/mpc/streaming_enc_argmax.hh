@@ -0,0 +1,121 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <mpc/rev_enc_comparison.hh>
+#include <crypto/paillier_pool.hh>
+
+#include <cstddef>
+#include <functional>
+#include <math/util_gmp_rand.h>
+
+using namespace  std;
+
+// Streaming argmax: the candidates are given by chunks, and a round of
+// comparisons can start as soon as the first chunk is there.
+// The owner only keeps the current local maxima and the new candidates: each
+// round, they are shuffled and compared 2 by 2 (as in the tree argmax). The
+// index of a local maximum is carried along it, encrypted, so that no
+// permutation of the whole set is needed: the helper selects the index with
+// the value, and decrypts the blinded index of the maximum at the end.
+// With chunks of m candidates, at most 2m values are kept by the owner.
+
+// largest round accepted by the helper: chunks of at most this number of
+// candidates keep every round below it
+#define STREAMING_ARGMAX_MAX_ROUND_SIZE (1UL << 16)
+
+class Streaming_EncArgmax_Owner {
+public:
+    Streaming_EncArgmax_Owner(const size_t &l, Paillier &p, gmp_randstate_t state, unsigned int lambda = 100);
+    
+    // the new candidates get the next indices
+    void add_candidates(const vector<mpz_class> &a);
+    // no more candidates will be added, throws if there was none
+    void close_stream();
+    
+    vector<Rev_EncCompare_Owner*> create_current_round_rev_enc_compare_owners(function<Comparison_protocol_A*()> comparator_creator);
+    // the randomized values of the compared elements, followed by their randomized indices
+    vector<mpz_class> next_round();
+    void update_local_max(const vector<mpz_class> &rand_local_max, const vector<mpz_class> &rand_local_index, const vector<mpz_class> &x, const vector<mpz_class> &y);
+    
+    // the blinded index of the maximum, encrypted, to be decrypted by the helper
+    mpz_class blinded_argmax();
+    void unblindResult(const mpz_class &blinded_argmax);
+    size_t output() const { assert(is_protocol_done_); return i_0_;}
+    
+    size_t bit_length() const { return bit_length_; }
+    size_t candidates_number() const { return candidates_count_; }
+    // number of comparisons of the next round
+    size_t current_round_size() const { return local_max_.size()/2; }
+    bool stream_closed() const { return stream_closed_; }
+    
+    bool new_round_needed() const { return !stream_closed_ || local_max_.size() > 1; };
+protected:
+    // the shuffle hides to the helper which elements are new and which were the maxima of the last round
+    void shuffle();
+    
+    size_t candidates_count_;
+    bool stream_closed_;
+    
+    vector<mpz_class> local_max_;
+    // index of each local maximum: in the clear for the new candidates, encrypted otherwise
+    vector<mpz_class> local_index_;
+    vector<bool> index_encrypted_;
+    
+    unsigned int lambda_;
+    size_t bit_length_;
+    gmp_randstate_t randstate_;
+    Paillier paillier_;
+    
+    /* intermediate value */
+    vector<mpz_class> noise_, index_noise_;
+    mpz_class index_mask_;
+    
+    /* final output */
+    bool is_protocol_done_;
+    size_t i_0_;
+};
+
+
+class Streaming_EncArgmax_Helper {
+public:
+    // the encryptions of 0 and 1 are taken from constants when it is not NULL
+    Streaming_EncArgmax_Helper(const size_t &l, Paillier_priv_fast &pp, Paillier_constants_pool *constants = NULL);
+    
+    // randomized_values are the randomized values of the compared elements, followed by their randomized indices
+    void update_argmax(const vector<bool> &comp, const vector<mpz_class> &randomized_values, vector<mpz_class> &new_enc_max, vector<mpz_class> &new_enc_index, vector<mpz_class> &x, vector<mpz_class> &y);
+    
+    // the helper does not know the size of a round before the owner tells it
+    vector<Rev_EncCompare_Helper*> create_current_round_rev_enc_compare_helpers(size_t n, function<Comparison_protocol_B*()> comparator_creator);
+    
+    mpz_class decrypt_blinded_argmax(const mpz_class &c) { return paillier_.decrypt(c); }
+    size_t bit_length() const { return bit_length_; }
+    
+protected:
+    size_t bit_length_;
+    Paillier_priv_fast paillier_;
+    Paillier_constants_pool *constants_;
+};
+
+// next_chunk returns the candidates by chunks, and an empty vector at the end of the stream
+void runProtocol(Streaming_EncArgmax_Owner &owner, Streaming_EncArgmax_Helper &helper, function<vector<mpz_class>()> next_chunk, function<Comparison_protocol_A*()> comparator_creator_A, function<Comparison_protocol_B*()> comparator_creator_B, gmp_randstate_t state, unsigned int lambda = 100);
@@ -20,13 +20,18 @@
 
 #include <assert.h>
 #include <vector>
+#include <algorithm>
 #include <mpc/lsic.hh>
 #include <mpc/garbled_comparison.hh>
 #include <mpc/enc_comparison.hh>
 #include <mpc/rev_enc_comparison.hh>
+#include <mpc/threshold_enc_comparison.hh>
 #include <mpc/enc_argmax.hh>
 #include <mpc/linear_enc_argmax.hh>
 #include <mpc/tree_enc_argmax.hh>
+#include <mpc/tournament_enc_argmax.hh>
+#include <mpc/bitonic_enc_top_k.hh>
+#include <mpc/streaming_enc_argmax.hh>
 #include <mpc/change_encryption_scheme.hh>
 
 #include <crypto/gm.hh>
@@ -130,6 +135,59 @@ static void test_compare(unsigned int nbits = 256)
     cout << "Test Compare passed" << endl;
 }
 
+static void test_pipelined_compare(unsigned int nbits = 256, unsigned int n_threads = 4, size_t chunk_size = 16)
+{
+    cout << "Test pipelined compare ..." << endl;
+    ScopedTimer timer("Pipelined compare");
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk_p = Paillier_priv_fast::keygen(randstate,1024);
+    Paillier_priv_fast pp(sk_p,randstate);
+    Paillier p(pp.pubkey(),randstate);
+    
+    auto sk_gm = GM_priv::keygen(randstate);
+    GM_priv gm_priv(sk_gm,randstate);
+    GM gm(gm_priv.pubkey(),randstate);
+    
+    mpz_class a, b;
+    mpz_urandom_len(a.get_mpz_t(), randstate, nbits);
+    mpz_urandom_len(b.get_mpz_t(), randstate, nbits);
+    
+    Compare_A party_a(a, nbits, p, gm, randstate);
+    Compare_B party_b(b, nbits, pp, gm_priv);
+    
+    vector<mpz_class> c_b = party_b.encrypt_bits_parallel(n_threads);
+    
+    // the parallel scan must match the sequential one
+    vector<mpz_class> c_w = party_a.compute_w(c_b);
+    vector<mpz_class> sums = party_a.compute_sums(c_w);
+    vector<mpz_class> sums_parallel = party_a.compute_sums_parallel(c_w, n_threads);
+    for (size_t i = 0; i < nbits; i++) {
+        assert(pp.decrypt(sums[i]) == pp.decrypt(sums_parallel[i]));
+    }
+    
+    bool has_zero = false;
+    size_t received = 0;
+    party_a.compute_pipelined(c_b, [&](const vector<mpz_class> &chunk)
+                              {
+                                  assert(chunk.size() <= chunk_size);
+                                  received += chunk.size();
+                                  has_zero = party_b.has_zero(chunk) || has_zero;
+                              }, chunk_size, n_threads);
+    assert(received == nbits);
+    
+    party_a.unblind(party_b.encrypt_result(has_zero));
+    
+    bool result = party_b.gm().decrypt(party_a.output());
+    
+    assert( result == (a < b));
+    
+    cout << "Test pipelined compare passed" << endl;
+}
+
 static void test_gc(unsigned int nbits = 256)
 {
 //    nbits = 128;
@@ -173,6 +231,54 @@ static void test_gc(unsigned int nbits = 256)
 
 }
 
+static void test_batch_gc(unsigned int n = 10, unsigned int nbits = 256)
+{
+    cout << "Test batched compare with Garbled Circuits ..." << endl;
+    cout << n << " comparisons of " << nbits << " bits integers\n";
+    ScopedTimer timer("Batch GC Compare");
+    
+    ScopedTimer *t;
+    t = new ScopedTimer("Batch GC Compare init");
+    
+    gmp_randstate_t randstate;
+    gmp_randinit_default(randstate);
+    gmp_randseed_ui(randstate,time(NULL));
+    
+    auto sk_gm = GM_priv::keygen(randstate);
+    GM_priv gm_priv(sk_gm,randstate);
+    GM gm(gm_priv.pubkey(),randstate);
+    
+    vector<mpz_class> a(n), b(n);
+    vector<GC_Compare_A*> parties_a(n);
+    vector<GC_Compare_B*> parties_b(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        mpz_urandomb(a[i].get_mpz_t(), randstate, nbits);
+        mpz_urandomb(b[i].get_mpz_t(), randstate, nbits);
+        
+        parties_a[i] = new GC_Compare_A(a[i], nbits, gm, randstate);
+        parties_b[i] = new GC_Compare_B(b[i], nbits, gm_priv, randstate);
+    }
+    
+    delete t;
+    
+    t = new ScopedTimer("Batch GC Compare execution");
+    
+    runProtocol(parties_a, parties_b, randstate);
+    
+    delete t;
+    
+    for (size_t i = 0; i < n; i++) {
+        bool result = gm_priv.decrypt(parties_a[i]->output());
+        assert( result == (a[i] < b[i]));
+        
+        delete parties_a[i];
+        delete parties_b[i];
+    }
+    
+    cout << "Test Batch GC Compare passed" << endl;
+}
+
 static void test_enc_compare(unsigned int nbits = 256,unsigned int lambda = 100)
 {
     cout << "Test comparison over encrypted data ..." << endl;
@@ -263,6 +369,110 @@ static void test_rev_enc_compare(unsigned int nbits = 256,unsigned int lambda =
     cout << "Test passed" << endl;
 }
 
+// keys and LSIC creators shared by the encrypted comparison and argmax tests
+struct Enc_test_setup {
+    Enc_test_setup(unsigned int nbits)
+    : pp((init_randstate(randstate), Paillier_priv_fast::keygen(randstate,1024)), randstate),
+      p(pp.pubkey(),randstate), gm_priv(GM_priv::keygen(randstate),randstate), gm(gm_priv.pubkey(),randstate)
+    {
+        GM &gm_ref = gm;
+        GM_priv &gm_priv_ref = gm_priv;
+        party_a_creator = [&gm_ref,nbits](){ return new LSIC_A(0,nbits,gm_ref); };
+        party_b_creator = [&gm_priv_ref,nbits](){ return new LSIC_B(0,nbits,gm_priv_ref); };
+    }
+    
+    ~Enc_test_setup()
+    {
+        gmp_randclear(randstate);
+    }
+    
+    Enc_test_setup(const Enc_test_setup&) = delete;
+    Enc_test_setup &operator=(const Enc_test_setup&) = delete;
+    
+    static void init_randstate(gmp_randstate_t state)
+    {
+        gmp_randinit_default(state);
+        gmp_randseed_ui(state,time(NULL));
+    }
+    
+    // k random values of nbits bits, returns the index of the largest one
+    size_t random_values(vector<mpz_class> &v, size_t k, unsigned int nbits)
+    {
+        size_t argmax = 0;
+        v.resize(k);
+        for (size_t i = 0; i < k; i++) {
+            mpz_urandom_len(v[i].get_mpz_t(), randstate, nbits);
+            if (v[i] > v[argmax]) {
+                argmax = i;
+            }
+        }
+        return argmax;
+    }
+    
+    vector<mpz_class> encrypt(const vector<mpz_class> &v)
+    {
+        vector<mpz_class> c(v.size());
+        for (size_t i = 0; i < v.size(); i++) {
+            c[i] = pp.encrypt(v[i]);
+        }
+        return c;
+    }
+    
+    gmp_randstate_t randstate;
+    Paillier_priv_fast pp;
+    Paillier p;
+    GM_priv gm_priv;
+    GM gm;
+    function<Comparison_protocol_A*()> party_a_creator;
+    function<Comparison_protocol_B*()> party_b_creator;
+};
+
+static void test_threshold_enc_compare(unsigned int m = 10, unsigned int nbits = 256,unsigned int lambda = 100)
+{
+    cout << "Test comparison of encrypted data to " << m << " thresholds ..." << endl;
+    ScopedTimer timer("Threshold Enc. Compare");
+    
+    ScopedTimer *t;
+    t = new ScopedTimer("Protocol init");
+    
+    Enc_test_setup setup(nbits);
+    
+    mpz_class v;
+    mpz_urandom_len(v.get_mpz_t(), setup.randstate, nbits);
+    
+    vector<mpz_class> thresholds(m);
+    for (size_t j = 0; j < m; j++) {
+        mpz_urandom_len(thresholds[j].get_mpz_t(), setup.randstate, nbits);
+    }
+    // check the equality case too
+    if (m > 0) {
+        thresholds[0] = v;
+    }
+    
+    // the owner runs the B side of the comparisons
+    Threshold_EncCompare_Owner client(setup.pp.encrypt(v), thresholds, nbits, setup.p, setup.party_b_creator, setup.randstate);
+    Threshold_EncCompare_Helper server(nbits, m, setup.pp, setup.party_a_creator);
+    
+    delete t;
+    
+    t = new ScopedTimer("Running protocol");
+    
+    runProtocol(client,server,setup.randstate,lambda);
+    
+    delete t;
+    
+    vector<bool> result = client.output();
+    size_t bucket = 0;
+    
+    for (size_t j = 0; j < m; j++) {
+        assert( result[j] == (v >= thresholds[j]));
+        bucket += (v >= thresholds[j]);
+    }
+    assert( client.bucket() == bucket);
+    
+    cout << "Test passed" << endl;
+}
+
 static void test_enc_argmax(unsigned int k = 5, unsigned int nbits = 256,unsigned int lambda = 100, unsigned int num_threads = 1)
 {
     cout << "Test argmax over encrypted data ..." << endl;
@@ -393,62 +603,156 @@ static void test_tree_enc_argmax(unsigned int k = 5, unsigned int nbits = 256,un
     cout << k << " integers of " << nbits << " bits, " << lambda << " bits of security\n";
     ScopedTimer timer("Tree Enc. Argmax");
     
-    vector<mpz_class> v(k);
-    
     ScopedTimer *t, *timer_exec;
     t = new ScopedTimer("Protocol init");
     
-    gmp_randstate_t randstate;
-    gmp_randinit_default(randstate);
-    gmp_randseed_ui(randstate,time(NULL));
+    Enc_test_setup setup(nbits);
     
-    auto sk_p = Paillier_priv_fast::keygen(randstate,1024);
-    Paillier_priv_fast pp(sk_p,randstate);
-    Paillier p(pp.pubkey(),randstate);
+    vector<mpz_class> v;
+    size_t real_argmax = setup.random_values(v, k, nbits);
     
-    auto sk_gm = GM_priv::keygen(randstate);
-    GM_priv gm_priv(sk_gm,randstate);
-    GM gm(gm_priv.pubkey(),randstate);
+    Tree_EncArgmax_Owner client(setup.encrypt(v),nbits,setup.p,setup.randstate, lambda);
+    Tree_EncArgmax_Helper server(nbits,k,setup.pp);
     
-    size_t real_argmax = 0;
-    for (size_t i = 0; i < k; i++) {
-        mpz_urandom_len(v[i].get_mpz_t(), randstate, nbits);
-//        v[i] = i;
-        if (v[i] > v[real_argmax]) {
-            real_argmax = i;
-        }
-    }
+    delete t;
     
-    for (size_t i = 0; i < k; i++) {
-        v[i] = pp.encrypt(v[i]);
-    }
+    timer_exec = new ScopedTimer("Protocol execution");
     
-    //    auto party_a_creator = [&gm,&p,nbits,&randstate](){ return new Compare_A(0,nbits,p,gm,randstate); };
-    //    auto party_b_creator = [&gm_priv,&pp,nbits](){ return new Compare_B(0,nbits,pp,gm_priv); };
-    auto party_a_creator = [&gm,nbits](){ return new LSIC_A(0,nbits,gm); };
-    auto party_b_creator = [&gm_priv,nbits](){ return new LSIC_B(0,nbits,gm_priv); };
+    runProtocol(client,server,setup.party_a_creator, setup.party_b_creator, setup.randstate,lambda);
+    
+    delete timer_exec;
+    
+    size_t mpc_argmax = client.output();
+    
+    cout << "Real argmax = " << real_argmax;
+    cout << "\nFound argmax = " << mpc_argmax << endl;
+    assert(real_argmax == mpc_argmax);
+}
+
+static void test_tournament_enc_argmax(unsigned int k = 5, unsigned int nbits = 256,unsigned int lambda = 100, size_t fan_in = 3)
+{
+    cout << "Test tournament argmax over encrypted data ..." << endl;
+    cout << k << " integers of " << nbits << " bits, fan-in " << fan_in << ", " << lambda << " bits of security\n";
+    ScopedTimer timer("Tournament Enc. Argmax");
+    
+    ScopedTimer *t, *timer_exec;
+    t = new ScopedTimer("Protocol init");
+    
+    Enc_test_setup setup(nbits);
     
+    vector<mpz_class> v;
+    size_t real_argmax = setup.random_values(v, k, nbits);
     
-    Tree_EncArgmax_Owner client(v,nbits,p,randstate, lambda);
-    Tree_EncArgmax_Helper server(nbits,k,pp);
+    Tournament_EncArgmax_Owner client(setup.encrypt(v),nbits,fan_in,setup.p,setup.randstate, lambda);
+    Tournament_EncArgmax_Helper server(nbits,k,fan_in,setup.pp);
     
     delete t;
     
     timer_exec = new ScopedTimer("Protocol execution");
     
-    runProtocol(client,server,party_a_creator, party_b_creator, randstate,lambda);
+    runProtocol(client,server,setup.party_a_creator, setup.party_b_creator, setup.randstate,lambda);
     
     delete timer_exec;
     
-    vector<mpz_class>::iterator argmax;
+    size_t mpc_argmax = client.output();
+    
+    cout << "Real argmax = " << real_argmax;
+    cout << "\nFound argmax = " << mpc_argmax << endl;
+    assert(real_argmax == mpc_argmax);
+    
+    // fan-in 2 is the tree argmax, fan-in k the constant round one
+    assert(tournament_comparisons(k, 2) == k-1);
+    assert(k < 2 || tournament_rounds(k, k) == 1);
+    assert(tournament_comparisons(k, k) == k*(k-1)/2);
+}
+
+static void test_streaming_enc_argmax(unsigned int k = 50, unsigned int chunk_size = 8, unsigned int nbits = 256,unsigned int lambda = 100)
+{
+    cout << "Test streaming argmax over encrypted data ..." << endl;
+    cout << k << " integers of " << nbits << " bits, chunks of " << chunk_size << ", " << lambda << " bits of security\n";
+    ScopedTimer timer("Streaming Enc. Argmax");
+    
+    ScopedTimer *t, *timer_exec;
+    t = new ScopedTimer("Protocol init");
+    
+    Enc_test_setup setup(nbits);
+    
+    vector<mpz_class> v;
+    size_t real_argmax = setup.random_values(v, k, nbits);
+    
+    // the candidates are encrypted chunk by chunk
+    size_t next = 0;
+    auto next_chunk = [&](){
+        vector<mpz_class> chunk;
+        for (; next < k && chunk.size() < chunk_size; next++) {
+            chunk.push_back(setup.pp.encrypt(v[next]));
+        }
+        return chunk;
+    };
+    
+    Streaming_EncArgmax_Owner client(nbits,setup.p,setup.randstate, lambda);
+    Streaming_EncArgmax_Helper server(nbits,setup.pp);
+    
+    delete t;
+    
+    timer_exec = new ScopedTimer("Protocol execution");
+    
+    runProtocol(client,server,next_chunk,setup.party_a_creator, setup.party_b_creator, setup.randstate,lambda);
+    
+    delete timer_exec;
     
     size_t mpc_argmax = client.output();
     
     cout << "Real argmax = " << real_argmax;
     cout << "\nFound argmax = " << mpc_argmax << endl;
+    assert(client.candidates_number() == k);
     assert(real_argmax == mpc_argmax);
 }
 
+static void test_bitonic_enc_top_k(unsigned int k = 10, unsigned int n_top = 3, unsigned int nbits = 256,unsigned int lambda = 100)
+{
+    cout << "Test top-k over encrypted data ..." << endl;
+    cout << "top " << n_top << " of " << k << " integers of " << nbits << " bits, " << lambda << " bits of security\n";
+    ScopedTimer timer("Bitonic Enc. Top-k");
+    
+    ScopedTimer *t, *timer_exec;
+    t = new ScopedTimer("Protocol init");
+    
+    Enc_test_setup setup(nbits);
+    
+    vector<mpz_class> clear_values;
+    setup.random_values(clear_values, k, nbits);
+    
+    // the indices sorted by decreasing values
+    vector<size_t> real_order(k);
+    for (size_t i = 0; i < k; i++) {
+        real_order[i] = i;
+    }
+    sort(real_order.begin(), real_order.end(), [&clear_values](size_t i, size_t j){ return clear_values[i] > clear_values[j]; });
+    
+    Bitonic_EncTopK_Owner client(setup.encrypt(clear_values),n_top,nbits,setup.p,setup.randstate, lambda);
+    Bitonic_EncTopK_Helper server(nbits,k,n_top,setup.pp);
+    
+    delete t;
+    
+    timer_exec = new ScopedTimer("Protocol execution");
+    
+    runProtocol(client,server,setup.party_a_creator, setup.party_b_creator, setup.randstate,lambda);
+    
+    delete timer_exec;
+    
+    vector<size_t> mpc_top = client.output();
+    vector<mpz_class> enc_top = client.top_values();
+    
+    assert(mpc_top.size() == n_top);
+    for (size_t i = 0; i < n_top; i++) {
+        cout << "Real rank " << i << " = " << real_order[i] << ", found " << mpc_top[i] << endl;
+        // equal values can be ranked in any order
+        assert(clear_values[mpc_top[i]] == clear_values[real_order[i]]);
+        assert(setup.pp.decrypt(enc_top[i]) == clear_values[real_order[i]]);
+    }
+}
+
 /*
 static ZZX makeIrredPoly(long p, long d)
 {
@@ -560,23 +864,36 @@ int main(int argc, char **argv)
 
 //    test_lsic(l);
 //    test_compare(l);
+    test_pipelined_compare(l,t);
+    cout << "\n\n";
     
     for (int i = 0; i < 1; i++) {
         test_gc(l);
         cout << "\n\n";
     }
     
+    test_batch_gc(n,l);
+    cout << "\n\n";
+    
     
 //    test_enc_compare(l,lambda);
 //    cout << "\n\n";
 //    test_rev_enc_compare(l,lambda);
-
 //    cout << "\n\n";
+    test_threshold_enc_compare(n,l,lambda);
+    cout << "\n\n";
+
 //    test_enc_argmax(n,l,lambda,t);
 //    cout << "\n\n";
 //    test_linear_enc_argmax(n,l,lambda);
 //    cout << "\n\n";
 //    test_tree_enc_argmax(n,l,lambda);
+//    cout << "\n\n";
+    test_tournament_enc_argmax(n,l,lambda);
+    cout << "\n\n";
+    test_bitonic_enc_top_k(n,min(n,3u),l,lambda);
+    cout << "\n\n";
+    test_streaming_enc_argmax(n,8,l,lambda);
 //   
 //    cout << "\n\n";
 //    test_change_ES();
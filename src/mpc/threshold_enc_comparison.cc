@@ -0,0 +1,165 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#include <vector>
+#include <gmpxx.h>
+
+#include <mpc/threshold_enc_comparison.hh>
+
+using namespace std;
+
+
+Threshold_EncCompare_Owner::Threshold_EncCompare_Owner(const mpz_class &v, const vector<mpz_class> &thresholds, const size_t &l, Paillier &p, function<Comparison_protocol_B*()> comparator_creator, gmp_randstate_t state)
+: v_(v), thresholds_(thresholds), bit_length_(l), paillier_(p), comparators_(thresholds.size()), c_r_l_(thresholds.size()), two_l_(0), is_set_up_(false), is_protocol_done_(false)
+{
+    // its own random state, seeded from the caller's one
+    mpz_class seed;
+    mpz_urandomb(seed.get_mpz_t(), state, 256);
+    gmp_randinit_default(randstate_);
+    gmp_randseed(randstate_, seed.get_mpz_t());
+    mpz_setbit(two_l_.get_mpz_t(),bit_length_); // set two_l_ to 2^l
+    
+    for (size_t j = 0; j < thresholds_.size(); j++) {
+        assert(thresholds_[j] >= 0 && thresholds_[j] < two_l_);
+        comparators_[j] = comparator_creator();
+    }
+}
+
+Threshold_EncCompare_Owner::~Threshold_EncCompare_Owner()
+{
+    for (size_t j = 0; j < comparators_.size(); j++) {
+        delete comparators_[j];
+    }
+}
+
+mpz_class Threshold_EncCompare_Owner::setup(unsigned int lambda)
+{
+    mpz_class r, z;
+    
+    mpz_urandomb(r.get_mpz_t(), randstate_, lambda+bit_length_);
+    
+    // z = v + 2^l + r
+    z = paillier_.add(v_,paillier_.encrypt(two_l_ + r));
+    
+    for (size_t j = 0; j < thresholds_.size(); j++) {
+        // z = x_j + r_j with x_j = v - t_j + 2^l
+        mpz_class r_j = r + thresholds_[j];
+        
+        // c_j = r_j mod 2^l
+        comparators_[j]->set_value(r_j % two_l_);
+        
+        bool r_l = (bool)mpz_tstbit(r_j.get_mpz_t(),bit_length_); // gets the l-th bit of r_j
+        c_r_l_[j] = comparators_[j]->gm().encrypt(r_l);
+    }
+    is_set_up_ = true;
+    
+    return z;
+}
+
+void Threshold_EncCompare_Owner::decryptResult(const vector<mpz_class> &c_t)
+{
+    assert(c_t.size() == thresholds_.size());
+    t_ = vector<bool>(c_t.size());
+    
+    for (size_t j = 0; j < c_t.size(); j++) {
+        t_[j] = comparators_[j]->gm().decrypt(c_t[j]);
+    }
+    is_protocol_done_ = true;
+}
+
+size_t Threshold_EncCompare_Owner::bucket() const
+{
+    assert(is_protocol_done_);
+    size_t b = 0;
+    for (size_t j = 0; j < t_.size(); j++) {
+        b += t_[j];
+    }
+    return b;
+}
+
+
+Threshold_EncCompare_Helper::Threshold_EncCompare_Helper(const size_t &l, size_t m, Paillier_priv_fast &pp, function<Comparison_protocol_A*()> comparator_creator)
+: bit_length_(l), paillier_(pp), comparators_(m), two_l_(0), is_set_up_(false)
+{
+    mpz_setbit(two_l_.get_mpz_t(),bit_length_); // set two_l_ to 2^l
+    
+    for (size_t j = 0; j < m; j++) {
+        comparators_[j] = comparator_creator();
+    }
+}
+
+Threshold_EncCompare_Helper::~Threshold_EncCompare_Helper()
+{
+    for (size_t j = 0; j < comparators_.size(); j++) {
+        delete comparators_[j];
+    }
+}
+
+void Threshold_EncCompare_Helper::setup(const mpz_class &c_z)
+{
+    // one decryption for all the thresholds
+    mpz_class z = paillier_.decrypt(c_z);
+    mpz_class d = z % two_l_;
+    
+    for (size_t j = 0; j < comparators_.size(); j++) {
+        comparators_[j]->set_value(d);
+    }
+    
+    // the comparators outputs are fresh encryptions: the encryption of z_l can be shared
+    bool z_l = (bool)mpz_tstbit(z.get_mpz_t(),bit_length_);
+    if (comparators_.size() > 0) {
+        c_z_l_ = comparators_[0]->gm().encrypt(z_l);
+    }
+    is_set_up_ = true;
+}
+
+vector<mpz_class> Threshold_EncCompare_Helper::concludeProtocol(const vector<mpz_class> &c_r_l)
+{
+    assert(c_r_l.size() == comparators_.size());
+    c_t_ = vector<mpz_class>(comparators_.size());
+    
+    for (size_t j = 0; j < comparators_.size(); j++) {
+        mpz_class c_t_prime = comparators_[j]->output();
+        
+        // t_j = t'_j + z_l + r_j_l (over F_2)
+        c_t_[j] = comparators_[j]->gm().XOR(c_t_prime,c_r_l[j]);
+        c_t_[j] = comparators_[j]->gm().XOR(c_t_[j],c_z_l_);
+    }
+    
+    return c_t_;
+}
+
+void runProtocol(Threshold_EncCompare_Owner &owner, Threshold_EncCompare_Helper &helper, gmp_randstate_t state, unsigned int lambda)
+{
+    assert(owner.thresholds_number() == helper.thresholds_number());
+    
+    mpz_class c_z(owner.setup(lambda));
+    helper.setup(c_z);
+    
+    vector<Comparison_protocol_A*> comparators_A = helper.comparators();
+    vector<Comparison_protocol_B*> comparators_B = owner.comparators();
+    for (size_t j = 0; j < comparators_A.size(); j++) {
+        runProtocol(comparators_A[j],comparators_B[j],state);
+    }
+    
+    vector<mpz_class> c_t(helper.concludeProtocol(owner.get_c_r_l()));
+    
+    owner.decryptResult(c_t);
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <crypto/paillier.hh>
+#include <mpc/lsic.hh>
+#include <mpc/comparison_protocol.hh>
+
+// Comparison of an encrypted value v to m thresholds, known by the owner.
+// It is the protocol of EncCompare with a single blinding for all the
+// thresholds: with z = v + 2^l + r, we have z = x_j + r_j for
+// x_j = v - t_j + 2^l and r_j = r + t_j. The helper decrypts z once and
+// the m comparisons of d = z mod 2^l with c_j = r_j mod 2^l run as one batch.
+// The owner gets the bits [v >= t_j].
+
+// We use the same naming convention as EncCompare:
+// - the OWNER is the owner of the encrypted data
+// - the HELPER is the party that helps the owner to compare its data and has the secret key of the cyphertext
+
+// - variables prefixed by c_ are GM cyphertexts
+
+class Threshold_EncCompare_Owner {
+public:
+    // v is encrypted under the helper's key, the thresholds are in the clear, in [0, 2^l[
+    Threshold_EncCompare_Owner(const mpz_class &v, const std::vector<mpz_class> &thresholds, const size_t &l, Paillier &p, std::function<Comparison_protocol_B*()> comparator_creator, gmp_randstate_t state);
+    ~Threshold_EncCompare_Owner();
+    
+    mpz_class setup(unsigned int lambda); // lambda is the parameter for statistical security. r <- [0, 2^{l+lambda}[ \cap \Z
+    void decryptResult(const std::vector<mpz_class> &c_t);
+    // the j-th bit is true iff v >= thresholds[j]
+    std::vector<bool> output() const { assert(is_protocol_done_); return t_; }
+    // the number of thresholds lower or equal to v: the index of the bucket of v for sorted thresholds
+    size_t bucket() const;
+    
+    std::vector<Comparison_protocol_B*> comparators() const { return comparators_; }
+    std::vector<mpz_class> get_c_r_l() const { return c_r_l_; };
+    
+    bool is_set_up() const { return is_set_up_; }
+    size_t bit_length() const { return bit_length_; }
+    size_t thresholds_number() const { return thresholds_.size(); }
+    
+protected:
+    mpz_class v_;
+    std::vector<mpz_class> thresholds_;
+    size_t bit_length_;
+    Paillier paillier_;
+    std::vector<Comparison_protocol_B*> comparators_;
+    gmp_randstate_t randstate_;
+    
+    /* intermediate values */
+    std::vector<mpz_class> c_r_l_; // encryptions of the l-th bits of the r_j
+    
+    /* cached values */
+    mpz_class two_l_; // 2^l = 1 << bit_length_
+    bool is_set_up_;
+    
+    /* final output */
+    bool is_protocol_done_;
+    std::vector<bool> t_;
+};
+
+class Threshold_EncCompare_Helper {
+public:
+    Threshold_EncCompare_Helper(const size_t &l, size_t m, Paillier_priv_fast &pp, std::function<Comparison_protocol_A*()> comparator_creator);
+    ~Threshold_EncCompare_Helper();
+    
+    void setup(const mpz_class &c_z);
+    std::vector<mpz_class> concludeProtocol(const std::vector<mpz_class> &c_r_l);
+    
+    std::vector<Comparison_protocol_A*> comparators() const { return comparators_; }
+    
+    bool is_set_up() const { return is_set_up_; }
+    size_t bit_length() const { return bit_length_; }
+    size_t thresholds_number() const { return comparators_.size(); }
+    
+    // the GM encryptions of the result bits, under the owner's key
+    std::vector<mpz_class> encrypted_output() const { return c_t_; }
+protected:
+    size_t bit_length_;
+    Paillier_priv_fast paillier_;
+    std::vector<Comparison_protocol_A*> comparators_;
+    
+    /* intermediate values */
+    mpz_class c_z_l_; // encryption of the l-th bit of z
+    
+    /* cached values */
+    mpz_class two_l_; // 2^l = 1 << bit_length_
+    bool is_set_up_;
+    
+    /* encrypted output */
+    std::vector<mpz_class> c_t_;
+};
+
+void runProtocol(Threshold_EncCompare_Owner &owner, Threshold_EncCompare_Helper &helper, gmp_randstate_t state, unsigned int lambda = 100);
@@ -0,0 +1,295 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#include <mpc/tournament_enc_argmax.hh>
+#include <mpc/enc_argmax.hh>
+#include <algorithm>
+#include <limits>
+
+// the groups of a round of n elements: [g*fan_in, min((g+1)*fan_in, n))
+// a last group of a single element is not compared, it goes to the next round as is
+
+static size_t compared_groups_count(size_t n, size_t fan_in)
+{
+    size_t groups = n/fan_in;
+    if (n%fan_in > 1) {
+        groups++;
+    }
+    return groups;
+}
+
+static size_t group_size(size_t n, size_t fan_in, size_t g)
+{
+    return min(fan_in, n - g*fan_in);
+}
+
+// index, in a group, of the comparison between the i-th and the j-th element (j < i)
+static inline size_t pair_index(size_t i, size_t j)
+{
+    return i*(i-1)/2 + j;
+}
+
+
+Tournament_EncArgmax_Owner::Tournament_EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, size_t fan_in, Paillier &p, gmp_randstate_t state, unsigned int lambda)
+: k_(a.size()), fan_in_(fan_in), local_max_(k_), round_count_(0), lambda_(lambda), bit_length_(l), paillier_(p), is_protocol_done_(false)
+{
+    assert(k_ > 0);
+    assert(fan_in_ >= 2);
+    gmp_randinit_set(randstate_, state);
+    
+    perm_ = genRandomPermutation(k_,randstate_);
+
+    for (size_t i = 0; i < k_; i++) {
+        local_max_[i] = a[perm_[i]];
+    }
+}
+
+vector<Rev_EncCompare_Owner*> Tournament_EncArgmax_Owner::create_current_round_rev_enc_compare_owners(function<Comparison_protocol_A*()> comparator_creator)
+{
+    size_t n = local_max_.size();
+    vector<Rev_EncCompare_Owner*> owners;
+    
+    for (size_t g = 0; g < compared_groups_count(n, fan_in_); g++) {
+        size_t begin = g*fan_in_;
+        size_t size = group_size(n, fan_in_, g);
+        
+        for (size_t i = 1; i < size; i++) {
+            for (size_t j = 0; j < i; j++) {
+                owners.push_back(new Rev_EncCompare_Owner(local_max_[begin+i], local_max_[begin+j],bit_length_,paillier_,comparator_creator(),randstate_));
+            }
+        }
+    }
+    
+    return owners;
+}
+
+vector<mpz_class> Tournament_EncArgmax_Owner::next_round()
+{
+    assert(local_max_.size() > 1);
+
+    size_t n = local_max_.size();
+    // we don't care about the last value if it is alone in its group
+    if (n%fan_in_ == 1) {
+        n--;
+    }
+    vector<mpz_class> randomized_values(n);
+    noise_ = vector<mpz_class>(n);
+    
+    for (size_t i = 0; i<n; i++) {
+        mpz_urandomb(noise_[i].get_mpz_t(), randstate_, lambda_+bit_length_);
+        randomized_values[i] = paillier_.add(local_max_[i],paillier_.encrypt(noise_[i]));
+    }
+    
+    return randomized_values;
+}
+
+void Tournament_EncArgmax_Owner::update_local_max(const vector<mpz_class> &rand_local_max, const vector<mpz_class> &selectors)
+{
+    size_t n = local_max_.size();
+    size_t groups = compared_groups_count(n, fan_in_);
+    
+    assert(rand_local_max.size() == groups);
+    assert(selectors.size() == noise_.size());
+    
+    vector<mpz_class> new_local_max(groups);
+    
+    for (size_t g = 0; g < groups; g++) {
+        size_t begin = g*fan_in_;
+        size_t size = group_size(n, fan_in_, g);
+        
+        // remove the noise of the selected element
+        new_local_max[g] = rand_local_max[g];
+        for (size_t i = 0; i < size; i++) {
+            mpz_class r = paillier_.constMult(noise_[begin+i],selectors[begin+i]);
+            new_local_max[g] = paillier_.sub(new_local_max[g],r);
+        }
+    }
+    
+    if (n%fan_in_ == 1) {
+        new_local_max.push_back(local_max_[n-1]);
+    }
+    
+    local_max_ = new_local_max;
+    round_count_++;
+}
+
+void Tournament_EncArgmax_Owner::unpermuteResult(size_t argmax_perm)
+{
+    assert(argmax_perm < perm_.size());
+    i_0_ = perm_[argmax_perm];
+    
+    is_protocol_done_ = true;
+}
+
+Tournament_EncArgmax_Helper::Tournament_EncArgmax_Helper(const size_t &l, const size_t &k, size_t fan_in, Paillier_priv_fast &pp, Paillier_constants_pool *constants)
+: k_(k), fan_in_(fan_in), local_argmax_(k), round_count_(0), bit_length_(l), paillier_(pp), constants_(constants)
+{
+    assert(k_ > 0);
+    assert(fan_in_ >= 2);
+    
+    for (size_t i = 0; i < k_; i++) {
+        local_argmax_[i] = i;
+    }
+}
+
+size_t Tournament_EncArgmax_Helper::permuted_argmax() const
+{
+    assert(local_argmax_.size() == 1);
+    return local_argmax_[0];
+}
+
+void Tournament_EncArgmax_Helper::update_argmax(const vector<bool> &comp, const vector<mpz_class> &randomized_values, vector<mpz_class> &new_enc_max, vector<mpz_class> &selectors)
+{
+    size_t n = local_argmax_.size();
+    size_t groups = compared_groups_count(n, fan_in_);
+    size_t n_rand = (n%fan_in_ == 1) ? n-1 : n;
+    
+    assert(randomized_values.size() == n_rand);
+    
+    // we need fresh encryptions of 0 and 1 to ensure security
+    // the refresh of the maxima is a multiplication by another encryption of 0
+    vector<mpz_class> zeros, ones;
+    if (constants_) {
+        zeros = constants_->zeros(n_rand);
+        ones = constants_->ones(groups);
+    }else{
+        for (size_t i = 0; i < n_rand; i++) {
+            zeros.push_back(paillier_.encrypt(0));
+        }
+        for (size_t g = 0; g < groups; g++) {
+            ones.push_back(paillier_.encrypt(1));
+        }
+    }
+    
+    new_enc_max = vector<mpz_class>(groups);
+    selectors = vector<mpz_class>(n_rand);
+    vector<size_t> new_local_argmax(groups);
+    
+    size_t offset = 0; // first comparison of the group
+    size_t zero_index = 0;
+    for (size_t g = 0; g < groups; g++) {
+        size_t begin = g*fan_in_;
+        size_t size = group_size(n, fan_in_, g);
+        
+        // the comparison of (i,j), j < i, is true if the i-th element is smaller than the j-th
+        size_t winner = 0;
+        for (size_t i = 1; i < size; i++) {
+            if (!comp[offset + pair_index(i, winner)]) {
+                winner = i;
+            }
+        }
+        offset += size*(size-1)/2;
+        
+        new_local_argmax[g] = local_argmax_[begin+winner];
+        
+        for (size_t i = 0; i < size; i++) {
+            selectors[begin+i] = (i == winner) ? ones[g] : zeros[zero_index++];
+        }
+        
+        new_enc_max[g] = paillier_.add(randomized_values[begin+winner], zeros[zero_index++]);
+    }
+    assert(offset == comp.size());
+    
+    if (n%fan_in_ == 1) {
+        new_local_argmax.push_back(local_argmax_[n-1]);
+    }
+    
+    local_argmax_ = new_local_argmax;
+    round_count_++;
+}
+
+vector<Rev_EncCompare_Helper*> Tournament_EncArgmax_Helper::create_current_round_rev_enc_compare_helpers(function<Comparison_protocol_B*()> comparator_creator)
+{
+    size_t n = local_argmax_.size();
+    vector<Rev_EncCompare_Helper*> helpers;
+    
+    for (size_t g = 0; g < compared_groups_count(n, fan_in_); g++) {
+        size_t size = group_size(n, fan_in_, g);
+        for (size_t c = 0; c < size*(size-1)/2; c++) {
+            helpers.push_back(new Rev_EncCompare_Helper(bit_length_,paillier_,comparator_creator()));
+        }
+    }
+    
+    return helpers;
+}
+
+void runProtocol(Tournament_EncArgmax_Owner &owner, Tournament_EncArgmax_Helper &helper,function<Comparison_protocol_A*()> comparator_creator_A, function<Comparison_protocol_B*()> comparator_creator_B, gmp_randstate_t state, unsigned int lambda)
+{
+    while (owner.new_round_needed()) {
+        
+        vector<Rev_EncCompare_Owner*> rev_enc_owners = owner.create_current_round_rev_enc_compare_owners(comparator_creator_A);
+        
+        vector<Rev_EncCompare_Helper*> rev_enc_helpers = helper.create_current_round_rev_enc_compare_helpers(comparator_creator_B);
+
+        vector<bool> results (rev_enc_owners.size());
+        for (size_t i = 0; i < rev_enc_owners.size(); i++) {
+            runProtocol(*rev_enc_owners[i],*rev_enc_helpers[i],state, lambda);
+            results[i] = rev_enc_helpers[i]->output();
+            delete rev_enc_owners[i];
+            delete rev_enc_helpers[i];
+        }
+        
+        vector<mpz_class> randomized_enc_max = owner.next_round();
+        
+        vector<mpz_class> new_enc_max, selectors;
+        helper.update_argmax(results, randomized_enc_max, new_enc_max, selectors);
+        
+        owner.update_local_max(new_enc_max, selectors);
+    }
+    
+    owner.unpermuteResult(helper.permuted_argmax());
+}
+
+size_t tournament_rounds(size_t k, size_t fan_in)
+{
+    size_t rounds = 0;
+    for (size_t n = k; n > 1; n = compared_groups_count(n, fan_in) + (n%fan_in == 1 ? 1 : 0)) {
+        rounds++;
+    }
+    return rounds;
+}
+
+size_t tournament_comparisons(size_t k, size_t fan_in)
+{
+    size_t comparisons = 0;
+    for (size_t n = k; n > 1; n = compared_groups_count(n, fan_in) + (n%fan_in == 1 ? 1 : 0)) {
+        for (size_t g = 0; g < compared_groups_count(n, fan_in); g++) {
+            size_t size = group_size(n, fan_in, g);
+            comparisons += size*(size-1)/2;
+        }
+    }
+    return comparisons;
+}
+
+size_t plan_tournament_fan_in(size_t k, double round_latency_ms, double comparison_ms)
+{
+    size_t best = 2;
+    double best_cost = numeric_limits<double>::max();
+    
+    // beyond k, all the fan-ins give the same tournament
+    for (size_t f = 2; f <= max<size_t>(k, 2); f++) {
+        double cost = tournament_rounds(k, f)*round_latency_ms + tournament_comparisons(k, f)*comparison_ms;
+        if (cost < best_cost) {
+            best = f;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <mpc/rev_enc_comparison.hh>
+#include <crypto/paillier_pool.hh>
+
+#include <cstddef>
+#include <functional>
+#include <math/util_gmp_rand.h>
+
+using namespace  std;
+
+// Tournament argmax: at each round, the current maxima are split in groups of
+// fan_in elements and the maximum of each group is found by comparing all its
+// pairs. All the comparisons of a round are independent.
+// fan_in = 2 is the tree argmax, fan_in >= k the constant round argmax.
+
+class Tournament_EncArgmax_Owner {
+public:
+    Tournament_EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, size_t fan_in, Paillier &p, gmp_randstate_t state, unsigned int lambda = 100);
+    
+    void unpermuteResult(size_t argmax_perm);
+    size_t output() const { assert(is_protocol_done_); return i_0_;}
+
+    vector<Rev_EncCompare_Owner*> create_current_round_rev_enc_compare_owners(function<Comparison_protocol_A*()> comparator_creator);
+    vector<mpz_class> next_round();
+    // one randomized maximum per group and, for every randomized element, the encryption of 1 if it is the maximum of its group, 0 otherwise
+    void update_local_max(const vector<mpz_class> &rand_local_max, const vector<mpz_class> &selectors);
+    
+    size_t bit_length() const { return bit_length_; }
+    size_t elements_number() const { return k_; }
+    size_t fan_in() const { return fan_in_; }
+    
+    bool new_round_needed() const { return local_max_.size() != 1; };
+protected:
+    vector<size_t> perm_; // the permutation used to hide the real order
+    
+    size_t k_; // number of elements
+    size_t fan_in_;
+    vector<mpz_class> local_max_;
+    size_t round_count_;
+
+    unsigned int lambda_;
+    size_t bit_length_;
+    gmp_randstate_t randstate_;
+    Paillier paillier_;
+
+    /* intermediate value */
+    vector<mpz_class> noise_;
+    
+    /* final output */
+    bool is_protocol_done_;
+    size_t i_0_;
+};
+
+
+class Tournament_EncArgmax_Helper {
+public:
+    // the encryptions of 0 and 1 are taken from constants when it is not NULL
+    Tournament_EncArgmax_Helper(const size_t &l, const size_t &k, size_t fan_in, Paillier_priv_fast &pp, Paillier_constants_pool *constants = NULL);
+    
+    // comp are the results of the comparisons, in the order of create_current_round_rev_enc_compare_helpers
+    void update_argmax(const vector<bool> &comp, const vector<mpz_class> &randomized_values, vector<mpz_class> &new_enc_max, vector<mpz_class> &selectors);
+    
+    vector<Rev_EncCompare_Helper*> create_current_round_rev_enc_compare_helpers(function<Comparison_protocol_B*()> comparator_creator);
+
+    size_t permuted_argmax() const;
+    size_t elements_number() const { return k_; }
+    size_t bit_length() const { return bit_length_; }
+    size_t fan_in() const { return fan_in_; }
+    
+    bool new_round_needed() const { return local_argmax_.size() != 1; };
+
+protected:
+    size_t k_; // number of elements
+    size_t fan_in_;
+    vector<size_t> local_argmax_;
+    size_t round_count_;
+    size_t bit_length_;
+
+    Paillier_priv_fast paillier_;
+    Paillier_constants_pool *constants_;
+};
+
+void runProtocol(Tournament_EncArgmax_Owner &owner, Tournament_EncArgmax_Helper &helper,function<Comparison_protocol_A*()> comparator_creator_A, function<Comparison_protocol_B*()> comparator_creator_B, gmp_randstate_t state, unsigned int lambda = 100);
+
+/* Planning */
+
+// number of rounds and of comparisons of the tournament of k elements
+size_t tournament_rounds(size_t k, size_t fan_in);
+size_t tournament_comparisons(size_t k, size_t fan_in);
+
+// the fan-in that minimizes rounds*round_latency_ms + comparisons*comparison_ms
+// round_latency_ms is the network time of one round (the round trips of a batched comparison and of the refresh)
+// comparison_ms is the computation time of one comparison
+size_t plan_tournament_fan_in(size_t k, double round_latency_ms, double comparison_ms);
@@ -24,19 +24,15 @@
 
 
 Tree_EncArgmax_Owner::Tree_EncArgmax_Owner(const vector<mpz_class> &a, const size_t &l, Paillier &p, gmp_randstate_t state, unsigned int lambda)
-: a_(a), k_(a.size()), local_max_(k_), round_count_(0), lambda_(lambda), bit_length_(l), paillier_(p), is_protocol_done_(false)
+: k_(a.size()), local_max_(k_), round_count_(0), lambda_(lambda), bit_length_(l), paillier_(p), is_protocol_done_(false)
 {
     assert(k_ > 0);
     gmp_randinit_set(randstate_, state);
     
-    for (size_t i = 0; i < k_; i++) {
-        perm_[i] = i;
-    }
-
     perm_ = genRandomPermutation(k_,randstate_);
 
     for (size_t i = 0; i < k_; i++) {
-        local_max_[i] = a_[perm_[i]];
+        local_max_[i] = a[perm_[i]];
     }
 }
 
@@ -95,16 +91,14 @@ void Tree_EncArgmax_Owner::update_local_max(const vector<mpz_class> &rand_local_
 
 void Tree_EncArgmax_Owner::unpermuteResult(size_t argmax_perm)
 {
-    map<size_t,size_t>::iterator it;
-    it=perm_.find(argmax_perm);
-    
-    i_0_ = it->second;
+    assert(argmax_perm < perm_.size());
+    i_0_ = perm_[argmax_perm];
     
     is_protocol_done_ = true;
 }
 
-Tree_EncArgmax_Helper::Tree_EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp)
-: k_(k), local_argmax_(k), round_count_(0), bit_length_(l), argmax_perm_(0), paillier_(pp)
+Tree_EncArgmax_Helper::Tree_EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp, Paillier_constants_pool *constants)
+: k_(k), local_argmax_(k), round_count_(0), bit_length_(l), argmax_perm_(0), paillier_(pp), constants_(constants)
 {
     assert(k_ > 0);
     
@@ -128,11 +122,18 @@ void Tree_EncArgmax_Helper::update_argmax(vector<bool> comp, const vector<mpz_cl
     
     vector<size_t> new_local_argmax(n);
     
+    // we need fresh encryptions of 0 and 1 to ensure security
+    // the refresh of new_enc_max is a multiplication by another encryption of 0
+    vector<mpz_class> zeros, ones;
+    if (constants_) {
+        zeros = constants_->zeros(2*n);
+        ones = constants_->ones(n);
+    }
+    
     for (size_t i = 0; i<n; i++) {
         
-        // we need to generate fresh encryptions of 0 and 1 to ensure security
-        mpz_class zero = paillier_.encrypt(0);
-        mpz_class one = paillier_.encrypt(1);
+        mpz_class zero = constants_ ? zeros[i] : paillier_.encrypt(0);
+        mpz_class one = constants_ ? ones[i] : paillier_.encrypt(1);
 
         if (comp[i]) {
             new_enc_max[i] = old_enc_max[2*i+1];
@@ -146,7 +147,11 @@ void Tree_EncArgmax_Helper::update_argmax(vector<bool> comp, const vector<mpz_cl
             y[i] = zero;
         }
         
-        paillier_.refresh(new_enc_max[i]);
+        if (constants_) {
+            new_enc_max[i] = paillier_.add(new_enc_max[i], zeros[n+i]);
+        }else{
+            paillier_.refresh(new_enc_max[i]);
+        }
     }
     
     if (local_argmax_.size()%2 == 1) {
@@ -20,9 +20,10 @@
 
 #pragma once
 
-#include <map>
+#include <vector>
 
 #include <mpc/rev_enc_comparison.hh>
+#include <crypto/paillier_pool.hh>
 
 #include <cstddef>
 #include <functional>
@@ -46,8 +47,7 @@ public:
     
     bool new_round_needed() const { return local_max_.size() != 1; };
 protected:
-    vector<mpz_class> a_;
-    map<size_t,size_t> perm_; // the permutation used to hide the real order
+    vector<size_t> perm_; // the permutation used to hide the real order
     
     size_t k_; // number of elements
     vector<mpz_class> local_max_;
@@ -70,7 +70,8 @@ protected:
 
 class Tree_EncArgmax_Helper {
 public:
-    Tree_EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp);
+    // the encryptions of 0 and 1 are taken from constants when it is not NULL
+    Tree_EncArgmax_Helper(const size_t &l, const size_t &k,Paillier_priv_fast &pp, Paillier_constants_pool *constants = NULL);
         
     void update_argmax(vector<bool> comp, const vector<mpz_class> &old_enc_max, vector<mpz_class> &new_enc_max, vector<mpz_class> &x, vector<mpz_class> &y);
     
@@ -90,7 +91,7 @@ protected:
 
     size_t argmax_perm_;
     Paillier_priv_fast paillier_;
-    
+    Paillier_constants_pool *constants_;
 };
 
 void runProtocol(Tree_EncArgmax_Owner &owner, Tree_EncArgmax_Helper &helper,function<Comparison_protocol_A*()> comparator_creator_A, function<Comparison_protocol_B*()> comparator_creator_B, gmp_randstate_t state, unsigned int lambda = 100);
\ No newline at end of file
@@ -8,6 +8,12 @@
 
 #include <net/client.hh>
 #include <net/protocol_bench.hh>
+#include <net/link_emulator.hh>
+#include <net/defs.hh>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
 
 #include <util/util.hh>
 
@@ -91,7 +97,142 @@ static void bench_tree_garble(Bench_Client &client, unsigned int bit_size, unsig
     }
 }
 
-static void bench_client_argmax(const string &hostname, unsigned int key_size, unsigned int bit_size, unsigned int iterations, unsigned int n_threads, unsigned int n_elts_min, unsigned int n_elts_max, unsigned int step)
+// one round of an argmax, with its context
+struct Phase_row {
+    string strategy;
+    COMPARISON_PROTOCOL protocol;
+    unsigned int n_elts;
+    unsigned int bit_size;
+    double rtt_ms;
+    double bandwidth_mbps;
+    unsigned int iteration;
+    Round_timing timing;
+};
+
+static string protocol_name(COMPARISON_PROTOCOL comparison_prot)
+{
+    switch (comparison_prot) {
+        case LSIC_PROTOCOL:
+            return "LSIC";
+        case DGK_PROTOCOL:
+            return "DGK";
+        case GC_PROTOCOL:
+            return "GC";
+        default:
+            return "??";
+    }
+}
+
+static void write_phase_rows_csv(ostream &out, const vector<Phase_row> &rows)
+{
+    out << "strategy,protocol,n_elts,bit_size,rtt_ms,bandwidth_mbps,iteration,round,comparisons,setup_ms,comparison_ms,update_ms,io_wait_ms,serialization_ms,bytes,interactions\n";
+    for (const Phase_row &r : rows) {
+        const Round_timing &t = r.timing;
+        out << r.strategy << "," << protocol_name(r.protocol) << "," << r.n_elts << "," << r.bit_size << "," << r.rtt_ms << "," << r.bandwidth_mbps << "," << r.iteration << ",";
+        out << t.round << "," << t.comparisons << "," << t.setup_ms << "," << t.comparison_ms << "," << t.update_ms << "," << t.io_wait_ms << "," << t.serialization_ms << "," << t.bytes << "," << t.interactions << "\n";
+    }
+}
+
+static void write_phase_rows_json(ostream &out, const vector<Phase_row> &rows)
+{
+    out << "[\n";
+    for (size_t i = 0; i < rows.size(); i++) {
+        const Phase_row &r = rows[i];
+        const Round_timing &t = r.timing;
+        out << "  {\"strategy\": \"" << r.strategy << "\", \"protocol\": \"" << protocol_name(r.protocol) << "\", \"n_elts\": " << r.n_elts << ", \"bit_size\": " << r.bit_size;
+        out << ", \"rtt_ms\": " << r.rtt_ms << ", \"bandwidth_mbps\": " << r.bandwidth_mbps << ", \"iteration\": " << r.iteration;
+        out << ", \"round\": " << t.round << ", \"comparisons\": " << t.comparisons << ", \"setup_ms\": " << t.setup_ms << ", \"comparison_ms\": " << t.comparison_ms;
+        out << ", \"update_ms\": " << t.update_ms << ", \"io_wait_ms\": " << t.io_wait_ms << ", \"serialization_ms\": " << t.serialization_ms;
+        out << ", \"bytes\": " << t.bytes << ", \"interactions\": " << t.interactions << "}" << ((i+1 < rows.size()) ? ",\n" : "\n");
+    }
+    out << "]\n";
+}
+
+// Runs the linear and tree argmax with all the comparison protocols for every
+// round trip time of rtts, through a Link_emulator (unless the RTT and the
+// bandwidth are 0), and writes the timings of every round in output_file:
+// JSON if its name ends with .json, CSV otherwise.
+static void bench_client_argmax_phases(const string &hostname, unsigned short port, unsigned int key_size, unsigned int bit_size, unsigned int iterations, unsigned int n_threads, unsigned int n_elts_min, unsigned int n_elts_max, unsigned int step, const vector<double> &rtts, double bandwidth_mbps, const string &output_file)
+{
+    assert(n_elts_min <= n_elts_max);
+    assert(step > 0);
+    
+    vector<Phase_row> rows;
+    try
+    {
+#ifdef BENCHMARK
+        cout << "BENCHMARK flag set" << endl;
+        BENCHMARK_INIT
+#else
+        cout << "BENCHMARK flag not set: the I/O wait, serialization and byte counts are not measured" << endl;
+#endif
+        
+        gmp_randstate_t randstate;
+        gmp_randinit_default(randstate);
+        gmp_randseed_ui(randstate,time(NULL));
+        
+        for (double rtt : rtts) {
+            boost::asio::io_service io_service;
+            unique_ptr<Link_emulator> link;
+            
+            Bench_Client client(io_service, randstate,key_size,100);
+            client.set_n_threads(n_threads);
+            
+            if (rtt > 0 || bandwidth_mbps > 0) {
+                link.reset(new Link_emulator(hostname, port, rtt, bandwidth_mbps));
+                client.connect(io_service, "127.0.0.1", link->port());
+            }else{
+                client.connect(io_service, hostname, port);
+            }
+            
+            client.exchange_keys();
+            
+            for (const string &strategy : {"linear", "tree"}) {
+                for (COMPARISON_PROTOCOL prot : {LSIC_PROTOCOL, DGK_PROTOCOL, GC_PROTOCOL}) {
+                    for (unsigned int n_elts = n_elts_min; n_elts <= n_elts_max; n_elts += step) {
+                        cout << "\n" << strategy << " argmax, " << protocol_name(prot) << ", " << n_elts << " elements, RTT " << rtt << " ms" << endl;
+                        
+                        vector<vector<Round_timing>> timings;
+                        if (strategy == "linear") {
+                            client.bench_linear_enc_argmax(n_elts, bit_size, iterations, prot, &timings);
+                        }else{
+                            client.bench_tree_enc_argmax(n_elts, bit_size, iterations, prot, &timings);
+                        }
+                        
+                        for (size_t j = 0; j < timings.size(); j++) {
+                            for (const Round_timing &t : timings[j]) {
+                                rows.push_back({strategy, prot, n_elts, bit_size, rtt, bandwidth_mbps, (unsigned int)j, t});
+                            }
+                        }
+                    }
+                }
+            }
+            
+            client.disconnect();
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Exception: " << e.what() << std::endl;
+    }
+    
+    // write what we have, even after an error
+    ofstream out(output_file);
+    if (!out) {
+        cerr << "Could not open " << output_file << endl;
+        return;
+    }
+    
+    bool json = output_file.size() >= 5 && output_file.compare(output_file.size()-5, 5, ".json") == 0;
+    if (json) {
+        write_phase_rows_json(out, rows);
+    }else{
+        write_phase_rows_csv(out, rows);
+    }
+    cout << rows.size() << " rounds written to " << output_file << endl;
+}
+
+static void bench_client_argmax(const string &hostname, unsigned short port, unsigned int key_size, unsigned int bit_size, unsigned int iterations, unsigned int n_threads, unsigned int n_elts_min, unsigned int n_elts_max, unsigned int step)
 {
     assert(n_elts_min <= n_elts_max);
     assert(step > 0);
@@ -111,7 +252,7 @@ static void bench_client_argmax(const string &hostname, unsigned int key_size, u
         Bench_Client client(io_service, randstate,key_size,100);
         client.set_n_threads(n_threads);
         
-        client.connect(io_service, hostname);
+        client.connect(io_service, hostname, port);
         
         client.exchange_keys();
         
@@ -134,11 +275,24 @@ static void bench_client_argmax(const string &hostname, unsigned int key_size, u
     }
 }
 
+static vector<double> parse_list(const string &s)
+{
+    vector<double> values;
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, ',')) {
+        values.push_back(atof(item.c_str()));
+    }
+    return values;
+}
+
 int main(int argc, char* argv[])
 {
     if (argc < 8)
     {
         std::cerr << "Usage: bench_client <host> <key_size> <bit_size> <iterations> <n_threads> <n_elts_min> <n_elts_max> <step - optional>" << std::endl;
+        std::cerr << "       [--port <port>] [--phases <output.csv|output.json>] [--rtt <ms>[,<ms>...]] [--bandwidth <Mbit/s>]" << std::endl;
+        std::cerr << "--phases records the phases of every round in the output file, for the RTTs and the bandwidth emulated on a local relay" << std::endl;
         return 1;
     }
     string hostname(argv[1]);
@@ -149,12 +303,42 @@ int main(int argc, char* argv[])
     unsigned int n_elts_min = atoi(argv[6]);
     unsigned int n_elts_max = atoi(argv[7]);
     unsigned int step = 1;
+    int arg = 8;
     
-    if (argc >= 9) {
-        step = atoi(argv[8]);
+    if (argc > arg && string(argv[arg]).compare(0, 2, "--") != 0) {
+        step = atoi(argv[arg++]);
     }
     
-    bench_client_argmax(hostname, key_size, bit_size, iterations, n_threads, n_elts_min, n_elts_max, step);
+    unsigned short port = PORT;
+    string phases_file;
+    vector<double> rtts = {0};
+    double bandwidth = 0;
+    
+    for (; arg + 1 < argc; arg += 2) {
+        string option(argv[arg]);
+        if (option == "--port") {
+            port = atoi(argv[arg+1]);
+        }else if (option == "--phases") {
+            phases_file = argv[arg+1];
+        }else if (option == "--rtt") {
+            rtts = parse_list(argv[arg+1]);
+        }else if (option == "--bandwidth") {
+            bandwidth = atof(argv[arg+1]);
+        }else{
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    if (arg < argc) {
+        std::cerr << "Missing value for " << argv[arg] << std::endl;
+        return 1;
+    }
+    
+    if (phases_file.empty()) {
+        bench_client_argmax(hostname, port, key_size, bit_size, iterations, n_threads, n_elts_min, n_elts_max, step);
+    }else{
+        bench_client_argmax_phases(hostname, port, key_size, bit_size, iterations, n_threads, n_elts_min, n_elts_max, step, rtts, bandwidth, phases_file);
+    }
     
     return 0;
 }
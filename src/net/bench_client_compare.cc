@@ -6,6 +6,7 @@
 #include <mpc/linear_enc_argmax.hh>
 #include <mpc/tree_enc_argmax.hh>
 
+#include <net/defs.hh>
 #include <net/client.hh>
 #include <net/protocol_bench.hh>
 
@@ -13,7 +14,7 @@
 
 #include <util/benchmarks.hh>
 
-static void bench_client(const string &hostname, unsigned int key_size, unsigned int bit_size, unsigned int iterations, unsigned int n_threads)
+static void bench_client(const string &hostname, unsigned short port, unsigned int key_size, unsigned int bit_size, unsigned int iterations, unsigned int n_threads)
 {
     try
     {
@@ -31,7 +32,7 @@ static void bench_client(const string &hostname, unsigned int key_size, unsigned
         Bench_Client client(io_service, randstate,key_size,100);
         client.set_n_threads(n_threads);
         
-        client.connect(io_service, hostname);
+        client.connect(io_service, hostname, port);
         
         client.exchange_keys();
 
@@ -60,9 +61,9 @@ static void bench_client(const string &hostname, unsigned int key_size, unsigned
 
 int main(int argc, char* argv[])
 {
-    if (argc != 6)
+    if (argc != 6 && argc != 7)
     {
-        std::cerr << "Usage: bench_client <host> <key_size> <bit_size> <iterations> <n_threads>" << std::endl;
+        std::cerr << "Usage: bench_client <host> <key_size> <bit_size> <iterations> <n_threads> [port]" << std::endl;
         return 1;
     }
     string hostname(argv[1]);
@@ -70,8 +71,9 @@ int main(int argc, char* argv[])
     unsigned int bit_size = atoi(argv[3]);
     unsigned int iterations = atoi(argv[4]);
     unsigned int n_threads = atoi(argv[5]);
+    unsigned short port = (argc == 7) ? atoi(argv[6]) : PORT;
 
-    bench_client(hostname, key_size, bit_size, iterations, n_threads);
+    bench_client(hostname, port, key_size, bit_size, iterations, n_threads);
     
     return 0;
 }
\ No newline at end of file
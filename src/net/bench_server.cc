@@ -6,12 +6,13 @@
 #include <mpc/linear_enc_argmax.hh>
 #include <mpc/tree_enc_argmax.hh>
 
+#include <net/defs.hh>
 #include <net/server.hh>
 #include <net/protocol_bench.hh>
 
 #include <util/benchmarks.hh>
 
-static void bench_server(unsigned int key_size, unsigned int n_threads)
+static void bench_server(unsigned int key_size, unsigned int n_threads, unsigned short port, unsigned int n_acceptors)
 {
 #ifdef BENCHMARK
     cout << "BENCHMARK flag set" << endl;
@@ -24,7 +25,9 @@ static void bench_server(unsigned int key_size, unsigned int n_threads)
     
     cout << "Init server" << endl;
     Bench_Server server(randstate,key_size,100);
-    server.set_threads_per_session(n_threads);
+    server.set_crypto_thread_budget(n_threads);
+    server.set_port(port);
+    server.set_acceptor_threads(n_acceptors);
     
     cout << "Start server" << endl;
     server.run();
@@ -32,16 +35,18 @@ static void bench_server(unsigned int key_size, unsigned int n_threads)
 
 int main(int argc, char* argv[])
 {
-    if (argc != 3)
+    if (argc < 3 || argc > 5)
     {
-        std::cerr << "Usage: bench_server <key_size> <n_threads>" << std::endl;
+        std::cerr << "Usage: bench_server <key_size> <n_threads> [port] [acceptor_threads]" << std::endl;
         return 1;
     }
     
     unsigned int key_size = atoi(argv[1]);
     unsigned int n_threads = atoi(argv[2]);
+    unsigned short port = (argc > 3) ? atoi(argv[3]) : PORT;
+    unsigned int n_acceptors = (argc > 4) ? atoi(argv[4]) : 1;
 
-    bench_server(key_size, n_threads);
+    bench_server(key_size, n_threads, port, n_acceptors);
         
     return 0;
 }
\ No newline at end of file
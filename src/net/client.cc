@@ -1,5 +1,10 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <boost/asio.hpp>
 #include <gmpxx.h>
 
@@ -14,8 +19,12 @@
 #include <mpc/garbled_comparison.hh>
 #include <mpc/rev_enc_comparison.hh>
 #include <mpc/enc_comparison.hh>
+#include <mpc/enc_argmax.hh>
 #include <mpc/linear_enc_argmax.hh>
 #include <mpc/tree_enc_argmax.hh>
+#include <mpc/tournament_enc_argmax.hh>
+#include <mpc/bitonic_enc_top_k.hh>
+#include <mpc/streaming_enc_argmax.hh>
 
 #include <math/util_gmp_rand.h>
 
@@ -35,11 +44,15 @@ using boost::asio::ip::tcp;
 
 using namespace std;
 
-Client::Client(boost::asio::io_service& io_service, gmp_randstate_t state,Key_dependencies_descriptor key_deps_desc, unsigned int keysize, unsigned int lambda)
-: socket_(io_service),key_deps_desc_(key_deps_desc), gm_(NULL), paillier_(NULL), server_paillier_(NULL), server_gm_(NULL), fhe_context_(NULL), server_fhe_pk_(NULL), fhe_sk_(NULL), n_threads_(2), lambda_(lambda)
+Client::Client(boost::asio::io_service& io_service, gmp_randstate_t state,Key_dependencies_descriptor key_deps_desc, unsigned int keysize, unsigned int lambda, const string &session_file)
+: socket_(io_service),key_deps_desc_(key_deps_desc), gm_(NULL), paillier_(NULL), server_paillier_(NULL), server_gm_(NULL), fhe_context_(NULL), server_fhe_pk_(NULL), fhe_sk_(NULL), compression_(NO_COMPRESSION), session_file_(session_file), resumed_(false), n_threads_(2), lambda_(lambda)
 {
     gmp_randinit_set(rand_state_, state);
     
+    if (!session_file_.empty()) {
+        load_session(session_file_);
+    }
+    // the keys loaded from the session are not generated again
     init_needed_keys(keysize);
     
     ObliviousTransfer::init(OT_SECPARAM);
@@ -55,9 +68,14 @@ Client::~Client()
 
 
 void Client::connect(boost::asio::io_service& io_service, const string& hostname)
+{
+    connect(io_service, hostname, PORT);
+}
+
+void Client::connect(boost::asio::io_service& io_service, const string& hostname, unsigned short port)
 {
     tcp::resolver resolver(io_service);
-    tcp::resolver::query query(hostname, to_string( PORT ));
+    tcp::resolver::query query(hostname, to_string( port ));
     tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
     boost::asio::connect(socket_, endpoint_iterator);
 }
@@ -146,6 +164,14 @@ void Client::get_server_pk_paillier()
     server_paillier_ = create_from_pk_message(pk,rand_state_);
 }
 
+// use the best compression supported by both ends
+void Client::negotiate_compression()
+{
+    mpz_class offered = readIntFromSocket(socket_);
+    compression_ = (WIRE_COMPRESSION)min<unsigned long>(offered.get_ui(), SUPPORTED_WIRE_COMPRESSION);
+    sendIntToSocket(socket_, compression_);
+}
+
 void Client::get_fhe_context()
 {
     if (fhe_context_) {
@@ -189,7 +215,7 @@ void Client::send_fhe_pk()
 {
     const FHEPubKey& publicKey = *fhe_sk_; // cast so we only send the public informations
     
-    Protobuf::FHE_PK pk_message = get_pk_message(publicKey);
+    Protobuf::FHE_PK pk_message = get_pk_message(publicKey, compression_);
     
     sendMessageToSocket<Protobuf::FHE_PK>(socket_,pk_message);
     
@@ -197,6 +223,40 @@ void Client::send_fhe_pk()
 
 void Client::exchange_keys()
 {
+    bool use_fhe = key_deps_desc_.need_server_fhe || key_deps_desc_.need_client_fhe;
+
+    // ask to resume the previous session
+    Protobuf::Session_Ticket ticket_msg;
+    if (!ticket_.empty()) {
+        ticket_msg.set_id(ticket_);
+    }
+    sendMessageToSocket(socket_, ticket_msg);
+
+    Protobuf::Session_Ticket_Answer answer = readMessageFromSocket<Protobuf::Session_Ticket_Answer>(socket_);
+    resumed_ = answer.resumed();
+    ticket_ = answer.id();
+
+    if (resumed_) {
+        cout << "Session resumed" << endl;
+        if (use_fhe) {
+            negotiate_compression();
+        }
+        return;
+    }
+
+    // the server does not know us anymore: its keys might have changed
+    // our own GM and Paillier keys are still good
+    delete server_gm_;
+    server_gm_ = NULL;
+    delete server_paillier_;
+    server_paillier_ = NULL;
+    delete server_fhe_pk_;
+    server_fhe_pk_ = NULL;
+    delete fhe_sk_;
+    fhe_sk_ = NULL;
+    delete fhe_context_;
+    fhe_context_ = NULL;
+
     if (key_deps_desc_.need_server_gm) {
         get_server_pk_gm();
     }
@@ -211,9 +271,9 @@ void Client::exchange_keys()
         send_paillier_pk();
     }
     
-    if (key_deps_desc_.need_server_fhe ||
-        key_deps_desc_.need_client_fhe) {
+    if (use_fhe) {
         // if we use FHE, we need the context from the server before doing anything
+        negotiate_compression();
         get_fhe_context();
     }
     
@@ -225,6 +285,98 @@ void Client::exchange_keys()
         init_FHE_key();
         send_fhe_pk();
     }
+
+    if (!session_file_.empty()) {
+        save_session(session_file_);
+    }
+}
+
+bool Client::load_session(const string &path)
+{
+    ifstream file(path, ios::binary);
+    Protobuf::Client_Session_State state;
+    if (!file || !state.ParseFromIstream(&file)) {
+        return false;
+    }
+
+    if (state.has_gm_sk() && !gm_) {
+        gm_ = new GM_priv(convert_from_message(state.gm_sk()),rand_state_);
+    }
+    if (state.has_paillier_sk() && !paillier_) {
+        paillier_ = new Paillier_priv_fast(convert_from_message(state.paillier_sk()),rand_state_);
+    }
+    if (state.has_server_gm_pk() && !server_gm_) {
+        server_gm_ = create_from_pk_message(state.server_gm_pk(),rand_state_);
+    }
+    if (state.has_server_paillier_pk() && !server_paillier_) {
+        server_paillier_ = create_from_pk_message(state.server_paillier_pk(),rand_state_);
+    }
+    if (state.has_fhe_context() && !fhe_context_) {
+        fhe_context_ = create_from_message(state.fhe_context());
+        // we suppose d > 0
+        fhe_G_ = makeIrredPoly(FHE_p, FHE_d);
+    }
+    if (fhe_context_ && state.has_server_fhe_pk() && !server_fhe_pk_) {
+        server_fhe_pk_ = create_from_pk_message(state.server_fhe_pk(),*fhe_context_);
+    }
+    if (fhe_context_ && state.has_fhe_sk() && !fhe_sk_) {
+        fhe_sk_ = new FHESecKey(*fhe_context_);
+        istringstream is(state.fhe_sk());
+        is >> *fhe_sk_;
+    }
+
+    // only ask for resumption if we have everything the server would have sent
+    bool use_fhe = key_deps_desc_.need_server_fhe || key_deps_desc_.need_client_fhe;
+    bool complete = (!key_deps_desc_.need_client_gm || gm_)
+                    && (!key_deps_desc_.need_client_paillier || paillier_)
+                    && (!key_deps_desc_.need_server_gm || server_gm_)
+                    && (!key_deps_desc_.need_server_paillier || server_paillier_)
+                    && (!use_fhe || fhe_context_)
+                    && (!key_deps_desc_.need_server_fhe || server_fhe_pk_)
+                    && (!key_deps_desc_.need_client_fhe || fhe_sk_);
+
+    ticket_ = complete ? state.ticket() : "";
+    return true;
+}
+
+void Client::save_session(const string &path) const
+{
+    Protobuf::Client_Session_State state;
+    state.set_ticket(ticket_);
+
+    if (gm_) {
+        *state.mutable_gm_sk() = convert_to_message(gm_sk());
+    }
+    if (paillier_) {
+        *state.mutable_paillier_sk() = convert_to_message(paillier_->privkey());
+    }
+    if (server_gm_) {
+        *state.mutable_server_gm_pk() = get_pk_message(server_gm_);
+    }
+    if (server_paillier_) {
+        *state.mutable_server_paillier_pk() = get_pk_message(server_paillier_);
+    }
+    if (fhe_context_) {
+        *state.mutable_fhe_context() = convert_to_message(*fhe_context_);
+    }
+    if (server_fhe_pk_) {
+        *state.mutable_server_fhe_pk() = get_pk_message(*server_fhe_pk_);
+    }
+    if (fhe_sk_) {
+        ostringstream os;
+        os << *fhe_sk_;
+        state.set_fhe_sk(os.str());
+    }
+
+    // the file holds our secret keys: only we can read it
+    // (fchmod for a file that already existed with wider permissions)
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0 || fchmod(fd, S_IRUSR | S_IWUSR) != 0 || !state.SerializeToFileDescriptor(fd)) {
+        cerr << "Could not save the session to " << path << endl;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
 }
 
 mpz_class Client::run_comparison_protocol_A(Comparison_protocol_A *comparator)
@@ -387,15 +539,16 @@ vector<bool> Client::multiple_enc_comparison(const vector<mpz_class> &a, const v
 {
     assert(a.size() == b.size());
     size_t n = a.size();
-    vector<EncCompare_Owner*> owners(5);
+    vector<EncCompare_Owner*> owners(n);
+    
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
     
     for (size_t i = 0; i < n; i++) {
         owners[i] = new EncCompare_Owner(create_enc_comparator_owner(l, comparison_prot));
         owners[i]->set_input(a[i],b[i]);
     }
 
-    unsigned int thread_per_job = ceilf(((float)n_threads_)/n);
-    multiple_exec_enc_comparison_owner(socket_, owners, lambda_, true, thread_per_job);
+    multiple_exec_enc_comparison_owner(socket_, owners, lambda_, true, n_threads_);
     
     vector<bool> results(n);
     
@@ -409,34 +562,60 @@ vector<bool> Client::multiple_enc_comparison(const vector<mpz_class> &a, const v
 
 void Client::multiple_help_enc_comparison(const size_t n, const size_t &l, COMPARISON_PROTOCOL comparison_prot)
 {
-    vector<EncCompare_Helper*> helpers(5);
+    vector<EncCompare_Helper*> helpers(n);
+    
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
     
     for (size_t i = 0; i < n; i++) {
         helpers[i] = new EncCompare_Helper(create_enc_comparator_helper(l, comparison_prot));
         
     }
    
-    unsigned int thread_per_job = ceilf(((float)n_threads_)/n);
-    multiple_exec_enc_comparison_helper(socket_, helpers, true, thread_per_job);
+    multiple_exec_enc_comparison_helper(socket_, helpers, true, n_threads_);
     
     for (size_t i = 0; i < n; i++) {
         delete helpers[i];
     }
 }
 
+unique_ptr<Threshold_EncCompare_Owner> Client::run_threshold_enc_comparison_owner(const mpz_class &v, const vector<mpz_class> &thresholds, size_t l, COMPARISON_PROTOCOL comparison_prot)
+{
+    assert(has_paillier_pk());
+    assert(gm_!=NULL);
+    
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    function<Comparison_protocol_B*()> comparator_creator = comparator_creator_B(l, comparison_prot);
+    
+    unique_ptr<Threshold_EncCompare_Owner> owner(new Threshold_EncCompare_Owner(v, thresholds, l, *server_paillier_, comparator_creator, rand_state_));
+    exec_threshold_enc_comparison_owner(socket_, *owner, lambda_, true, n_threads_);
+    
+    return owner;
+}
+
+vector<bool> Client::threshold_enc_comparison(const mpz_class &v, const vector<mpz_class> &thresholds, size_t l, COMPARISON_PROTOCOL comparison_prot)
+{
+    return run_threshold_enc_comparison_owner(v, thresholds, l, comparison_prot)->output();
+}
+
+size_t Client::enc_bucket(const mpz_class &v, const vector<mpz_class> &thresholds, size_t l, COMPARISON_PROTOCOL comparison_prot)
+{
+    return run_threshold_enc_comparison_owner(v, thresholds, l, comparison_prot)->bucket();
+}
+
 void Client::multiple_rev_enc_comparison(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot)
 {
     assert(a.size() == b.size());
     size_t n = a.size();
     vector<Rev_EncCompare_Owner*> owners(n);
     
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    
     for (size_t i = 0; i < n; i++) {
         owners[i] = new Rev_EncCompare_Owner(create_rev_enc_comparator_owner(l, comparison_prot));
         owners[i]->set_input(a[i],b[i]);
     }
     
-    unsigned int thread_per_job = ceilf(((float)n_threads_)/n);
-multiple_exec_rev_enc_comparison_owner(socket_, owners, lambda_, true, thread_per_job);
+    multiple_exec_rev_enc_comparison_owner(socket_, owners, lambda_, true, n_threads_);
     
     
     for (size_t i = 0; i < n; i++) {
@@ -450,13 +629,14 @@ vector<bool> Client::multiple_help_rev_enc_comparison(const size_t n, const size
 {
     vector<Rev_EncCompare_Helper*> helpers(n);
     
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    
     for (size_t i = 0; i < n; i++) {
         helpers[i] = new Rev_EncCompare_Helper(create_rev_enc_comparator_helper(l, comparison_prot));
         
     }
     
-    unsigned int thread_per_job = ceilf(((float)n_threads_)/n);
-    multiple_exec_rev_enc_comparison_helper(socket_, helpers, true, thread_per_job);
+    multiple_exec_rev_enc_comparison_helper(socket_, helpers, true, n_threads_);
     
     vector<bool> results(n);
     for (size_t i = 0; i < n; i++) {
@@ -467,44 +647,155 @@ vector<bool> Client::multiple_help_rev_enc_comparison(const size_t n, const size
     return results;
 }
 
-size_t Client::run_linear_enc_argmax(Linear_EncArgmax_Owner &owner, COMPARISON_PROTOCOL comparison_prot)
+vector<mpz_class> Client::multiple_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot)
+{
+    assert(a.size() == b.size());
+    size_t n = a.size();
+    vector<Rev_EncCompare_Owner*> owners(n);
+    
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    
+    for (size_t i = 0; i < n; i++) {
+        owners[i] = new Rev_EncCompare_Owner(create_rev_enc_comparator_owner(l, comparison_prot));
+        owners[i]->set_input(a[i],b[i]);
+    }
+    
+    multiple_exec_rev_enc_comparison_owner(socket_, owners, lambda_, false, n_threads_);
+    
+    vector<mpz_class> results(n);
+    for (size_t i = 0; i < n; i++) {
+        results[i] = owners[i]->encrypted_output();
+        delete owners[i];
+    }
+    
+    return results;
+}
+
+void Client::multiple_help_enc_comparison_enc_result(const size_t n, const size_t &l, COMPARISON_PROTOCOL comparison_prot)
+{
+    vector<Rev_EncCompare_Helper*> helpers(n);
+    
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    
+    for (size_t i = 0; i < n; i++) {
+        helpers[i] = new Rev_EncCompare_Helper(create_rev_enc_comparator_helper(l, comparison_prot));
+    }
+    
+    multiple_exec_rev_enc_comparison_helper(socket_, helpers, false, n_threads_);
+    
+    for (size_t i = 0; i < n; i++) {
+        delete helpers[i];
+    }
+}
+
+size_t Client::run_linear_enc_argmax(Linear_EncArgmax_Owner &owner, COMPARISON_PROTOCOL comparison_prot, vector<Round_timing> *timings)
 {
     assert(has_paillier_pk());
     assert(has_gm_pk());
     
     size_t nbits = owner.bit_length();
-    function<Comparison_protocol_A*()> comparator_creator;
-    
-    if (comparison_prot == LSIC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new LSIC_A(0,nbits,*server_gm_); };
-    }else if (comparison_prot == DGK_PROTOCOL){
-        comparator_creator = [this,nbits](){ return new Compare_A(0,nbits,*server_paillier_,*server_gm_,rand_state_); };
-    }else if (comparison_prot == GC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new GC_Compare_A(0,nbits,*server_gm_, rand_state_); };
-    }
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    function<Comparison_protocol_A*()> comparator_creator = comparator_creator_A(nbits, comparison_prot);
 
-    exec_linear_enc_argmax(socket_,owner, comparator_creator, lambda_, n_threads_);
+    exec_linear_enc_argmax(socket_,owner, comparator_creator, lambda_, n_threads_, timings);
     
     return owner.output();
 }
 
-size_t Client::run_tree_enc_argmax(Tree_EncArgmax_Owner &owner, COMPARISON_PROTOCOL comparison_prot)
+size_t Client::run_tree_enc_argmax(Tree_EncArgmax_Owner &owner, COMPARISON_PROTOCOL comparison_prot, vector<Round_timing> *timings)
 {
     assert(has_paillier_pk());
     assert(has_gm_pk());
     
     size_t nbits = owner.bit_length();
-    function<Comparison_protocol_A*()> comparator_creator;
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    function<Comparison_protocol_A*()> comparator_creator = comparator_creator_A(nbits, comparison_prot);
+
+    exec_tree_enc_argmax(socket_,owner, comparator_creator, lambda_, n_threads_, timings);
     
-    if (comparison_prot == LSIC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new LSIC_A(0,nbits,*server_gm_); };
-    }else if (comparison_prot == DGK_PROTOCOL){
-        comparator_creator = [this,nbits](){ return new Compare_A(0,nbits,*server_paillier_,*server_gm_,rand_state_); };
-    }else if (comparison_prot == GC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new GC_Compare_A(0,nbits,*server_gm_, rand_state_); };
+    return owner.output();
+}
+
+vector<size_t> Client::multiple_run_tree_enc_argmax(vector<Tree_EncArgmax_Owner*> &owners, COMPARISON_PROTOCOL comparison_prot)
+{
+    assert(has_paillier_pk());
+    assert(has_gm_pk());
+    
+    vector<size_t> results(owners.size());
+    if (owners.empty()) {
+        return results;
+    }
+    
+    size_t nbits = owners[0]->bit_length();
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    function<Comparison_protocol_A*()> comparator_creator = comparator_creator_A(nbits, comparison_prot);
+    
+    multiple_exec_tree_enc_argmax(socket_,owners, comparator_creator, lambda_, n_threads_);
+    
+    for (size_t i = 0; i < owners.size(); i++) {
+        results[i] = owners[i]->output();
+    }
+    return results;
+}
+
+size_t Client::run_tournament_enc_argmax(const vector<mpz_class> &a, size_t nbits, COMPARISON_PROTOCOL comparison_prot)
+{
+    assert(has_paillier_pk());
+    assert(has_gm_pk());
+    
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    function<Comparison_protocol_A*()> comparator_creator = comparator_creator_A(nbits, comparison_prot);
+    
+    size_t fan_in = readIntFromSocket(socket_).get_ui();
+    if (fan_in < 2) {
+        throw std::runtime_error("Invalid tournament fan-in");
     }
+    
+    Tournament_EncArgmax_Owner owner(a, nbits, fan_in, *server_paillier_, rand_state_, lambda_);
+    exec_tournament_enc_argmax(socket_, owner, comparator_creator, lambda_, n_threads_);
+    
+    return owner.output();
+}
+
+vector<size_t> Client::run_enc_top_k(const vector<mpz_class> &a, size_t nbits, size_t n_top, COMPARISON_PROTOCOL comparison_prot)
+{
+    assert(has_paillier_pk());
+    assert(has_gm_pk());
+    
+    Bitonic_EncTopK_Owner owner(a,n_top,nbits,*server_paillier_,rand_state_,lambda_);
+    
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    function<Comparison_protocol_A*()> comparator_creator = comparator_creator_A(nbits, comparison_prot);
+    
+    exec_bitonic_enc_top_k(socket_, owner, comparator_creator, lambda_, n_threads_);
+    
+    return owner.output();
+}
 
-    exec_tree_enc_argmax(socket_,owner, comparator_creator, lambda_, n_threads_);
+size_t Client::run_streaming_enc_argmax(function<vector<mpz_class>()> next_chunk, size_t nbits, COMPARISON_PROTOCOL comparison_prot)
+{
+    assert(has_paillier_pk());
+    assert(has_gm_pk());
+    
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    function<Comparison_protocol_A*()> comparator_creator = comparator_creator_A(nbits, comparison_prot);
+    
+    Streaming_EncArgmax_Owner owner(nbits, *server_paillier_, rand_state_, lambda_);
+    exec_streaming_enc_argmax(socket_, owner, next_chunk, comparator_creator, lambda_, n_threads_);
+    
+    return owner.output();
+}
+
+size_t Client::run_enc_argmax(const vector<mpz_class> &a, size_t nbits, COMPARISON_PROTOCOL comparison_prot)
+{
+    assert(has_paillier_pk());
+    assert(has_gm_pk());
+    
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+    function<Comparison_protocol_A*()> comparator_creator = comparator_creator_A(nbits, comparison_prot);
+    
+    EncArgmax_Owner owner(a, nbits, *server_paillier_, comparator_creator, rand_state_);
+    exec_enc_argmax(socket_, owner, lambda_, n_threads_);
     
     return owner.output();
 }
@@ -519,7 +810,7 @@ Ctxt Client::change_encryption_scheme(const vector<mpz_class> &c_gm)
 void Client::run_change_encryption_scheme_slots_helper()
 {
     EncryptedArray ea(*fhe_context_, fhe_G_);
-    exec_change_encryption_scheme_slots_helper(socket_, *gm_, *fhe_sk_, ea);
+    exec_change_encryption_scheme_slots_helper(socket_, *gm_, *fhe_sk_, ea, compression_);
 }
 
 
@@ -528,81 +819,100 @@ mpz_class Client::compute_dot_product(const vector<mpz_class> &x)
     return exec_compute_dot_product(socket_, x, *server_paillier_);
 }
 
+vector<mpz_class> Client::multiple_compute_dot_product(const vector<vector<mpz_class>> &xs)
+{
+    return multiple_exec_compute_dot_product(socket_, xs, *server_paillier_, n_threads_);
+}
+
 void Client::help_compute_dot_product(const vector<mpz_class> &y, bool encrypted_input)
 {
     exec_help_compute_dot_product(socket_, y, *paillier_, encrypted_input);
 }
 
 
-EncCompare_Owner Client::create_enc_comparator_owner(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
+COMPARISON_PROTOCOL Client::resolve_comparison_protocol(COMPARISON_PROTOCOL comparison_prot)
 {
-    assert(has_paillier_pk());
-    assert(gm_!=NULL);
-
-    Comparison_protocol_B *comparator;
+    if (comparison_prot != ADAPTIVE_PROTOCOL) {
+        return comparison_prot;
+    }
+    
+    mpz_class prot = readIntFromSocket(socket_);
     
+    if (prot < LSIC_PROTOCOL || prot > GC_PROTOCOL) {
+        throw std::runtime_error("Invalid comparison protocol");
+    }
+    
+    return (COMPARISON_PROTOCOL)prot.get_ui();
+}
+
+function<Comparison_protocol_A*()> Client::comparator_creator_A(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
+{
     if (comparison_prot == LSIC_PROTOCOL) {
-        comparator = new LSIC_B(0,bit_size,*gm_);
+        return [this,bit_size](){ return new LSIC_A(0,bit_size,*server_gm_); };
+    }else if (comparison_prot == DGK_PROTOCOL){
+        return [this,bit_size](){ return new Compare_A(0,bit_size,*server_paillier_,*server_gm_,rand_state_); };
+    }else if (comparison_prot == GC_PROTOCOL) {
+        return [this,bit_size](){ return new GC_Compare_A(0,bit_size,*server_gm_, rand_state_); };
+    }
+    throw std::runtime_error("Invalid comparison protocol");
+}
+
+function<Comparison_protocol_B*()> Client::comparator_creator_B(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
+{
+    if (comparison_prot == LSIC_PROTOCOL) {
+        return [this,bit_size](){ return new LSIC_B(0,bit_size,*gm_); };
     }else if (comparison_prot == DGK_PROTOCOL){
         assert(paillier_ != NULL);
-        comparator = new Compare_B(0,bit_size,*paillier_,*gm_);
+        return [this,bit_size](){ return new Compare_B(0,bit_size,*paillier_,*gm_); };
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_B(0,bit_size,*gm_, rand_state_);
+        return [this,bit_size](){ return new GC_Compare_B(0,bit_size,*gm_, rand_state_); };
     }
+    throw std::runtime_error("Invalid comparison protocol");
+}
+
+EncCompare_Owner Client::create_enc_comparator_owner(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
+{
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+
+    assert(has_paillier_pk());
+    assert(gm_!=NULL);
+
+    Comparison_protocol_B *comparator = comparator_creator_B(bit_size, comparison_prot)();
 
     return EncCompare_Owner(0,0,bit_size,*server_paillier_,comparator,rand_state_);
 }
 
 EncCompare_Helper Client::create_enc_comparator_helper(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
 {
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+
     assert(paillier_ != NULL);
 
-    Comparison_protocol_A *comparator;
-    
-    if (comparison_prot == LSIC_PROTOCOL) {
-        comparator = new LSIC_A(0,bit_size,*server_gm_);
-    }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_A(0,bit_size,*server_paillier_,*server_gm_,rand_state_);
-    }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_A(0,bit_size,*server_gm_, rand_state_);
-    }
+    Comparison_protocol_A *comparator = comparator_creator_A(bit_size, comparison_prot)();
     
     return EncCompare_Helper(bit_size,*paillier_,comparator);
 }
 
 Rev_EncCompare_Owner Client::create_rev_enc_comparator_owner(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
 {
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+
     assert(has_paillier_pk());
     assert(has_gm_pk());
 
-    Comparison_protocol_A *comparator;
-    
-    if (comparison_prot == LSIC_PROTOCOL) {
-        comparator = new LSIC_A(0,bit_size,*server_gm_);
-    }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_A(0,bit_size,*server_paillier_,*server_gm_,rand_state_);
-    }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_A(0,bit_size,*server_gm_, rand_state_);
-    }
+    Comparison_protocol_A *comparator = comparator_creator_A(bit_size, comparison_prot)();
     
     return Rev_EncCompare_Owner(0,0,bit_size,*server_paillier_,comparator,rand_state_);
 }
 
 Rev_EncCompare_Helper Client::create_rev_enc_comparator_helper(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
 {
+    comparison_prot = resolve_comparison_protocol(comparison_prot);
+
     assert(gm_!=NULL);
     assert(paillier_ != NULL);
 
-    Comparison_protocol_B *comparator;
-    
-    if (comparison_prot == LSIC_PROTOCOL) {
-        comparator = new LSIC_B(0,bit_size,*gm_);
-    }else if (comparison_prot == DGK_PROTOCOL){
-        assert(paillier_ != NULL);
-        comparator = new Compare_B(0,bit_size,*paillier_,*gm_);
-    }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_B(0,bit_size,*gm_, rand_state_);
-    }
+    Comparison_protocol_B *comparator = comparator_creator_B(bit_size, comparison_prot)();
     
     return Rev_EncCompare_Helper(bit_size,*paillier_,comparator);
 }
\ No newline at end of file
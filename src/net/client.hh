@@ -2,9 +2,13 @@
 
 #include <gmpxx.h>
 #include <vector>
+#include <memory>
 #include <boost/asio.hpp>
 
 #include <mpc/garbled_comparison.hh>
+#include <mpc/threshold_enc_comparison.hh>
+#include <mpc/linear_enc_argmax.hh>
+#include <mpc/tree_enc_argmax.hh>
 
 #include <FHE.h>
 
@@ -13,16 +17,24 @@
 
 #include <net/key_deps_descriptor.hh>
 
+#include <util/benchmarks.hh>
+
+#include <protobuf/protobuf_conversion.hh>
+
 using boost::asio::ip::tcp;
 
 using namespace std;
 
 class Client {
 public:
-    Client(boost::asio::io_service& io_service, gmp_randstate_t state,Key_dependencies_descriptor key_deps_desc, unsigned int keysize, unsigned int lambda);
+    // if session_file is not empty, the keys are loaded from this file (if it exists) and
+    // the session is resumed if the server still knows it. The file is updated after a full key exchange.
+    Client(boost::asio::io_service& io_service, gmp_randstate_t state,Key_dependencies_descriptor key_deps_desc, unsigned int keysize, unsigned int lambda, const string &session_file = "");
     ~Client();
     
+    // hostname can be a name, an IPv4 or an IPv6 address
     void connect(boost::asio::io_service& io_service, const string& hostname);
+    void connect(boost::asio::io_service& io_service, const string& hostname, unsigned short port);
 
     tcp::socket& socket() { return socket_; }
     
@@ -42,6 +54,7 @@ public:
     bool has_fhe_pk() const { return (server_fhe_pk_ != NULL); }
     void get_server_pk_gm();
     void get_server_pk_paillier();
+    void negotiate_compression();
     void get_fhe_context();
     void get_server_pk_fhe();
     
@@ -50,6 +63,12 @@ public:
     void send_fhe_pk();
 
     void exchange_keys();
+
+    /* Session resumption */
+    // return false if the file cannot be read
+    bool load_session(const string &path);
+    void save_session(const string &path) const;
+    bool resumed_session() const { return resumed_; }
     
     mpz_class run_comparison_protocol_A(Comparison_protocol_A *comparator);
     mpz_class run_lsic_A(LSIC_A *lsic);
@@ -78,15 +97,24 @@ public:
     vector<bool> multiple_enc_comparison(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot);
     void multiple_help_enc_comparison(const size_t n, const size_t &l, COMPARISON_PROTOCOL comparison_prot);
 
+    // the bits [v >= thresholds[j]], v encrypted under the server's key
+    vector<bool> threshold_enc_comparison(const mpz_class &v, const vector<mpz_class> &thresholds, size_t l, COMPARISON_PROTOCOL comparison_prot);
+    // the number of thresholds lower or equal to v: its bucket for sorted thresholds
+    size_t enc_bucket(const mpz_class &v, const vector<mpz_class> &thresholds, size_t l, COMPARISON_PROTOCOL comparison_prot);
+    
     void multiple_rev_enc_comparison(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot);
     vector<bool> multiple_help_rev_enc_comparison(const size_t n, const size_t &l, COMPARISON_PROTOCOL comparison_prot);
 
+    vector<mpz_class> multiple_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot);
+    void multiple_help_enc_comparison_enc_result(const size_t n, const size_t &l, COMPARISON_PROTOCOL comparison_prot);
+
     /* other protocols */
 
     Ctxt change_encryption_scheme(const vector<mpz_class> &c_gm);
     void run_change_encryption_scheme_slots_helper();
 
     mpz_class compute_dot_product(const vector<mpz_class> &x);
+    vector<mpz_class> multiple_compute_dot_product(const vector<vector<mpz_class>> &xs);
     void help_compute_dot_product(const vector<mpz_class> &y, bool encrypted_input = false);
     
     /* calls to the comparison owner and helper objects */
@@ -101,14 +129,31 @@ public:
     void run_enc_comparison_owner_enc_result(EncCompare_Owner &owner);
     mpz_class run_enc_comparison_helper_enc_result(EncCompare_Helper &helper);
 
-    size_t run_linear_enc_argmax(Linear_EncArgmax_Owner &owner, COMPARISON_PROTOCOL comparison_prot);
-    size_t run_tree_enc_argmax(Tree_EncArgmax_Owner &owner, COMPARISON_PROTOCOL comparison_prot);
+    // if timings is not NULL, the timings of the rounds are appended to it
+    size_t run_linear_enc_argmax(Linear_EncArgmax_Owner &owner, COMPARISON_PROTOCOL comparison_prot, vector<Round_timing> *timings = NULL);
+    size_t run_tree_enc_argmax(Tree_EncArgmax_Owner &owner, COMPARISON_PROTOCOL comparison_prot, vector<Round_timing> *timings = NULL);
+    vector<size_t> multiple_run_tree_enc_argmax(vector<Tree_EncArgmax_Owner*> &owners, COMPARISON_PROTOCOL comparison_prot);
+    // tournament argmax of the values (encrypted under the server's key), with the fan-in chosen by the server
+    size_t run_tournament_enc_argmax(const vector<mpz_class> &a, size_t nbits, COMPARISON_PROTOCOL comparison_prot);
+    // indices of the n_top greatest values (encrypted under the server's key), the greatest first
+    vector<size_t> run_enc_top_k(const vector<mpz_class> &a, size_t nbits, size_t n_top, COMPARISON_PROTOCOL comparison_prot);
+    // argmax of candidates (encrypted under the server's key) given by chunks, until next_chunk returns an empty vector
+    size_t run_streaming_enc_argmax(function<vector<mpz_class>()> next_chunk, size_t nbits, COMPARISON_PROTOCOL comparison_prot);
+    // constant round argmax of the values (encrypted under the server's key)
+    size_t run_enc_argmax(const vector<mpz_class> &a, size_t nbits, COMPARISON_PROTOCOL comparison_prot);
 
     /* to build comparators */
+    // get the protocol chosen by the server when comparison_prot is ADAPTIVE_PROTOCOL
+    COMPARISON_PROTOCOL resolve_comparison_protocol(COMPARISON_PROTOCOL comparison_prot);
+    // comparators of bit_size bits for a resolved protocol: party A uses the server's keys, party B the client's
+    function<Comparison_protocol_A*()> comparator_creator_A(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
+    function<Comparison_protocol_B*()> comparator_creator_B(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
     EncCompare_Owner create_enc_comparator_owner(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
     EncCompare_Helper create_enc_comparator_helper(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
     Rev_EncCompare_Owner create_rev_enc_comparator_owner(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
     Rev_EncCompare_Helper create_rev_enc_comparator_helper(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
+    // runs the comparison of v to the thresholds and returns the owner, to read its result
+    unique_ptr<Threshold_EncCompare_Owner> run_threshold_enc_comparison_owner(const mpz_class &v, const vector<mpz_class> &thresholds, size_t l, COMPARISON_PROTOCOL comparison_prot);
 
     unsigned int n_threads() const { return n_threads_; }
     void set_n_threads(unsigned int n) { assert(n > 0); n_threads_ = n; }
@@ -126,6 +171,12 @@ protected:
     FHEPubKey *server_fhe_pk_;
     FHESecKey *fhe_sk_;
     ZZX fhe_G_;
+    
+    WIRE_COMPRESSION compression_;
+
+    string session_file_;
+    string ticket_;
+    bool resumed_;
 
     gmp_randstate_t rand_state_;
     
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <memory>
+#include <exception>
+#include <boost/asio.hpp>
+
+#include <crypto/paillier.hh>
+#include <mpc/lsic.hh>
+#include <mpc/private_comparison.hh>
+#include <mpc/garbled_comparison.hh>
+
+#include <net/comparison_cost_model.hh>
+#include <net/exec_protocol.hh>
+
+#include <util/util.hh>
+#include <util/benchmarks.hh>
+
+using boost::asio::ip::tcp;
+
+using namespace std;
+
+// weight of a new sample in the RTT estimate (same as TCP's SRTT)
+#define RTT_ALPHA 0.125
+
+/* default values, used until the model is calibrated: 1024 bits keys */
+/* LSIC: one round trip and two GM ciphertexts per bit */
+static const Comparison_cost lsic_default__ = {0.15, 256, 2, 0};
+/* DGK: l Paillier and l GM ciphertexts, three flights */
+static const Comparison_cost dgk_default__ = {1.0, 384, 0, 3};
+/* GC: ~one gate and one OT per bit, OT dominates the traffic */
+static const Comparison_cost gc_default__ = {0.05, 450, 0, 6};
+
+Comparison_cost_model::Comparison_cost_model()
+: lsic_cost_(lsic_default__), dgk_cost_(dgk_default__), gc_cost_(gc_default__), rtt_ms_(1.0), bandwidth_(12500)
+{
+}
+
+static Comparison_cost measure_protocol(COMPARISON_PROTOCOL prot, size_t l, GM_priv &gm_priv, Paillier_priv_fast &paillier_priv, gmp_randstate_t state, const Comparison_cost &fallback)
+{
+    GM gm(gm_priv.pubkey(), state);
+    Paillier paillier(paillier_priv.pubkey(), state);
+
+    gmp_randstate_t state_b;
+    gmp_randinit_set(state_b, state);
+
+    unique_ptr<Comparison_protocol_A> party_a;
+    unique_ptr<Comparison_protocol_B> party_b;
+
+    if (prot == LSIC_PROTOCOL) {
+        party_a.reset(new LSIC_A(0,l,gm));
+        party_b.reset(new LSIC_B(0,l,gm_priv));
+    }else if (prot == DGK_PROTOCOL){
+        party_a.reset(new Compare_A(0,l,paillier,gm,state));
+        party_b.reset(new Compare_B(0,l,paillier_priv,gm_priv));
+    }else{
+        party_a.reset(new GC_Compare_A(0,l,gm,state));
+        party_b.reset(new GC_Compare_B(0,l,gm_priv,state_b));
+    }
+
+    mpz_class a, b;
+    mpz_urandom_len(a.get_mpz_t(), state, l);
+    mpz_urandom_len(b.get_mpz_t(), state, l);
+    party_a->set_value(a);
+    party_b->set_value(b);
+
+    boost::asio::io_service io_service;
+    tcp::acceptor acceptor(io_service, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    tcp::endpoint endpoint = acceptor.local_endpoint();
+    tcp::socket socket_a(io_service), socket_b(io_service);
+
+    RESET_BYTE_COUNT
+    Timer t;
+
+    // an exception must not escape the thread, it is rethrown once both ends are done
+    exception_ptr error_b;
+    thread thread_b([&](){
+        try {
+            socket_b.connect(endpoint);
+            exec_comparison_protocol_B(socket_b, party_b.get(), 1);
+        } catch (...) {
+            error_b = current_exception();
+        }
+    });
+
+    try {
+        acceptor.accept(socket_a);
+        exec_comparison_protocol_A(socket_a, party_a.get(), 1);
+    } catch (...) {
+        // unblock B: it gets a refused connection or an EOF
+        boost::system::error_code ec;
+        socket_a.close(ec);
+        acceptor.close(ec);
+        thread_b.join();
+        gmp_randclear(state_b);
+        throw;
+    }
+    thread_b.join();
+
+    if (error_b) {
+        gmp_randclear(state_b);
+        rethrow_exception(error_b);
+    }
+
+    double elapsed = t.lap_ms();
+
+    Comparison_cost c = fallback;
+    c.cpu_ms_per_bit = elapsed/l;
+
+#ifdef BENCHMARK
+    // both ends live in this process: every byte and message is counted twice
+    c.bytes_per_bit = ((double)IOBenchmark::byte_count())/(2*l);
+    double messages = ((double)IOBenchmark::interaction_count())/2;
+    if (prot == LSIC_PROTOCOL) {
+        c.messages_per_bit = messages/l;
+        c.messages = 0;
+    }else{
+        c.messages_per_bit = 0;
+        c.messages = messages;
+    }
+    RESET_BYTE_COUNT
+#endif
+
+    gmp_randclear(state_b);
+
+    return c;
+}
+
+void Comparison_cost_model::calibrate(unsigned int keysize, size_t bit_length, gmp_randstate_t state)
+{
+    GM_priv gm(GM_priv::keygen(state,keysize),state);
+    Paillier_priv_fast paillier(Paillier_priv_fast::keygen(state,keysize),state);
+
+    Comparison_cost lsic, dgk, gc;
+
+    try {
+        lsic = measure_protocol(LSIC_PROTOCOL, bit_length, gm, paillier, state, lsic_default__);
+        dgk = measure_protocol(DGK_PROTOCOL, bit_length, gm, paillier, state, dgk_default__);
+        gc = measure_protocol(GC_PROTOCOL, bit_length, gm, paillier, state, gc_default__);
+    }
+    catch (std::exception& e)
+    {
+        // keep the default model
+        std::cerr << "Comparison cost calibration failed: " << e.what() << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    lsic_cost_ = lsic;
+    dgk_cost_ = dgk;
+    gc_cost_ = gc;
+}
+
+void Comparison_cost_model::update_rtt(double rtt_ms)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    rtt_ms_ = (1-RTT_ALPHA)*rtt_ms_ + RTT_ALPHA*rtt_ms;
+}
+
+double Comparison_cost_model::rtt() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return rtt_ms_;
+}
+
+void Comparison_cost_model::set_bandwidth(double bytes_per_ms)
+{
+    assert(bytes_per_ms > 0);
+    std::lock_guard<std::mutex> lock(mtx_);
+    bandwidth_ = bytes_per_ms;
+}
+
+Comparison_cost Comparison_cost_model::cost(COMPARISON_PROTOCOL prot) const
+{
+    if (prot == LSIC_PROTOCOL) {
+        return lsic_cost_;
+    }else if (prot == DGK_PROTOCOL){
+        return dgk_cost_;
+    }
+    return gc_cost_;
+}
+
+double Comparison_cost_model::estimate(COMPARISON_PROTOCOL prot, size_t l, size_t n, unsigned int n_threads) const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    Comparison_cost c = cost(prot);
+
+    // only the DGK batch spreads its homomorphic operations over the threads
+    double cpu = n*l*c.cpu_ms_per_bit;
+    if (prot == DGK_PROTOCOL && n_threads > 1) {
+        cpu /= n_threads;
+    }
+    double transfer = n*l*c.bytes_per_bit/bandwidth_;
+    double latency = (c.messages + l*c.messages_per_bit)*rtt_ms_/2;
+
+    return cpu + transfer + latency;
+}
+
+COMPARISON_PROTOCOL Comparison_cost_model::best_protocol(size_t l, size_t n, unsigned int n_threads, bool dgk_available) const
+{
+    COMPARISON_PROTOCOL best = GC_PROTOCOL;
+    double best_cost = estimate(GC_PROTOCOL, l, n, n_threads);
+
+    double c = estimate(LSIC_PROTOCOL, l, n, n_threads);
+    if (c < best_cost) {
+        best = LSIC_PROTOCOL;
+        best_cost = c;
+    }
+
+    if (dgk_available) {
+        c = estimate(DGK_PROTOCOL, l, n, n_threads);
+        if (c < best_cost) {
+            best = DGK_PROTOCOL;
+        }
+    }
+
+    return best;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+#include <gmpxx.h>
+
+#include <crypto/gm.hh>
+#include <mpc/comparison_protocol.hh>
+
+// Cost of one comparison protocol, normalized by the bit length of the
+// compared values. The number of messages is the number of flights for a
+// single (or batched) comparison: it does not depend on the batch size.
+struct Comparison_cost {
+    double cpu_ms_per_bit;
+    double bytes_per_bit;
+    double messages_per_bit;
+    double messages;
+};
+
+// Estimates the cost of LSIC, DGK and GC and picks the cheapest one for a
+// given comparison workload.
+// The CPU and bandwidth figures are calibrated once, at server startup, by
+// running each protocol on a loopback connection. The round trip time is
+// refreshed with the measurements made on the live sessions.
+class Comparison_cost_model {
+public:
+    Comparison_cost_model();
+
+    // run a micro-benchmark of each protocol with throwaway keys
+    void calibrate(unsigned int keysize, size_t bit_length, gmp_randstate_t state);
+
+    // fold a new RTT measurement (in ms) into the running estimate
+    void update_rtt(double rtt_ms);
+    double rtt() const;
+
+    void set_bandwidth(double bytes_per_ms);
+
+    // expected duration (in ms) of n comparisons of l bits
+    double estimate(COMPARISON_PROTOCOL prot, size_t l, size_t n, unsigned int n_threads) const;
+
+    COMPARISON_PROTOCOL best_protocol(size_t l, size_t n, unsigned int n_threads, bool dgk_available) const;
+
+protected:
+    Comparison_cost cost(COMPARISON_PROTOCOL prot) const;
+
+    Comparison_cost lsic_cost_;
+    Comparison_cost dgk_cost_;
+    Comparison_cost gc_cost_;
+
+    double rtt_ms_;
+    double bandwidth_; // bytes per ms
+
+    mutable std::mutex mtx_;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+// default port, see Server::set_port
 #define PORT 1990
 #define BASE 10
 
@@ -15,3 +16,20 @@
 #define FHE_m 0 // XXX: check?
 
 #define OT_SECPARAM 1024
+
+// number of ciphertexts per frame in the answer of the DGK owner
+#define PRIV_COMPARE_CHUNK_SIZE 16
+
+// bit length of the values compared to calibrate the comparison cost model
+#define COST_MODEL_CALIBRATION_BITS 64
+
+// sessions run at the same time by the server, and sessions waiting for a slot
+#define MAX_CONCURRENT_SESSIONS 8
+#define SESSION_QUEUE_LENGTH 64
+
+// best compression of the FHE material supported by this end (see WIRE_COMPRESSION)
+#define SUPPORTED_WIRE_COMPRESSION ZLIB_COMPRESSION
+
+// session resumption: size of the ticket ids and number of tickets remembered by the server
+#define SESSION_TICKET_BYTES 16
+#define SESSION_TICKET_CACHE_SIZE 1024
@@ -4,10 +4,56 @@
 #include <net/net_utils.hh>
 
 #include <mpc/change_encryption_scheme.hh>
-#include <thread>
+#include <cstring>
 #include <net/defs.hh>
 
 #include <net/oblivious_transfer.hh>
+#include <net/mux_channel.hh>
+#include <util/threadpool.hh>
+
+#include <thread>
+#include <exception>
+#include <stdexcept>
+
+// Split a batch of n comparisons in n_streams slices and run each slice on its own stream of a Mux_channel.
+// The streams block on I/O, so they get their own threads instead of the crypto pool.
+// There are at most max_workers of them: worker w runs the streams w, w+max_workers, ... in order.
+// The frames of a stream that is not running yet are queued by the channel, and the lowest
+// running stream always progresses on both ends, so this cannot deadlock.
+// The first failing stream fails the whole channel, so the other workers and the peer do not wait for it.
+static void run_multiplexed(tcp::socket &socket, size_t n, size_t n_streams, size_t max_workers, const function<void(Mux_stream&, size_t, size_t)> &job)
+{
+    Mux_channel channel(socket, n_streams);
+    size_t n_workers = max<size_t>(1, min(n_streams, max_workers));
+    vector<thread> workers;
+    
+    for (size_t w = 0; w < n_workers; w++) {
+        workers.push_back(thread([&channel,&job,n,n_streams,n_workers,w]()
+                                 {
+                                     try {
+                                         for (size_t s = w; s < n_streams; s += n_workers) {
+                                             Mux_stream stream(channel, s);
+                                             job(stream, s*n/n_streams, (s+1)*n/n_streams);
+                                         }
+                                     } catch (...) {
+                                         channel.fail(current_exception());
+                                     }
+                                 }));
+    }
+    
+    for (size_t w = 0; w < n_workers; w++) {
+        workers[w].join();
+    }
+    if (channel.error()) {
+        rethrow_exception(channel.error());
+    }
+}
+
+template <class T>
+static vector<T> slice(const vector<T> &v, size_t i_begin, size_t i_end)
+{
+    return vector<T>(v.begin()+i_begin, v.begin()+i_end);
+}
 
 void exec_comparison_protocol_A(tcp::socket &socket, Comparison_protocol_A *comparator, unsigned int n_threads)
 {
@@ -54,12 +100,12 @@ void exec_priv_compare_A(tcp::socket &socket, Compare_A *comparator, unsigned in
     Protobuf::BigIntArray c_b_message = readMessageFromSocket<Protobuf::BigIntArray>(socket);
     c_b = convert_from_message(c_b_message);
 
-    vector<mpz_class> c_rand = comparator->compute(c_b,n_threads);
-    
-    // send the result
-    
-    Protobuf::BigIntArray c_rand_message = convert_to_message(c_rand);
-    sendMessageToSocket(socket, c_rand_message);
+    // compute and send the result, chunk by chunk, so that B can start decrypting
+    comparator->compute_pipelined(c_b, [&socket](const vector<mpz_class> &chunk)
+                                  {
+                                      Protobuf::BigIntArray chunk_message = convert_to_message(chunk);
+                                      sendMessageToSocket(socket, chunk_message);
+                                  }, PRIV_COMPARE_CHUNK_SIZE, n_threads);
     
     // wait for the encrypted result
     mpz_class c_t_prime;
@@ -117,6 +163,211 @@ void exec_garbled_compare_A(tcp::socket &socket, GC_Compare_A *comparator)
     comparator->unblind(mask);
 }
 
+void exec_batch_comparison_protocol_A(tcp::socket &socket, const vector<Comparison_protocol_A*> &comparators, unsigned int n_threads)
+{
+    size_t n = comparators.size();
+    
+    if (n == 0) {
+        return;
+    }
+    
+    // all the comparators of a batch run the same protocol
+    if(typeid(*comparators[0]) == typeid(LSIC_A)) {
+        vector<LSIC_A*> lsics(n);
+        for (size_t i = 0; i < n; i++) {
+            lsics[i] = reinterpret_cast<LSIC_A*>(comparators[i]);
+        }
+        exec_multiplexed_batch_lsic_A(socket, lsics, n_threads);
+    }else if(typeid(*comparators[0]) == typeid(Compare_A)){
+        vector<Compare_A*> priv_comparators(n);
+        for (size_t i = 0; i < n; i++) {
+            priv_comparators[i] = reinterpret_cast<Compare_A*>(comparators[i]);
+        }
+        exec_multiplexed_batch_priv_compare_A(socket, priv_comparators, n_threads);
+    }else if(typeid(*comparators[0]) == typeid(GC_Compare_A)) {
+        vector<GC_Compare_A*> gc_comparators(n);
+        for (size_t i = 0; i < n; i++) {
+            gc_comparators[i] = reinterpret_cast<GC_Compare_A*>(comparators[i]);
+        }
+        exec_batch_garbled_compare_A(socket, gc_comparators);
+    }
+}
+
+// the batch protocols can run either on the socket or on a stream of a Mux_channel
+template <class Channel>
+static void batch_lsic_A(Channel &socket, const vector<LSIC_A*> &lsics)
+{
+    size_t n = lsics.size();
+    vector<LSIC_Packet_A> a_packets(n);
+    vector<LSIC_Packet_B> b_packets;
+    Protobuf::LSIC_A_Batch_Message a_message;
+    Protobuf::LSIC_B_Batch_Message b_message;
+    
+    bool state = false;
+    
+    // response-request, all the instances in lockstep
+    for (; ; ) {
+        b_message = readMessageFromSocket<Protobuf::LSIC_B_Batch_Message>(socket);
+        b_packets = convert_from_message(b_message);
+        assert(b_packets.size() == n);
+        
+        for (size_t i = 0; i < n; i++) {
+            state = lsics[i]->answerRound(b_packets[i],&a_packets[i]);
+        }
+        
+        // the instances have the same bit length, so they all end at the same round
+        if (state) {
+            return;
+        }
+        
+        a_message = convert_to_message(a_packets);
+        sendMessageToSocket(socket, a_message);
+    }
+}
+
+template <class Channel>
+static void batch_priv_compare_A(Channel &socket, const vector<Compare_A*> &comparators, unsigned int n_threads)
+{
+    size_t n = comparators.size();
+    
+    // first get the encrypted bits of every instance
+    Protobuf::BigIntMatrix c_b_message = readMessageFromSocket<Protobuf::BigIntMatrix>(socket);
+    vector< vector<mpz_class> > c_b = convert_from_message(c_b_message);
+    assert(c_b.size() == n);
+    
+    vector< vector<mpz_class> > c_rand(n);
+    for (size_t i = 0; i < n; i++) {
+        c_rand[i] = comparators[i]->compute(c_b[i],n_threads);
+    }
+    
+    // send the results
+    Protobuf::BigIntMatrix c_rand_message = convert_to_message(c_rand);
+    sendMessageToSocket(socket, c_rand_message);
+    
+    // wait for the encrypted results
+    vector<mpz_class> c_t_prime = read_int_array_from_socket(socket);
+    
+    for (size_t i = 0; i < n; i++) {
+        comparators[i]->unblind(c_t_prime[i]);
+    }
+}
+
+void exec_batch_lsic_A(tcp::socket &socket, const vector<LSIC_A*> &lsics)
+{
+    batch_lsic_A(socket, lsics);
+}
+
+void exec_batch_priv_compare_A(tcp::socket &socket, const vector<Compare_A*> &comparators, unsigned int n_threads)
+{
+    batch_priv_compare_A(socket, comparators, n_threads);
+}
+
+// B chooses the number of streams
+void exec_multiplexed_batch_lsic_A(tcp::socket &socket, const vector<LSIC_A*> &lsics, unsigned int n_threads)
+{
+    size_t n_streams = readIntFromSocket(socket).get_ui();
+    
+    if (n_streams > max<size_t>(1, lsics.size())) {
+        throw std::runtime_error("Invalid number of streams");
+    }
+    if (n_streams < 2) {
+        batch_lsic_A(socket, lsics);
+        return;
+    }
+    run_multiplexed(socket, lsics.size(), n_streams, n_threads, [&lsics](Mux_stream &stream, size_t i_begin, size_t i_end)
+                    {
+                        batch_lsic_A(stream, slice(lsics, i_begin, i_end));
+                    });
+}
+
+void exec_multiplexed_batch_priv_compare_A(tcp::socket &socket, const vector<Compare_A*> &comparators, unsigned int n_threads)
+{
+    size_t n_streams = readIntFromSocket(socket).get_ui();
+    
+    if (n_streams > max<size_t>(1, comparators.size())) {
+        throw std::runtime_error("Invalid number of streams");
+    }
+    if (n_streams < 2) {
+        batch_priv_compare_A(socket, comparators, n_threads);
+        return;
+    }
+    // share the threads between the streams
+    unsigned int stream_threads = max<unsigned int>(1, n_threads/n_streams);
+    run_multiplexed(socket, comparators.size(), n_streams, n_threads, [&comparators,stream_threads](Mux_stream &stream, size_t i_begin, size_t i_end)
+                    {
+                        batch_priv_compare_A(stream, slice(comparators, i_begin, i_end), stream_threads);
+                    });
+}
+
+void exec_batch_garbled_compare_A(tcp::socket &socket, const vector<GC_Compare_A*> &comparators)
+{
+    size_t n = comparators.size();
+    size_t total_l = 0, total_q = 0;
+    
+    for (size_t i = 0; i < n; i++) {
+        comparators[i]->prepare_circuit();
+        total_l += comparators[i]->bit_length();
+        total_q += comparators[i]->get_garbled_circuit()->q;
+    }
+    
+    block *global_keys = new block[n];
+    GarbledTable *garbled_tables = new GarbledTable[total_q];
+    block *b_labels = new block[total_l + n];
+    block *a_labels = new block[total_l];
+    block *output_maps = new block[2*n];
+    int *a_inputs = new int[total_l];
+    
+    // get the global keys, the garbled tables and b's labels of all the circuits
+    read_byte_string_from_socket(socket, (unsigned char*)global_keys, n*sizeof(block));
+    read_byte_string_from_socket(socket, (unsigned char*)garbled_tables, total_q*sizeof(GarbledTable));
+    read_byte_string_from_socket(socket, (unsigned char*)b_labels, (total_l + n)*sizeof(block));
+    
+    for (size_t i = 0, q_offset = 0; i < n; i++) {
+        GarbledCircuit* gc = comparators[i]->get_garbled_circuit();
+        
+        comparators[i]->set_global_key(global_keys[i]);
+        memcpy(gc->garbledTable, garbled_tables + q_offset, (gc->q)*sizeof(GarbledTable));
+        q_offset += gc->q;
+    }
+    
+    // one OT for all our labels
+    for (size_t i = 0, l_offset = 0; i < n; i++) {
+        vector<bool> a_bits = comparators[i]->get_a_bits();
+        for (size_t j = 0; j < a_bits.size(); j++) {
+            a_inputs[l_offset + j] = a_bits[j];
+        }
+        l_offset += a_bits.size();
+    }
+    
+    ObliviousTransfer::receiver(total_l, a_inputs, (char *)a_labels, socket, sizeof(block));
+    
+    // evaluate the circuits
+    for (size_t i = 0, l_offset = 0; i < n; i++) {
+        comparators[i]->evaluateGC(a_labels + l_offset, b_labels + l_offset + i);
+        l_offset += comparators[i]->bit_length();
+    }
+    
+    // get the outputmaps and apply them
+    read_byte_string_from_socket(socket, (unsigned char*)output_maps, 2*n*sizeof(block));
+    
+    for (size_t i = 0; i < n; i++) {
+        comparators[i]->map_output(output_maps + 2*i);
+    }
+    
+    // unblind
+    vector<mpz_class> masks = read_int_array_from_socket(socket);
+    for (size_t i = 0; i < n; i++) {
+        comparators[i]->unblind(masks[i]);
+    }
+    
+    delete [] global_keys;
+    delete [] garbled_tables;
+    delete [] b_labels;
+    delete [] a_labels;
+    delete [] output_maps;
+    delete [] a_inputs;
+}
+
 void exec_comparison_protocol_B(tcp::socket &socket, Comparison_protocol_B *comparator, unsigned int n_threads)
 {
     if(typeid(*comparator) == typeid(LSIC_B)) {
@@ -159,21 +410,26 @@ void exec_lsic_B(tcp::socket &socket, LSIC_B *lsic)
 
 void exec_priv_compare_B(tcp::socket &socket, Compare_B *comparator, unsigned int n_threads)
 {
-    vector<mpz_class> c(comparator->bit_length());
+    vector<mpz_class> c;
     
     
     // send the encrypted bits
     Protobuf::BigIntArray c_b_message = convert_to_message(comparator->encrypt_bits_parallel(n_threads));
     sendMessageToSocket(socket, c_b_message);
     
-    // wait for the answer from the client
-    Protobuf::BigIntArray c_message = readMessageFromSocket<Protobuf::BigIntArray>(socket);
-    c = convert_from_message(c_message);
-    
-    
-    //    input_stream >> c;
+    // the answer of the client comes by chunks: decrypt them as they arrive
+    bool has_zero = false;
+    for (size_t received = 0; received < comparator->bit_length(); received += c.size()) {
+        Protobuf::BigIntArray c_message = readMessageFromSocket<Protobuf::BigIntArray>(socket);
+        c = convert_from_message(c_message);
+        assert(c.size() > 0);
+        
+        if (!has_zero) {
+            has_zero = comparator->has_zero(c);
+        }
+    }
     
-    mpz_class c_t_prime = comparator->search_zero(c);
+    mpz_class c_t_prime = comparator->encrypt_result(has_zero);
     
     // send the blinded result
     Protobuf::BigInt c_t_prime_message = convert_to_message(c_t_prime);
@@ -218,10 +474,209 @@ void exec_garbled_compare_B(tcp::socket &socket, GC_Compare_B *comparator)
     sendMessageToSocket(socket, mask_m);
 }
 
+void exec_batch_comparison_protocol_B(tcp::socket &socket, const vector<Comparison_protocol_B*> &comparators, unsigned int n_threads)
+{
+    size_t n = comparators.size();
+    
+    if (n == 0) {
+        return;
+    }
+    
+    // all the comparators of a batch run the same protocol
+    if(typeid(*comparators[0]) == typeid(LSIC_B)) {
+        vector<LSIC_B*> lsics(n);
+        for (size_t i = 0; i < n; i++) {
+            lsics[i] = reinterpret_cast<LSIC_B*>(comparators[i]);
+        }
+        exec_multiplexed_batch_lsic_B(socket, lsics, n_threads);
+    }else if(typeid(*comparators[0]) == typeid(Compare_B)){
+        vector<Compare_B*> priv_comparators(n);
+        for (size_t i = 0; i < n; i++) {
+            priv_comparators[i] = reinterpret_cast<Compare_B*>(comparators[i]);
+        }
+        exec_multiplexed_batch_priv_compare_B(socket, priv_comparators, n_threads);
+    }else if(typeid(*comparators[0]) == typeid(GC_Compare_B)) {
+        vector<GC_Compare_B*> gc_comparators(n);
+        for (size_t i = 0; i < n; i++) {
+            gc_comparators[i] = reinterpret_cast<GC_Compare_B*>(comparators[i]);
+        }
+        exec_batch_garbled_compare_B(socket, gc_comparators);
+    }
+}
+
+template <class Channel>
+static void batch_lsic_B(Channel &socket, const vector<LSIC_B*> &lsics)
+{
+    size_t n = lsics.size();
+    vector<LSIC_Packet_A> a_packets;
+    vector<LSIC_Packet_B> b_packets(n);
+    Protobuf::LSIC_A_Batch_Message a_message;
+    Protobuf::LSIC_B_Batch_Message b_message;
+    
+    for (size_t i = 0; i < n; i++) {
+        assert(lsics[i]->bitLength() == lsics[0]->bitLength());
+        b_packets[i] = lsics[i]->setupRound();
+    }
+    
+    b_message = convert_to_message(b_packets);
+    sendMessageToSocket(socket, b_message);
+    
+    // wait for packets
+    
+    for (;b_packets[0].index < lsics[0]->bitLength()-1; ) {
+        a_message = readMessageFromSocket<Protobuf::LSIC_A_Batch_Message>(socket);
+        a_packets = convert_from_message(a_message);
+        assert(a_packets.size() == n);
+        
+        for (size_t i = 0; i < n; i++) {
+            b_packets[i] = lsics[i]->answerRound(a_packets[i]);
+        }
+        
+        b_message = convert_to_message(b_packets);
+        sendMessageToSocket(socket, b_message);
+    }
+}
+
+template <class Channel>
+static void batch_priv_compare_B(Channel &socket, const vector<Compare_B*> &comparators, unsigned int n_threads)
+{
+    size_t n = comparators.size();
+    vector< vector<mpz_class> > c_b(n);
+    
+    // send the encrypted bits of every instance
+    for (size_t i = 0; i < n; i++) {
+        c_b[i] = comparators[i]->encrypt_bits_parallel(n_threads);
+    }
+    Protobuf::BigIntMatrix c_b_message = convert_to_message(c_b);
+    sendMessageToSocket(socket, c_b_message);
+    
+    // wait for the answer from the client
+    Protobuf::BigIntMatrix c_message = readMessageFromSocket<Protobuf::BigIntMatrix>(socket);
+    vector< vector<mpz_class> > c = convert_from_message(c_message);
+    assert(c.size() == n);
+    
+    vector<mpz_class> c_t_prime(n);
+    for (size_t i = 0; i < n; i++) {
+        c_t_prime[i] = comparators[i]->search_zero(c[i]);
+    }
+    
+    // send the blinded results
+    send_int_array_to_socket(socket, c_t_prime);
+}
+
+void exec_batch_lsic_B(tcp::socket &socket, const vector<LSIC_B*> &lsics)
+{
+    batch_lsic_B(socket, lsics);
+}
+
+void exec_batch_priv_compare_B(tcp::socket &socket, const vector<Compare_B*> &comparators, unsigned int n_threads)
+{
+    batch_priv_compare_B(socket, comparators, n_threads);
+}
+
+void exec_multiplexed_batch_lsic_B(tcp::socket &socket, const vector<LSIC_B*> &lsics, unsigned int n_threads)
+{
+    size_t n_streams = max<size_t>(1, min<size_t>(n_threads, lsics.size()));
+    sendIntToSocket(socket, n_streams);
+    
+    if (n_streams < 2) {
+        batch_lsic_B(socket, lsics);
+        return;
+    }
+    run_multiplexed(socket, lsics.size(), n_streams, n_threads, [&lsics](Mux_stream &stream, size_t i_begin, size_t i_end)
+                    {
+                        batch_lsic_B(stream, slice(lsics, i_begin, i_end));
+                    });
+}
+
+void exec_multiplexed_batch_priv_compare_B(tcp::socket &socket, const vector<Compare_B*> &comparators, unsigned int n_threads)
+{
+    size_t n_streams = max<size_t>(1, min<size_t>(n_threads, comparators.size()));
+    sendIntToSocket(socket, n_streams);
+    
+    if (n_streams < 2) {
+        batch_priv_compare_B(socket, comparators, n_threads);
+        return;
+    }
+    unsigned int stream_threads = max<unsigned int>(1, n_threads/n_streams);
+    run_multiplexed(socket, comparators.size(), n_streams, n_threads, [&comparators,stream_threads](Mux_stream &stream, size_t i_begin, size_t i_end)
+                    {
+                        batch_priv_compare_B(stream, slice(comparators, i_begin, i_end), stream_threads);
+                    });
+}
+
+void exec_batch_garbled_compare_B(tcp::socket &socket, const vector<GC_Compare_B*> &comparators)
+{
+    size_t n = comparators.size();
+    size_t total_l = 0, total_q = 0;
+    
+    for (size_t i = 0; i < n; i++) {
+        comparators[i]->prepare_circuit();
+        total_l += comparators[i]->bit_length();
+        total_q += comparators[i]->get_garbled_circuit()->q;
+    }
+    
+    block *global_keys = new block[n];
+    GarbledTable *garbled_tables = new GarbledTable[total_q];
+    block *b_labels = new block[total_l + n];
+    block *all_a_labels = new block[2*total_l];
+    block *output_maps = new block[2*n];
+    vector<mpz_class> masks(n);
+    
+    // pack the data of all the circuits in contiguous buffers
+    for (size_t i = 0, q_offset = 0, l_offset = 0; i < n; i++) {
+        GarbledCircuit* gc = comparators[i]->get_garbled_circuit();
+        size_t l = comparators[i]->bit_length();
+        
+        global_keys[i] = comparators[i]->get_global_key();
+        memcpy(garbled_tables + q_offset, gc->garbledTable, (gc->q)*sizeof(GarbledTable));
+        
+        block *labels = comparators[i]->get_b_input_labels();
+        memcpy(b_labels + l_offset + i, labels, (l+1)*sizeof(block));
+        free(labels);
+        
+        labels = comparators[i]->get_all_a_input_labels();
+        memcpy(all_a_labels + 2*l_offset, labels, 2*l*sizeof(block));
+        free(labels);
+        
+        OutputMap om = comparators[i]->get_output_map(); // m = 1
+        output_maps[2*i] = om[0];
+        output_maps[2*i+1] = om[1];
+        
+        masks[i] = comparators[i]->get_enc_mask();
+        
+        q_offset += gc->q;
+        l_offset += l;
+    }
+    
+    // send the global keys, the garbled tables and b's labels
+    write_byte_string_to_socket(socket, (unsigned char*)global_keys, n*sizeof(block));
+    write_byte_string_to_socket(socket, (unsigned char*)garbled_tables, total_q*sizeof(GarbledTable));
+    write_byte_string_to_socket(socket, (unsigned char*)b_labels, (total_l + n)*sizeof(block));
+    
+    // one OT for all a's labels
+    ObliviousTransfer::sender(total_l,(char *)all_a_labels, socket, sizeof(block));
+    
+    // send the outputmaps and the masks
+    write_byte_string_to_socket(socket, (unsigned char*)output_maps, 2*n*sizeof(block));
+    send_int_array_to_socket(socket, masks);
+    
+    delete [] global_keys;
+    delete [] garbled_tables;
+    delete [] b_labels;
+    delete [] all_a_labels;
+    delete [] output_maps;
+}
+
 void exec_rev_enc_comparison_owner(tcp::socket &socket, Rev_EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
 {
-    size_t l = owner.bit_length();
     mpz_class c_z(owner.setup(lambda));
+    exec_rev_enc_comparison_owner_with_setup(socket, owner, c_z, decrypt_result, n_threads);
+}
+
+void exec_rev_enc_comparison_owner_with_setup(tcp::socket &socket, Rev_EncCompare_Owner &owner, const mpz_class &c_z, bool decrypt_result, unsigned int n_threads)
+{
+    size_t l = owner.bit_length();
     
     Protobuf::Enc_Compare_Setup_Message setup_message = convert_to_message(c_z,l);
     sendMessageToSocket(socket, setup_message);
@@ -337,179 +792,297 @@ void exec_enc_comparison_helper(tcp::socket &socket, EncCompare_Helper &helper,
 }
 
 
-void multiple_exec_enc_comparison_owner_thread_call(shared_ptr<tcp::socket> socket, EncCompare_Owner *owner_ptr, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
-{
-    exec_enc_comparison_owner(*socket,*owner_ptr,lambda,decrypt_result,n_threads);
-}
+
+// Multiple comparisons over encrypted data are run as a batch on the session socket:
+// the setup values, the comparisons and the results are exchanged at once for all the instances
 
 void multiple_exec_enc_comparison_owner(tcp::socket &socket, vector<EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
 {
-    // when doing multiple executions in parallel, the owner creates the sockets and the helper connects
+    size_t n = owners.size();
+    vector<mpz_class> c_z(n), c_r_l(n);
+    vector<Comparison_protocol_B*> comparators(n);
+    
+    if (n == 0) {
+        return;
+    }
     
-    thread **comparison_threads = new thread* [owners.size()];
+    for (size_t i = 0; i < n; i++) {
+        assert(owners[i]->bit_length() == owners[0]->bit_length());
+        comparators[i] = owners[i]->comparator();
+    }
+    c_z = EncCompare_Owner::batch_setup(owners, lambda, n_threads);
     
-    tcp::endpoint endpoint = socket.local_endpoint(); // (tcp::v4(), PORT+1);
-    endpoint.port(PORT+1);
+    Protobuf::Enc_Compare_Batch_Setup_Message setup_message = convert_to_message(c_z,owners[0]->bit_length());
+    sendMessageToSocket(socket, setup_message);
     
-    tcp::acceptor acceptor(socket.get_io_service(), endpoint);
+    // the helper does some computation, we just have to run the comparators
+    exec_batch_comparison_protocol_B(socket, comparators, n_threads);
     
-    for (size_t i = 0; i < owners.size(); i++) {
-        shared_ptr<tcp::socket> comp_socket (new tcp::socket(socket.get_io_service()));
-        
-        if (i == 0) {
-            // now that we are ready to accept connexions on this port, notify the client
-            sendMessageToSocket<Protobuf::SOCKET_READY_Message>(socket,Protobuf::SOCKET_READY_Message());
-        }
-        
-        acceptor.accept(*comp_socket);
-        
-        // the socket has been created and the helper connected, now run the comparisons
-        comparison_threads[i] = new thread(&multiple_exec_enc_comparison_owner_thread_call,comp_socket,owners[i],lambda,decrypt_result,n_threads);
+    for (size_t i = 0; i < n; i++) {
+        c_r_l[i] = owners[i]->get_c_r_l();
     }
+    send_int_array_to_socket(socket, c_r_l);
     
-    for (size_t i = 0 ; i < owners.size(); i++) {
-        comparison_threads[i]->join();
-        delete comparison_threads[i];
+    // if we don't decrypt the result, we are done now ...
+    if (!decrypt_result) {
+        return;
+    }
+    // ... else wait for the answer of the helper
+    vector<mpz_class> c_t = read_int_array_from_socket(socket);
+    if (c_t.size() != n) {
+        throw std::runtime_error("Invalid comparison answer");
     }
     
-    delete [] comparison_threads;
-}
-
-void multiple_exec_enc_comparison_helper_thread_call(shared_ptr<tcp::socket> socket,EncCompare_Helper *helper_ptr, bool decrypt_result, unsigned int n_threads)
-{
-    exec_enc_comparison_helper(*socket,*helper_ptr,decrypt_result,n_threads);
+    for (size_t i = 0; i < n; i++) {
+        owners[i]->decryptResult(c_t[i]);
+    }
 }
 
 void multiple_exec_enc_comparison_helper(tcp::socket &socket, vector<EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads)
 {
-    thread **comparison_threads = new thread* [helpers.size()];
+    size_t n = helpers.size();
+    vector<Comparison_protocol_A*> comparators(n);
     
-    tcp::resolver resolver(socket.get_io_service());
-    tcp::endpoint endpoint = socket.remote_endpoint(); // (tcp::v4(), PORT+1);
-    endpoint.port(PORT+1);
+    if (n == 0) {
+        return;
+    }
     
+    Protobuf::Enc_Compare_Batch_Setup_Message setup_message = readMessageFromSocket<Protobuf::Enc_Compare_Batch_Setup_Message>(socket);
+    vector<mpz_class> c_z = convert_from_message(setup_message);
+    if (c_z.size() != n) {
+        throw std::runtime_error("Invalid comparison request");
+    }
+    
+    for (size_t i = 0; i < n; i++) {
+        if (setup_message.has_bit_length()) {
+            helpers[i]->set_bit_length(setup_message.bit_length());
+        }
+        helpers[i]->setup(c_z[i]);
+        comparators[i] = helpers[i]->comparator();
+    }
     
-    // wait for the owner to be ready
-    readMessageFromSocket<Protobuf::SOCKET_READY_Message>(socket);
+    // now, we need to run the comparison protocols
+    exec_batch_comparison_protocol_A(socket, comparators, n_threads);
     
-    for (size_t i = 0; i < helpers.size(); i++) {
-        shared_ptr<tcp::socket> comp_socket (new tcp::socket(socket.get_io_service()));
-        comp_socket->connect(endpoint);
-        
-        // the socket has been created and the owner connected, now run the comparisons
-        comparison_threads[i] = new thread(&multiple_exec_enc_comparison_helper_thread_call,(comp_socket),(helpers[i]),decrypt_result,n_threads);
+    vector<mpz_class> c_r_l = read_int_array_from_socket(socket);
+    if (c_r_l.size() != n) {
+        throw std::runtime_error("Invalid comparison request");
     }
+    vector<mpz_class> c_t(n);
     
-    for (size_t i = 0 ; i < helpers.size(); i++) {
-        comparison_threads[i]->join();
-        delete comparison_threads[i];
+    for (size_t i = 0; i < n; i++) {
+        c_t[i] = helpers[i]->concludeProtocol(c_r_l[i]);
     }
     
-    delete [] comparison_threads;
+    // if we don't decrypt the result, we are done now ...
+    if (!decrypt_result) {
+        return;
+    }
+    // else ... send the last message to the owner
+    send_int_array_to_socket(socket, c_t);
 }
 
-void multiple_exec_rev_enc_comparison_owner_thread_call(shared_ptr<tcp::socket> socket, Rev_EncCompare_Owner *owner_ptr, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
+void exec_threshold_enc_comparison_owner(tcp::socket &socket, Threshold_EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
 {
-    exec_rev_enc_comparison_owner(*socket,*owner_ptr,lambda,decrypt_result,n_threads);
+    if (owner.thresholds_number() == 0) {
+        owner.decryptResult(vector<mpz_class>());
+        return;
+    }
+    
+    // a single blinded value for all the thresholds
+    mpz_class c_z = owner.setup(lambda);
+    sendIntToSocket(socket, c_z);
+    
+    // the helper does some computation, we just have to run the comparators
+    exec_batch_comparison_protocol_B(socket, owner.comparators(), n_threads);
+    
+    send_int_array_to_socket(socket, owner.get_c_r_l());
+    
+    // if we don't decrypt the result, we are done now ...
+    if (!decrypt_result) {
+        return;
+    }
+    // ... else wait for the answer of the helper
+    vector<mpz_class> c_t = read_int_array_from_socket(socket);
+    if (c_t.size() != owner.thresholds_number()) {
+        throw std::runtime_error("Invalid comparison answer");
+    }
+    owner.decryptResult(c_t);
 }
 
-void multiple_exec_rev_enc_comparison_owner(tcp::socket &socket, vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
+void exec_threshold_enc_comparison_helper(tcp::socket &socket, Threshold_EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads)
 {
-    // when doing multiple executions in parallel, the owner creates the sockets and the helper connects
-    
-    thread **comparison_threads = new thread* [owners.size()];
+    if (helper.thresholds_number() == 0) {
+        return;
+    }
     
-    tcp::endpoint endpoint = socket.local_endpoint(); // (tcp::v4(), PORT+1);
-    endpoint.port(PORT+1);
+    helper.setup(readIntFromSocket(socket));
     
-    tcp::acceptor acceptor(socket.get_io_service(), endpoint);
+    // now, we need to run the comparison protocols
+    exec_batch_comparison_protocol_A(socket, helper.comparators(), n_threads);
     
-    for (size_t i = 0; i < owners.size(); i++) {
-        shared_ptr<tcp::socket> comp_socket (new tcp::socket(socket.get_io_service()));
-        
-        if (i == 0) {
-            // now that we are ready to accept connexions on this port, notify the client
-            sendMessageToSocket<Protobuf::SOCKET_READY_Message>(socket,Protobuf::SOCKET_READY_Message());
-        }
-        
-        acceptor.accept(*comp_socket);
-        
-        // the socket has been created and the helper connected, now run the comparisons
-        comparison_threads[i] = new thread(&multiple_exec_rev_enc_comparison_owner_thread_call,comp_socket,owners[i],lambda,decrypt_result,n_threads);
+    vector<mpz_class> c_r_l = read_int_array_from_socket(socket);
+    if (c_r_l.size() != helper.thresholds_number()) {
+        throw std::runtime_error("Invalid comparison request");
     }
+    vector<mpz_class> c_t = helper.concludeProtocol(c_r_l);
     
-    for (size_t i = 0 ; i < owners.size(); i++) {
-        comparison_threads[i]->join();
-        delete comparison_threads[i];
+    // if we don't decrypt the result, we are done now ...
+    if (!decrypt_result) {
+        return;
+    }
+    // else ... send the last message to the owner
+    send_int_array_to_socket(socket, c_t);
+}
+
+void multiple_exec_rev_enc_comparison_owner(tcp::socket &socket, vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads)
+{
+    if (owners.empty()) {
+        return;
     }
     
-    delete [] comparison_threads;
+    vector<mpz_class> c_z = Rev_EncCompare_Owner::batch_setup(owners, lambda, n_threads);
+    multiple_exec_rev_enc_comparison_owner_with_setup(socket, owners, c_z, decrypt_result, n_threads);
 }
 
-void multiple_exec_rev_enc_comparison_helper_thread_call(shared_ptr<tcp::socket> socket,Rev_EncCompare_Helper *helper_ptr, bool decrypt_result, unsigned int n_threads)
+void multiple_exec_rev_enc_comparison_owner_with_setup(tcp::socket &socket, vector<Rev_EncCompare_Owner*> &owners, const vector<mpz_class> &c_z, bool decrypt_result, unsigned int n_threads)
 {
-    exec_rev_enc_comparison_helper(*socket,*helper_ptr,decrypt_result,n_threads);
+    size_t n = owners.size();
+    vector<mpz_class> c_t(n);
+    vector<Comparison_protocol_A*> comparators(n);
+    
+    if (n == 0) {
+        return;
+    }
+    assert(c_z.size() == n);
+    
+    for (size_t i = 0; i < n; i++) {
+        assert(owners[i]->bit_length() == owners[0]->bit_length());
+        comparators[i] = owners[i]->comparator();
+    }
+    
+    Protobuf::Enc_Compare_Batch_Setup_Message setup_message = convert_to_message(c_z,owners[0]->bit_length());
+    sendMessageToSocket(socket, setup_message);
+    
+    // the other party does some computation, we just have to run the comparators
+    exec_batch_comparison_protocol_A(socket, comparators, n_threads);
+    
+    vector<mpz_class> c_z_l = read_int_array_from_socket(socket);
+    if (c_z_l.size() != n) {
+        throw std::runtime_error("Invalid comparison answer");
+    }
+    
+    for (size_t i = 0; i < n; i++) {
+        c_t[i] = owners[i]->concludeProtocol(c_z_l[i]);
+    }
+    
+    // if we don't decrypt the result, we are done now ...
+    if (!decrypt_result) {
+        return;
+    }
+    // ... else send the last message to the helper
+    send_int_array_to_socket(socket, c_t);
 }
 
 void multiple_exec_rev_enc_comparison_helper(tcp::socket &socket, vector<Rev_EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads)
 {
-    thread **comparison_threads = new thread* [helpers.size()];
+    size_t n = helpers.size();
+    vector<mpz_class> c_z_l(n);
+    vector<Comparison_protocol_B*> comparators(n);
     
-    tcp::resolver resolver(socket.get_io_service());
-    tcp::endpoint endpoint = socket.remote_endpoint(); // (tcp::v4(), PORT+1);
-    endpoint.port(PORT+1);
+    if (n == 0) {
+        return;
+    }
     
+    Protobuf::Enc_Compare_Batch_Setup_Message setup_message = readMessageFromSocket<Protobuf::Enc_Compare_Batch_Setup_Message>(socket);
+    vector<mpz_class> c_z = convert_from_message(setup_message);
+    if (c_z.size() != n) {
+        throw std::runtime_error("Invalid comparison request");
+    }
     
-    // wait for the owner to be ready
-    readMessageFromSocket<Protobuf::SOCKET_READY_Message>(socket);
+    for (size_t i = 0; i < n; i++) {
+        if (setup_message.has_bit_length()) {
+            helpers[i]->set_bit_length(setup_message.bit_length());
+        }
+        helpers[i]->setup(c_z[i]);
+        comparators[i] = helpers[i]->comparator();
+    }
     
-    for (size_t i = 0; i < helpers.size(); i++) {
-        shared_ptr<tcp::socket> comp_socket (new tcp::socket(socket.get_io_service()));
-        comp_socket->connect(endpoint);
-        
-        // the socket has been created and the owner connected, now run the comparisons
-        comparison_threads[i] = new thread(&multiple_exec_rev_enc_comparison_helper_thread_call,(comp_socket),(helpers[i]),decrypt_result,n_threads);
+    // now, we need to run the comparison protocols
+    exec_batch_comparison_protocol_B(socket, comparators, n_threads);
+    
+    for (size_t i = 0; i < n; i++) {
+        c_z_l[i] = helpers[i]->get_c_z_l();
     }
+    send_int_array_to_socket(socket, c_z_l);
     
-    for (size_t i = 0 ; i < helpers.size(); i++) {
-        comparison_threads[i]->join();
-        delete comparison_threads[i];
+    // if we don't decrypt the result, we are done now ...
+    if (!decrypt_result) {
+        return;
+    }
+    // ... else wait for the answer of the owner
+    vector<mpz_class> c_t = read_int_array_from_socket(socket);
+    if (c_t.size() != n) {
+        throw std::runtime_error("Invalid comparison answer");
     }
     
-    delete [] comparison_threads;
+    for (size_t i = 0; i < n; i++) {
+        helpers[i]->decryptResult(c_t[i]);
+    }
 }
 
 
-void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads)
+void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads, vector<Round_timing> *timings)
 {
+    Round_timer timer(timings);
     size_t k = owner.elements_number();
     for (size_t i = 0; i < (k-1); i++) {
+        timer.start_round();
         Comparison_protocol_A *comparator = comparator_creator();
         
         Rev_EncCompare_Owner rev_enc_owner = owner.create_current_round_rev_enc_compare_owner(comparator);
         
-        exec_rev_enc_comparison_owner(socket, rev_enc_owner, lambda, true, n_threads);
+        // the blinding of this round does not depend on the comparison: compute it meanwhile
+        future<void> blinding = ThreadPool::shared().submit([&owner](){ owner.precompute_blinding(); });
+        try {
+            mpz_class c_z(rev_enc_owner.setup(lambda));
+            timer.end_setup(1);
+            
+            exec_rev_enc_comparison_owner_with_setup(socket, rev_enc_owner, c_z, true, n_threads);
+            timer.end_comparison();
+        } catch (...) {
+            // the task references the owner: it must be done before we unwind
+            blinding.wait();
+            throw;
+        }
+        
+        ThreadPool::shared().wait(blinding);
         
         mpz_class randomized_enc_max, randomized_value;
         owner.next_round(randomized_enc_max, randomized_value);
         
         // send the randomizations to the server
-        sendIntToSocket(socket,randomized_enc_max);
-        sendIntToSocket(socket,randomized_value);
+        send_int_array_to_socket(socket,{randomized_enc_max, randomized_value});
         
-        // get the server's response
-        mpz_class new_enc_max, x, y;
-        new_enc_max = readIntFromSocket(socket);
-        x = readIntFromSocket(socket);
-        y = readIntFromSocket(socket);
+        // get the server's response: new_enc_max, x and y in one message
+        vector<mpz_class> refresh = read_int_array_from_socket(socket);
+        if (refresh.size() != 3) {
+            throw std::runtime_error("Invalid argmax answer");
+        }
         
-        owner.update_enc_max(new_enc_max, x, y);
+        owner.update_enc_max(refresh[0], refresh[1], refresh[2]);
+        timer.end_round();
     }
     
+    timer.start_round();
+    timer.end_setup(0);
+    timer.end_comparison();
+    
     mpz_class permuted_argmax;
     permuted_argmax = readIntFromSocket(socket);
     
     owner.unpermuteResult(permuted_argmax.get_ui());
+    timer.end_round();
 }
 
 void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads)
@@ -524,21 +1097,31 @@ void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Helper &helper
 
         Rev_EncCompare_Helper rev_enc_helper = helper.rev_enc_compare_helper(comparator);
         
-        exec_rev_enc_comparison_helper(socket, rev_enc_helper, true, n_threads);
+        // the encryptions used by update_argmax do not depend on the comparison: compute them meanwhile
+        future<void> encryptions = ThreadPool::shared().submit([&helper](){ helper.precompute_update(); });
         
-        mpz_class randomized_enc_max, randomized_value;
+        vector<mpz_class> randomized;
+        try {
+            exec_rev_enc_comparison_helper(socket, rev_enc_helper, true, n_threads);
+            
+            // read the values sent by the client
+            randomized = read_int_array_from_socket(socket);
+            if (randomized.size() != 2) {
+                throw std::runtime_error("Invalid argmax request");
+            }
+        } catch (...) {
+            // the task references the helper: it must be done before we unwind
+            encryptions.wait();
+            throw;
+        }
         
-        // read the values sent by the client
-        randomized_enc_max = readIntFromSocket(socket);
-        randomized_value = readIntFromSocket(socket);
+        ThreadPool::shared().wait(encryptions);
         
         // and send the server's response
         mpz_class new_enc_max, x, y;
-        helper.update_argmax(rev_enc_helper.output(), randomized_enc_max, randomized_value, i+1, new_enc_max, x, y);
+        helper.update_argmax(rev_enc_helper.output(), randomized[0], randomized[1], i+1, new_enc_max, x, y);
         
-        sendIntToSocket(socket,new_enc_max);
-        sendIntToSocket(socket,x);
-        sendIntToSocket(socket,y);
+        send_int_array_to_socket(socket,{new_enc_max, x, y});
     }
     
 //    cout << "Send result" << endl;
@@ -546,15 +1129,19 @@ void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Helper &helper
     sendIntToSocket(socket, permuted_argmax);
 }
 
-void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads)
+void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads, vector<Round_timing> *timings)
 {
+    Round_timer timer(timings);
     size_t k = owner.elements_number();
     
     while (owner.new_round_needed()) {
+        timer.start_round();
         vector<Rev_EncCompare_Owner*> rev_enc_owners = owner.create_current_round_rev_enc_compare_owners(comparator_creator);
+        vector<mpz_class> c_z = Rev_EncCompare_Owner::batch_setup(rev_enc_owners, lambda, n_threads);
+        timer.end_setup(rev_enc_owners.size());
 
-        unsigned int thread_per_job = ceilf(((float)n_threads)/rev_enc_owners.size());
-        multiple_exec_rev_enc_comparison_owner(socket,rev_enc_owners,lambda,true,thread_per_job);
+        multiple_exec_rev_enc_comparison_owner_with_setup(socket,rev_enc_owners,c_z,true,n_threads);
+        timer.end_comparison();
         
         // cleanup
         for (size_t i = 0; i < rev_enc_owners.size(); i++) {
@@ -566,20 +1153,25 @@ void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Owner &owner, func
         // send the randomized values to the helper
         send_int_array_to_socket(socket,randomized_enc_max);
         
-        // get the helper's response
-        vector<mpz_class> new_enc_max, x, y;
-        
-        new_enc_max = read_int_array_from_socket(socket);
-        x = read_int_array_from_socket(socket);
-        y = read_int_array_from_socket(socket);
+        // get the helper's response: new_enc_max, x and y in one message
+        vector<vector<mpz_class>> refresh = convert_from_message(readMessageFromSocket<Protobuf::BigIntMatrix>(socket));
+        if (refresh.size() != 3) {
+            throw std::runtime_error("Invalid argmax answer");
+        }
         
-        owner.update_local_max(new_enc_max, x, y);
+        owner.update_local_max(refresh[0], refresh[1], refresh[2]);
+        timer.end_round();
     }
     
+    timer.start_round();
+    timer.end_setup(0);
+    timer.end_comparison();
+    
     mpz_class permuted_argmax;
     permuted_argmax = readIntFromSocket(socket);
     
     owner.unpermuteResult(permuted_argmax.get_ui());
+    timer.end_round();
 }
 
 void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads)
@@ -589,9 +1181,7 @@ void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Helper &helper, fu
     while (helper.new_round_needed()) {
         vector<Rev_EncCompare_Helper*> rev_enc_helpers = helper.create_current_round_rev_enc_compare_helpers(comparator_creator);
         
-        unsigned int thread_per_job = ceilf(((float)n_threads)/rev_enc_helpers.size());
-       
-        multiple_exec_rev_enc_comparison_helper(socket,rev_enc_helpers,true,thread_per_job);
+        multiple_exec_rev_enc_comparison_helper(socket,rev_enc_helpers,true,n_threads);
         
         // get result and cleanup
         vector<bool> results (rev_enc_helpers.size());
@@ -609,9 +1199,8 @@ void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Helper &helper, fu
         helper.update_argmax(results, randomized_enc_max, new_enc_max, x, y);
 
         // and send the server's response
-        send_int_array_to_socket(socket,new_enc_max);
-        send_int_array_to_socket(socket,x);
-        send_int_array_to_socket(socket,y);
+        vector<vector<mpz_class>> refresh = {new_enc_max, x, y};
+        sendMessageToSocket(socket, convert_to_message(refresh));
     }
     
     // send the permuted result
@@ -619,6 +1208,368 @@ void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Helper &helper, fu
     sendIntToSocket(socket, permuted_argmax);
 }
 
+void multiple_exec_tree_enc_argmax(tcp::socket &socket, vector<Tree_EncArgmax_Owner*> &owners, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads)
+{
+    size_t n = owners.size();
+    if (n == 0) {
+        return;
+    }
+    
+    // all the argmax have the same number of elements, hence the same rounds
+    while (owners[0]->new_round_needed()) {
+        vector<Rev_EncCompare_Owner*> rev_enc_owners;
+        for (size_t i = 0; i < n; i++) {
+            vector<Rev_EncCompare_Owner*> round_owners = owners[i]->create_current_round_rev_enc_compare_owners(comparator_creator);
+            rev_enc_owners.insert(rev_enc_owners.end(), round_owners.begin(), round_owners.end());
+        }
+
+        multiple_exec_rev_enc_comparison_owner(socket,rev_enc_owners,lambda,true,n_threads);
+        
+        // cleanup
+        for (size_t i = 0; i < rev_enc_owners.size(); i++) {
+            delete rev_enc_owners[i];
+        }
+        
+        vector<vector<mpz_class>> randomized_enc_max(n);
+        for (size_t i = 0; i < n; i++) {
+            randomized_enc_max[i] = owners[i]->next_round();
+        }
+        
+        // send the randomized values to the helper
+        sendMessageToSocket(socket, convert_to_message(randomized_enc_max));
+        
+        // get the helper's response: new_enc_max, x and y of each argmax in one message
+        vector<vector<vector<mpz_class>>> refresh = convert_from_message(readMessageFromSocket<Protobuf::BigIntMatrix_Collection>(socket));
+        
+        if (refresh.size() != n) {
+            throw std::runtime_error("Invalid batched argmax answer");
+        }
+        
+        for (size_t i = 0; i < n; i++) {
+            if (refresh[i].size() != 3) {
+                throw std::runtime_error("Invalid batched argmax answer");
+            }
+            owners[i]->update_local_max(refresh[i][0], refresh[i][1], refresh[i][2]);
+        }
+    }
+    
+    vector<mpz_class> permuted_argmax = read_int_array_from_socket(socket);
+    if (permuted_argmax.size() != n) {
+        throw std::runtime_error("Invalid batched argmax answer");
+    }
+    
+    for (size_t i = 0; i < n; i++) {
+        owners[i]->unpermuteResult(permuted_argmax[i].get_ui());
+    }
+}
+
+void multiple_exec_tree_enc_argmax(tcp::socket &socket, vector<Tree_EncArgmax_Helper*> &helpers, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads)
+{
+    size_t n = helpers.size();
+    if (n == 0) {
+        return;
+    }
+    
+    while (helpers[0]->new_round_needed()) {
+        vector<Rev_EncCompare_Helper*> rev_enc_helpers;
+        vector<size_t> round_sizes(n);
+        for (size_t i = 0; i < n; i++) {
+            vector<Rev_EncCompare_Helper*> round_helpers = helpers[i]->create_current_round_rev_enc_compare_helpers(comparator_creator);
+            round_sizes[i] = round_helpers.size();
+            rev_enc_helpers.insert(rev_enc_helpers.end(), round_helpers.begin(), round_helpers.end());
+        }
+        
+        multiple_exec_rev_enc_comparison_helper(socket,rev_enc_helpers,true,n_threads);
+        
+        // read the values sent by the owner
+        vector<vector<mpz_class>> randomized_enc_max = convert_from_message(readMessageFromSocket<Protobuf::BigIntMatrix>(socket));
+        if (randomized_enc_max.size() != n) {
+            throw std::runtime_error("Invalid batched argmax request");
+        }
+        
+        vector<vector<vector<mpz_class>>> refresh(n, vector<vector<mpz_class>>(3));
+        
+        // get the results of each argmax and cleanup
+        size_t offset = 0;
+        for (size_t i = 0; i < n; i++) {
+            vector<bool> results(round_sizes[i]);
+            for (size_t j = 0; j < round_sizes[i]; j++) {
+                results[j] = rev_enc_helpers[offset + j]->output();
+                delete rev_enc_helpers[offset + j];
+            }
+            offset += round_sizes[i];
+            
+            helpers[i]->update_argmax(results, randomized_enc_max[i], refresh[i][0], refresh[i][1], refresh[i][2]);
+        }
+        
+        // and send the server's response
+        sendMessageToSocket(socket, convert_to_message(refresh));
+    }
+    
+    // send the permuted results
+    vector<mpz_class> permuted_argmax(n);
+    for (size_t i = 0; i < n; i++) {
+        permuted_argmax[i] = helpers[i]->permuted_argmax();
+    }
+    send_int_array_to_socket(socket, permuted_argmax);
+}
+
+void exec_tournament_enc_argmax(tcp::socket &socket, Tournament_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads)
+{
+    while (owner.new_round_needed()) {
+        // the comparisons of all the groups of the round
+        vector<Rev_EncCompare_Owner*> rev_enc_owners = owner.create_current_round_rev_enc_compare_owners(comparator_creator);
+        
+        multiple_exec_rev_enc_comparison_owner(socket,rev_enc_owners,lambda,true,n_threads);
+        
+        // cleanup
+        for (size_t i = 0; i < rev_enc_owners.size(); i++) {
+            delete rev_enc_owners[i];
+        }
+        
+        vector<mpz_class> randomized_enc_max = owner.next_round();
+        
+        // send the randomized values to the helper
+        send_int_array_to_socket(socket,randomized_enc_max);
+        
+        // get the helper's response: the maxima of the groups and the selectors in one message
+        vector<vector<mpz_class>> refresh = convert_from_message(readMessageFromSocket<Protobuf::BigIntMatrix>(socket));
+        if (refresh.size() != 2) {
+            throw std::runtime_error("Invalid argmax answer");
+        }
+        
+        owner.update_local_max(refresh[0], refresh[1]);
+    }
+    
+    mpz_class permuted_argmax;
+    permuted_argmax = readIntFromSocket(socket);
+    
+    owner.unpermuteResult(permuted_argmax.get_ui());
+}
+
+void exec_tournament_enc_argmax(tcp::socket &socket, Tournament_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads)
+{
+    while (helper.new_round_needed()) {
+        vector<Rev_EncCompare_Helper*> rev_enc_helpers = helper.create_current_round_rev_enc_compare_helpers(comparator_creator);
+        
+        multiple_exec_rev_enc_comparison_helper(socket,rev_enc_helpers,true,n_threads);
+        
+        // get result and cleanup
+        vector<bool> results (rev_enc_helpers.size());
+        for (size_t i = 0; i < rev_enc_helpers.size(); i++) {
+            results[i] = rev_enc_helpers[i]->output();
+            delete rev_enc_helpers[i];
+        }
+        
+        // read the values sent by the owner
+        vector<mpz_class> randomized_enc_max = read_int_array_from_socket(socket);
+        
+        vector<vector<mpz_class>> refresh(2);
+        helper.update_argmax(results, randomized_enc_max, refresh[0], refresh[1]);
+        
+        // and send the server's response
+        sendMessageToSocket(socket, convert_to_message(refresh));
+    }
+    
+    mpz_class permuted_argmax = helper.permuted_argmax();
+    sendIntToSocket(socket, permuted_argmax);
+}
+
+void exec_bitonic_enc_top_k(tcp::socket &socket, Bitonic_EncTopK_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads)
+{
+    while (owner.new_round_needed()) {
+        vector<Rev_EncCompare_Owner*> rev_enc_owners = owner.create_current_round_rev_enc_compare_owners(comparator_creator);
+        
+        multiple_exec_rev_enc_comparison_owner(socket,rev_enc_owners,lambda,true,n_threads);
+        
+        // cleanup
+        for (size_t i = 0; i < rev_enc_owners.size(); i++) {
+            delete rev_enc_owners[i];
+        }
+        
+        vector<mpz_class> randomized_values = owner.next_round();
+        
+        // send the randomized values to the helper
+        send_int_array_to_socket(socket,randomized_values);
+        
+        // get the helper's response: the swapped values and the swap bits in one message
+        vector<vector<mpz_class>> refresh = convert_from_message(readMessageFromSocket<Protobuf::BigIntMatrix>(socket));
+        if (refresh.size() != 4) {
+            throw std::runtime_error("Invalid top-k answer");
+        }
+        
+        owner.update_values(refresh[0], refresh[1], refresh[2], refresh[3]);
+    }
+    
+    vector<mpz_class> permuted_top = read_int_array_from_socket(socket);
+    if (permuted_top.size() != owner.top_number()) {
+        throw std::runtime_error("Invalid top-k answer");
+    }
+    
+    vector<size_t> top(permuted_top.size());
+    for (size_t i = 0; i < top.size(); i++) {
+        top[i] = permuted_top[i].get_ui();
+    }
+    owner.unpermuteResult(top);
+}
+
+void exec_bitonic_enc_top_k(tcp::socket &socket, Bitonic_EncTopK_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads)
+{
+    while (helper.new_round_needed()) {
+        vector<Rev_EncCompare_Helper*> rev_enc_helpers = helper.create_current_round_rev_enc_compare_helpers(comparator_creator);
+        
+        multiple_exec_rev_enc_comparison_helper(socket,rev_enc_helpers,true,n_threads);
+        
+        // get result and cleanup
+        vector<bool> results (rev_enc_helpers.size());
+        for (size_t i = 0; i < rev_enc_helpers.size(); i++) {
+            results[i] = rev_enc_helpers[i]->output();
+            delete rev_enc_helpers[i];
+        }
+        
+        // read the values sent by the owner
+        vector<mpz_class> randomized_values = read_int_array_from_socket(socket);
+        
+        vector<vector<mpz_class>> refresh(4);
+        helper.update_values(results, randomized_values, refresh[0], refresh[1], refresh[2], refresh[3]);
+        
+        // and send the server's response
+        sendMessageToSocket(socket, convert_to_message(refresh));
+    }
+    
+    vector<size_t> top = helper.permuted_top();
+    vector<mpz_class> permuted_top(top.size());
+    for (size_t i = 0; i < top.size(); i++) {
+        permuted_top[i] = (unsigned long)top[i];
+    }
+    send_int_array_to_socket(socket, permuted_top);
+}
+
+void exec_streaming_enc_argmax(tcp::socket &socket, Streaming_EncArgmax_Owner &owner, function<vector<mpz_class>()> next_chunk, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads)
+{
+    while (owner.new_round_needed()) {
+        if (!owner.stream_closed()) {
+            vector<mpz_class> chunk = next_chunk();
+            if (chunk.empty()) {
+                owner.close_stream();
+            }else{
+                owner.add_candidates(chunk);
+            }
+        }
+        
+        size_t n = owner.current_round_size();
+        if (n == 0) {
+            continue;
+        }
+        if (n > STREAMING_ARGMAX_MAX_ROUND_SIZE) {
+            throw std::runtime_error("Streaming argmax round too large, the chunks must be smaller");
+        }
+        sendIntToSocket(socket, mpz_class((unsigned long)n));
+        
+        vector<Rev_EncCompare_Owner*> rev_enc_owners = owner.create_current_round_rev_enc_compare_owners(comparator_creator);
+        
+        multiple_exec_rev_enc_comparison_owner(socket,rev_enc_owners,lambda,true,n_threads);
+        
+        // cleanup
+        for (size_t i = 0; i < rev_enc_owners.size(); i++) {
+            delete rev_enc_owners[i];
+        }
+        
+        vector<mpz_class> randomized_values = owner.next_round();
+        
+        // send the randomized values and indices to the helper
+        send_int_array_to_socket(socket,randomized_values);
+        
+        // get the helper's response: new_enc_max, new_enc_index, x and y in one message
+        vector<vector<mpz_class>> refresh = convert_from_message(readMessageFromSocket<Protobuf::BigIntMatrix>(socket));
+        if (refresh.size() != 4) {
+            throw std::runtime_error("Invalid argmax answer");
+        }
+        
+        owner.update_local_max(refresh[0], refresh[1], refresh[2], refresh[3]);
+    }
+    
+    // end of the stream
+    sendIntToSocket(socket, mpz_class(0));
+    
+    sendIntToSocket(socket, owner.blinded_argmax());
+    owner.unblindResult(readIntFromSocket(socket));
+}
+
+void exec_streaming_enc_argmax(tcp::socket &socket, Streaming_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads)
+{
+    for (;;) {
+        mpz_class round_size = readIntFromSocket(socket);
+        if (round_size < 0 || round_size > STREAMING_ARGMAX_MAX_ROUND_SIZE) {
+            throw std::runtime_error("Invalid argmax request");
+        }
+        size_t n = round_size.get_ui();
+        if (n == 0) {
+            break;
+        }
+        
+        vector<Rev_EncCompare_Helper*> rev_enc_helpers = helper.create_current_round_rev_enc_compare_helpers(n, comparator_creator);
+        
+        multiple_exec_rev_enc_comparison_helper(socket,rev_enc_helpers,true,n_threads);
+        
+        // get result and cleanup
+        vector<bool> results (rev_enc_helpers.size());
+        for (size_t i = 0; i < rev_enc_helpers.size(); i++) {
+            results[i] = rev_enc_helpers[i]->output();
+            delete rev_enc_helpers[i];
+        }
+        
+        // read the values sent by the owner
+        vector<mpz_class> randomized_values = read_int_array_from_socket(socket);
+        if (randomized_values.size() != 4*n) {
+            throw std::runtime_error("Invalid argmax request");
+        }
+        
+        vector<vector<mpz_class>> refresh(4);
+        helper.update_argmax(results, randomized_values, refresh[0], refresh[1], refresh[2], refresh[3]);
+        
+        // and send the server's response
+        sendMessageToSocket(socket, convert_to_message(refresh));
+    }
+    
+    // decrypt the blinded argmax
+    sendIntToSocket(socket, helper.decrypt_blinded_argmax(readIntFromSocket(socket)));
+}
+
+void exec_enc_argmax(tcp::socket &socket, EncArgmax_Owner &owner, unsigned int lambda, unsigned int n_threads)
+{
+    // all the comparisons at once
+    vector<Rev_EncCompare_Owner*> rev_enc_owners;
+    vector< vector<Rev_EncCompare_Owner*> > comparators = owner.comparators();
+    for (size_t i = 0; i < comparators.size(); i++) {
+        rev_enc_owners.insert(rev_enc_owners.end(), comparators[i].begin(), comparators[i].end());
+    }
+    
+    multiple_exec_rev_enc_comparison_owner(socket,rev_enc_owners,lambda,true,n_threads);
+    
+    mpz_class permuted_argmax;
+    permuted_argmax = readIntFromSocket(socket);
+    
+    owner.unpermuteResult(permuted_argmax.get_ui());
+}
+
+void exec_enc_argmax(tcp::socket &socket, EncArgmax_Helper &helper, unsigned int n_threads)
+{
+    vector<Rev_EncCompare_Helper*> rev_enc_helpers;
+    vector< vector<Rev_EncCompare_Helper*> > comparators = helper.comparators();
+    for (size_t i = 0; i < comparators.size(); i++) {
+        rev_enc_helpers.insert(rev_enc_helpers.end(), comparators[i].begin(), comparators[i].end());
+    }
+    
+    multiple_exec_rev_enc_comparison_helper(socket,rev_enc_helpers,true,n_threads);
+    
+    // every comparison result is known: sort locally
+    helper.sort();
+    
+    mpz_class permuted_argmax = helper.permuted_argmax();
+    sendIntToSocket(socket, permuted_argmax);
+}
+
 Ctxt exec_change_encryption_scheme_slots(tcp::socket &socket, const vector<mpz_class> &c_gm, GM &gm, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate)
 {
     Change_ES_FHE_to_GM_slots_A switcher;
@@ -634,12 +1585,12 @@ Ctxt exec_change_encryption_scheme_slots(tcp::socket &socket, const vector<mpz_c
     return c_fhe;
 }
 
-void exec_change_encryption_scheme_slots_helper(tcp::socket &socket, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea)
+void exec_change_encryption_scheme_slots_helper(tcp::socket &socket, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea, WIRE_COMPRESSION compression)
 {
     vector<mpz_class> c_gm_blinded = read_int_array_from_socket(socket);
     Ctxt c_blinded_fhe = Change_ES_FHE_to_GM_slots_B::decrypt_encrypt(c_gm_blinded,gm,publicKey,ea);
     
-    send_fhe_ctxt_to_socket(socket, c_blinded_fhe);
+    send_fhe_ctxt_to_socket(socket, c_blinded_fhe, compression);
 }
 
 mpz_class exec_compute_dot_product(tcp::socket &socket, const vector<mpz_class> &x, Paillier &p)
@@ -657,6 +1608,24 @@ mpz_class exec_compute_dot_product(tcp::socket &socket, const vector<mpz_class>
     return v;
 }
 
+vector<mpz_class> multiple_exec_compute_dot_product(tcp::socket &socket, const vector<vector<mpz_class>> &xs, Paillier &p, unsigned int n_threads)
+{
+    // the input vector is received once for all the dot products
+    vector<mpz_class> y = read_int_array_from_socket(socket);
+    vector<mpz_class> v(xs.size());
+    
+    ThreadPool::shared().parallel_for(0, xs.size(), [&](size_t j)
+                                      {
+                                          mpz_class v_j = 1;
+                                          for (size_t i = 0; i < y.size(); i++) {
+                                              v_j = p.add(v_j, p.constMult(xs[j][i],y[i]));
+                                          }
+                                          v[j] = v_j;
+                                      }, n_threads);
+    
+    return v;
+}
+
 void exec_help_compute_dot_product(tcp::socket &socket, const vector<mpz_class> &y, Paillier_priv &pp, bool encrypted_input)
 {
     vector<mpz_class> c_y;
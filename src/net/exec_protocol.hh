@@ -7,14 +7,20 @@
 
 #include <boost/asio.hpp>
 #include <net/message_io.hh>
+#include <protobuf/protobuf_conversion.hh>
 
 #include <mpc/lsic.hh>
 #include <mpc/private_comparison.hh>
 #include <mpc/garbled_comparison.hh>
 #include <mpc/rev_enc_comparison.hh>
 #include <mpc/enc_comparison.hh>
+#include <mpc/threshold_enc_comparison.hh>
+#include <mpc/enc_argmax.hh>
 #include <mpc/linear_enc_argmax.hh>
 #include <mpc/tree_enc_argmax.hh>
+#include <mpc/tournament_enc_argmax.hh>
+#include <mpc/bitonic_enc_top_k.hh>
+#include <mpc/streaming_enc_argmax.hh>
 
 #include <math/util_gmp_rand.h>
 
@@ -27,35 +33,80 @@ using boost::asio::ip::tcp;
 
 
 void exec_comparison_protocol_A(tcp::socket &socket, Comparison_protocol_A *comparator, unsigned int n_threads = 2);
+void exec_batch_comparison_protocol_A(tcp::socket &socket, const vector<Comparison_protocol_A*> &comparators, unsigned int n_threads = 2);
 void exec_lsic_A(tcp::socket &socket, LSIC_A *lsic);
 void exec_priv_compare_A(tcp::socket &socket, Compare_A *comparator, unsigned int n_threads);
 void exec_garbled_compare_A(tcp::socket &socket, GC_Compare_A *comparator);
+void exec_batch_lsic_A(tcp::socket &socket, const vector<LSIC_A*> &lsics);
+void exec_batch_priv_compare_A(tcp::socket &socket, const vector<Compare_A*> &comparators, unsigned int n_threads);
+void exec_batch_garbled_compare_A(tcp::socket &socket, const vector<GC_Compare_A*> &comparators);
+// same as exec_batch_*, but the batch is split in slices run in parallel, on logical streams of the socket
+void exec_multiplexed_batch_lsic_A(tcp::socket &socket, const vector<LSIC_A*> &lsics, unsigned int n_threads = 2);
+void exec_multiplexed_batch_priv_compare_A(tcp::socket &socket, const vector<Compare_A*> &comparators, unsigned int n_threads = 2);
 
 void exec_comparison_protocol_B(tcp::socket &socket, Comparison_protocol_B *comparator, unsigned int n_threads = 2);
+void exec_batch_comparison_protocol_B(tcp::socket &socket, const vector<Comparison_protocol_B*> &comparators, unsigned int n_threads = 2);
 void exec_lsic_B(tcp::socket &socket, LSIC_B *lsic);
 void exec_priv_compare_B(tcp::socket &socket, Compare_B *comparator, unsigned int n_threads = 2);
 void exec_garbled_compare_B(tcp::socket &socket, GC_Compare_B *comparator);
+void exec_batch_lsic_B(tcp::socket &socket, const vector<LSIC_B*> &lsics);
+void exec_batch_priv_compare_B(tcp::socket &socket, const vector<Compare_B*> &comparators, unsigned int n_threads = 2);
+void exec_batch_garbled_compare_B(tcp::socket &socket, const vector<GC_Compare_B*> &comparators);
+void exec_multiplexed_batch_lsic_B(tcp::socket &socket, const vector<LSIC_B*> &lsics, unsigned int n_threads = 2);
+void exec_multiplexed_batch_priv_compare_B(tcp::socket &socket, const vector<Compare_B*> &comparators, unsigned int n_threads = 2);
 
 void exec_enc_comparison_owner(tcp::socket &socket, EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads = 2);
 void exec_enc_comparison_helper(tcp::socket &socket, EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads = 2);
 
 void exec_rev_enc_comparison_owner(tcp::socket &socket, Rev_EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads = 2);
+// same, when the caller already ran the setup: c_z = owner.setup(lambda)
+void exec_rev_enc_comparison_owner_with_setup(tcp::socket &socket, Rev_EncCompare_Owner &owner, const mpz_class &c_z, bool decrypt_result, unsigned int n_threads = 2);
 void exec_rev_enc_comparison_helper(tcp::socket &socket, Rev_EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads = 2);
 
 void multiple_exec_enc_comparison_owner(tcp::socket &socket, vector<EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads);
 void multiple_exec_enc_comparison_helper(tcp::socket &socket, vector<EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads = 2);
 
+// the comparisons to all the thresholds run as one batch
+void exec_threshold_enc_comparison_owner(tcp::socket &socket, Threshold_EncCompare_Owner &owner, unsigned int lambda, bool decrypt_result, unsigned int n_threads = 2);
+void exec_threshold_enc_comparison_helper(tcp::socket &socket, Threshold_EncCompare_Helper &helper, bool decrypt_result, unsigned int n_threads = 2);
+
 void multiple_exec_rev_enc_comparison_owner(tcp::socket &socket, vector<Rev_EncCompare_Owner*> &owners, unsigned int lambda, bool decrypt_result, unsigned int n_threads);
+// same, when the caller already ran the setup: c_z = Rev_EncCompare_Owner::batch_setup(owners, lambda, n_threads)
+void multiple_exec_rev_enc_comparison_owner_with_setup(tcp::socket &socket, vector<Rev_EncCompare_Owner*> &owners, const vector<mpz_class> &c_z, bool decrypt_result, unsigned int n_threads);
 void multiple_exec_rev_enc_comparison_helper(tcp::socket &socket, vector<Rev_EncCompare_Helper*> &helpers, bool decrypt_result, unsigned int n_threads);
 
-void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2);
+// if timings is not NULL, the owner appends the timings of every round to it.
+// The transfer of the result is the last round, without comparison.
+void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2, vector<Round_timing> *timings = NULL);
 void exec_linear_enc_argmax(tcp::socket &socket, Linear_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads = 2);
 
-void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2);
+void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2, vector<Round_timing> *timings = NULL);
 void exec_tree_enc_argmax(tcp::socket &socket, Tree_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads = 2);
 
+// run several argmax (with the same number of elements) in lockstep: the rounds are merged
+void multiple_exec_tree_enc_argmax(tcp::socket &socket, vector<Tree_EncArgmax_Owner*> &owners, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2);
+void multiple_exec_tree_enc_argmax(tcp::socket &socket, vector<Tree_EncArgmax_Helper*> &helpers, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads = 2);
+
+void exec_tournament_enc_argmax(tcp::socket &socket, Tournament_EncArgmax_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2);
+void exec_tournament_enc_argmax(tcp::socket &socket, Tournament_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads = 2);
+
+// the layers of the network are run one after the other, each as one batch of comparisons
+void exec_bitonic_enc_top_k(tcp::socket &socket, Bitonic_EncTopK_Owner &owner, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2);
+void exec_bitonic_enc_top_k(tcp::socket &socket, Bitonic_EncTopK_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads = 2);
+
+// the owner pulls a chunk of candidates from next_chunk before every round, until it returns an empty vector
+// each round starts with its number of comparisons, 0 ends the stream
+void exec_streaming_enc_argmax(tcp::socket &socket, Streaming_EncArgmax_Owner &owner, function<vector<mpz_class>()> next_chunk, function<Comparison_protocol_A*()> comparator_creator, unsigned int lambda, unsigned int n_threads = 2);
+void exec_streaming_enc_argmax(tcp::socket &socket, Streaming_EncArgmax_Helper &helper, function<Comparison_protocol_B*()> comparator_creator, unsigned int n_threads = 2);
+
+// constant round argmax: the k(k-1)/2 comparisons are run as one batch and the helper sorts the results
+void exec_enc_argmax(tcp::socket &socket, EncArgmax_Owner &owner, unsigned int lambda, unsigned int n_threads = 2);
+void exec_enc_argmax(tcp::socket &socket, EncArgmax_Helper &helper, unsigned int n_threads = 2);
+
 Ctxt exec_change_encryption_scheme_slots(tcp::socket &socket, const vector<mpz_class> &c_gm, GM &gm, const FHEPubKey& publicKey, const EncryptedArray &ea, gmp_randstate_t randstate);
-void exec_change_encryption_scheme_slots_helper(tcp::socket &socket, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea);
+void exec_change_encryption_scheme_slots_helper(tcp::socket &socket, GM_priv &gm, const FHEPubKey &publicKey, const EncryptedArray &ea, WIRE_COMPRESSION compression = NO_COMPRESSION);
 
 mpz_class exec_compute_dot_product(tcp::socket &socket, const vector<mpz_class> &x, Paillier &p);
+// the dot products of all the xs with the same (received) vector
+vector<mpz_class> multiple_exec_compute_dot_product(tcp::socket &socket, const vector<vector<mpz_class>> &xs, Paillier &p, unsigned int n_threads = 2);
 void exec_help_compute_dot_product(tcp::socket &socket, const vector<mpz_class> &y, Paillier_priv &pp, bool encrypted_input);
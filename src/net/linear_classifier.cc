@@ -34,8 +34,6 @@ void Linear_Classifier_Server_session::run_session()
     } catch (std::exception& e) {
         std::cout << "Exception: " << e.what() << std::endl;
     }
-    
-    delete this;
 }
 
 
@@ -0,0 +1,137 @@
+#include <net/link_emulator.hh>
+
+#include <iostream>
+
+#include <sys/socket.h>
+
+using namespace std;
+
+// size of the chunks read from the sockets
+#define LINK_EMULATOR_CHUNK_SIZE 65536
+
+Link_emulator::Link_emulator(const string &remote_host, unsigned short remote_port, double rtt_ms, double bandwidth_mbps)
+: rtt_ms_(rtt_ms), bandwidth_mbps_(bandwidth_mbps), remote_host_(remote_host), remote_port_(remote_port),
+acceptor_(io_service_, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)), local_(io_service_), remote_(io_service_), stopped_(false)
+{
+    port_ = acceptor_.local_endpoint().port();
+    accept_thread_ = thread([this](){ accept_connection(); });
+}
+
+Link_emulator::~Link_emulator()
+{
+    boost::system::error_code ec;
+    {
+        lock_guard<mutex> lock(mtx_);
+        stopped_ = true;
+
+        // unblock the readers, once the connection is set up
+        if (!threads_.empty()) {
+            local_.shutdown(tcp::socket::shutdown_both, ec);
+            remote_.shutdown(tcp::socket::shutdown_both, ec);
+        }
+
+        // if no one connected, the acceptor is still waiting: make accept fail
+        // (asio has no shutdown for acceptors, and closing the descriptor does not wake accept)
+        ::shutdown(acceptor_.native_handle(), SHUT_RDWR);
+    }
+
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+
+    for (Pipe *pipe : {&upstream_, &downstream_}) {
+        lock_guard<mutex> lock(pipe->mtx);
+        pipe->closed = true;
+        pipe->cv.notify_all();
+    }
+    for (auto &t : threads_) {
+        t.join();
+    }
+}
+
+void Link_emulator::accept_connection()
+{
+    try {
+        acceptor_.accept(local_);
+
+        tcp::resolver resolver(io_service_);
+        tcp::resolver::query query(remote_host_, to_string(remote_port_));
+        boost::asio::connect(remote_, resolver.resolve(query));
+
+        lock_guard<mutex> lock(mtx_);
+        if (stopped_) {
+            return;
+        }
+        local_.set_option(tcp::no_delay(true));
+        remote_.set_option(tcp::no_delay(true));
+
+        threads_.push_back(thread([this](){ read_side(local_, upstream_); }));
+        threads_.push_back(thread([this](){ write_side(remote_, upstream_); }));
+        threads_.push_back(thread([this](){ read_side(remote_, downstream_); }));
+        threads_.push_back(thread([this](){ write_side(local_, downstream_); }));
+    } catch (std::exception& e) {
+        lock_guard<mutex> lock(mtx_);
+        // the failed accept of the destructor is expected
+        if (!stopped_) {
+            cerr << "Link emulator: " << e.what() << endl;
+        }
+    }
+}
+
+void Link_emulator::read_side(tcp::socket &from, Pipe &pipe)
+{
+    chrono::microseconds delay((long long)(rtt_ms_*500));
+    vector<char> buffer(LINK_EMULATOR_CHUNK_SIZE);
+
+    for (;;) {
+        boost::system::error_code ec;
+        size_t n = from.read_some(boost::asio::buffer(buffer), ec);
+
+        lock_guard<mutex> lock(pipe.mtx);
+        if (ec) {
+            pipe.closed = true;
+            pipe.cv.notify_all();
+            return;
+        }
+        pipe.chunks.push_back(make_pair(clock::now() + delay, vector<char>(buffer.begin(), buffer.begin()+n)));
+        pipe.cv.notify_all();
+    }
+}
+
+void Link_emulator::write_side(tcp::socket &to, Pipe &pipe)
+{
+    // the time at which the link is free again
+    clock::time_point link_free = clock::now();
+
+    for (;;) {
+        pair<clock::time_point, vector<char>> chunk;
+        {
+            unique_lock<mutex> lock(pipe.mtx);
+            pipe.cv.wait(lock, [&pipe](){ return !pipe.chunks.empty() || pipe.closed; });
+            if (pipe.chunks.empty()) {
+                break;
+            }
+            chunk = move(pipe.chunks.front());
+            pipe.chunks.pop_front();
+        }
+
+        clock::time_point delivery = chunk.first;
+        if (bandwidth_mbps_ > 0) {
+            // the chunk is sent after the previous ones
+            chrono::microseconds transmission((long long)(chunk.second.size()*8/bandwidth_mbps_));
+            delivery = max(delivery, link_free) + transmission;
+            link_free = delivery;
+        }
+        this_thread::sleep_until(delivery);
+
+        boost::system::error_code ec;
+        boost::asio::write(to, boost::asio::buffer(chunk.second), ec);
+        if (ec) {
+            return;
+        }
+    }
+
+    // forward the end of the stream
+    boost::system::error_code ec;
+    to.shutdown(tcp::socket::shutdown_send, ec);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+#include <boost/asio.hpp>
+
+using boost::asio::ip::tcp;
+
+// Relay on the loopback interface, that emulates a slower link to a remote
+// endpoint: every chunk of data is delivered after half of the round trip
+// time, and at most at the given bandwidth (in Mbit/s, 0 for no limit).
+// It accepts a single connection on port(), and forwards it to the remote
+// endpoint in both directions. It is meant to benchmark the protocols with
+// a WAN latency, with the server and the client on the same host.
+class Link_emulator {
+public:
+    Link_emulator(const std::string &remote_host, unsigned short remote_port, double rtt_ms, double bandwidth_mbps = 0);
+    // closes the connections
+    ~Link_emulator();
+
+    Link_emulator(const Link_emulator&) = delete;
+    Link_emulator &operator=(const Link_emulator &) = delete;
+
+    unsigned short port() const { return port_; }
+    double rtt() const { return rtt_ms_; }
+    double bandwidth() const { return bandwidth_mbps_; }
+
+protected:
+    typedef std::chrono::steady_clock clock;
+
+    // the data going in one direction
+    struct Pipe {
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<std::pair<clock::time_point, std::vector<char>>> chunks;
+        bool closed = false;
+    };
+
+    void accept_connection();
+    void read_side(tcp::socket &from, Pipe &pipe);
+    void write_side(tcp::socket &to, Pipe &pipe);
+
+    const double rtt_ms_, bandwidth_mbps_;
+    const std::string remote_host_;
+    const unsigned short remote_port_;
+    unsigned short port_;
+
+    boost::asio::io_service io_service_;
+    tcp::acceptor acceptor_;
+    tcp::socket local_, remote_;
+    Pipe upstream_, downstream_;
+
+    std::mutex mtx_;
+    bool stopped_;
+    std::thread accept_thread_;
+    std::vector<std::thread> threads_;
+};
@@ -23,75 +23,124 @@ std::string show_hex(const CharContainer& c)
     return hex;
 }
 
-static unsigned decode_header(const std::vector<byte>& buf)
+static unsigned decode_header(const byte *buf)
 {
-    if (buf.size() < HEADER_SIZE)
-    return 0;
     unsigned msg_size = 0;
     for (unsigned i = 0; i < HEADER_SIZE; ++i)
         msg_size = msg_size * 256 + (static_cast<unsigned>(buf[i]) & 0xFF);
     return msg_size;
 }
 
-static void encode_header(std::vector<byte>& buf, unsigned size)
+static unsigned decode_header(const std::vector<byte>& buf)
+{
+    if (buf.size() < HEADER_SIZE)
+    return 0;
+    return decode_header(buf.data());
+}
+
+static void encode_header(byte *buf, unsigned size)
 {
-    assert(buf.size() >= HEADER_SIZE);
     buf[0] = static_cast<boost::uint8_t>((size >> 24) & 0xFF);
     buf[1] = static_cast<boost::uint8_t>((size >> 16) & 0xFF);
     buf[2] = static_cast<boost::uint8_t>((size >> 8) & 0xFF);
     buf[3] = static_cast<boost::uint8_t>(size & 0xFF);
 }
 
+static void encode_header(std::vector<byte>& buf, unsigned size)
+{
+    assert(buf.size() >= HEADER_SIZE);
+    encode_header(buf.data(), size);
+}
+
+// Framing buffers, one per thread: a buffer is only used during one read or
+// write call, so the threads of a session (e.g. its multiplexed streams) never
+// share one. They are reused by the next messages of the thread and the steady
+// state does not allocate.
+// A buffer grown above MESSAGE_IO_MAX_KEPT_BUFFER by a large message (FHE
+// ciphertexts) is released after use.
+const size_t MESSAGE_IO_MAX_KEPT_BUFFER = 1 << 24;
+
+inline std::vector<byte>& message_io_read_buffer()
+{
+    static thread_local std::vector<byte> buf;
+    return buf;
+}
+
+inline std::vector<byte>& message_io_write_buffer()
+{
+    static thread_local std::vector<byte> buf;
+    return buf;
+}
+
+inline void message_io_release_buffer(std::vector<byte>& buf)
+{
+    if (buf.capacity() > MESSAGE_IO_MAX_KEPT_BUFFER) {
+        std::vector<byte>().swap(buf);
+    }
+}
+
 template <class T>
 T readMessageFromSocket(boost::asio::ip::tcp::socket &socket) {
-//    PAUSE_BENCHMARK
-    std::vector<byte> m_readbuf;
-    m_readbuf.resize(HEADER_SIZE);
+    byte header[HEADER_SIZE];
     PAUSE_BENCHMARK
-    boost::asio::read(socket, boost::asio::buffer(m_readbuf));
-//    (cerr << "Got header!\n");
-//    (cerr << show_hex(m_readbuf) << endl);
-    unsigned msg_len = decode_header(m_readbuf);
-    
-    m_readbuf.resize(HEADER_SIZE + msg_len);
+    START_IO_WAIT
+    boost::asio::read(socket, boost::asio::buffer(header, HEADER_SIZE));
+    unsigned msg_len = decode_header(header);
     
     EXCHANGED_BYTES(HEADER_SIZE + msg_len)
     INTERACTION
     
-    boost::asio::mutable_buffers_1 buf = boost::asio::buffer(&m_readbuf[HEADER_SIZE], msg_len);
-    boost::asio::read(socket, buf);
+    // only grows, the content is overwritten
+    std::vector<byte> &readbuf = message_io_read_buffer();
+    if (readbuf.size() < msg_len) {
+        readbuf.resize(msg_len);
+    }
+    boost::asio::read(socket, boost::asio::buffer(readbuf.data(), msg_len));
+    END_IO_WAIT
     RESUME_BENCHMARK
     
-//    (cerr << "Got body!\n");
-//    (cerr << show_hex(m_readbuf) << endl);
-    
+    // parse directly from the receive buffer
+    START_SERIALIZATION
     T m;
-    m.ParseFromArray(&m_readbuf[HEADER_SIZE], m_readbuf.size() - HEADER_SIZE);
+    m.ParseFromArray(readbuf.data(), msg_len);
+    END_SERIALIZATION
     
-//    RESUME_BENCHMARK
+    message_io_release_buffer(readbuf);
     return m;
 }
 
 template <class T>
 void sendMessageToSocket(boost::asio::ip::tcp::socket &socket, const T& msg) {
-   // PAUSE_BENCHMARK
-    
-    std::vector<byte> writebuf;
+    START_SERIALIZATION
     unsigned msg_size = msg.ByteSize();
     
-    writebuf.resize(HEADER_SIZE + msg_size);
-    
     EXCHANGED_BYTES(HEADER_SIZE + msg_size);
     INTERACTION
     
-    encode_header(writebuf, msg_size);
+    byte header[HEADER_SIZE];
+    encode_header(header, msg_size);
     
-    if (!msg.SerializeToArray(&writebuf[HEADER_SIZE], msg_size)) {
+    std::vector<byte> &writebuf = message_io_write_buffer();
+    if (writebuf.size() < msg_size) {
+        writebuf.resize(msg_size);
+    }
+    
+    bool serialized = msg.SerializeToArray(writebuf.data(), msg_size);
+    END_SERIALIZATION
+    if (!serialized) {
         std::cerr << "Error when serializing" << std::endl;
         return;
     }
-    boost::asio::write(socket, boost::asio::buffer(writebuf));
-   // RESUME_BENCHMARK
+    
+    // header and body in a single gathered write
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.push_back(boost::asio::buffer(header, HEADER_SIZE));
+    buffers.push_back(boost::asio::buffer(writebuf.data(), msg_size));
+    START_IO_WAIT
+    boost::asio::write(socket, buffers);
+    END_IO_WAIT
+    
+    message_io_release_buffer(writebuf);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include <net/mux_channel.hh>
+
+#include <cassert>
+#include <stdexcept>
+
+#include <protobuf/protobuf_conversion.hh>
+#include <util/benchmarks.hh>
+
+using namespace std;
+
+#define MUX_HEADER_SIZE 8
+// the largest frame accepted from the peer
+#define MUX_MAX_FRAME_SIZE (1UL << 28)
+
+static void encode_u32(byte *buf, uint32_t v)
+{
+    buf[0] = static_cast<byte>((v >> 24) & 0xFF);
+    buf[1] = static_cast<byte>((v >> 16) & 0xFF);
+    buf[2] = static_cast<byte>((v >> 8) & 0xFF);
+    buf[3] = static_cast<byte>(v & 0xFF);
+}
+
+static uint32_t decode_u32(const byte *buf)
+{
+    uint32_t v = 0;
+    for (unsigned i = 0; i < 4; ++i)
+        v = v * 256 + (static_cast<uint32_t>(buf[i]) & 0xFF);
+    return v;
+}
+
+Mux_channel::Mux_channel(tcp::socket &socket, size_t n_streams)
+: socket_(socket), reading_(false), queues_(n_streams)
+{
+}
+
+void Mux_channel::send(uint32_t stream_id, const vector<byte> &payload)
+{
+    byte header[MUX_HEADER_SIZE];
+    encode_u32(header, payload.size());
+    encode_u32(header+4, stream_id);
+
+    vector<boost::asio::const_buffer> buffers;
+    buffers.push_back(boost::asio::buffer(header, MUX_HEADER_SIZE));
+    buffers.push_back(boost::asio::buffer(payload));
+
+    EXCHANGED_BYTES(MUX_HEADER_SIZE + payload.size())
+    INTERACTION
+
+    lock_guard<mutex> lock(write_mtx_);
+    boost::asio::write(socket_, buffers);
+}
+
+// called without read_mtx_, by the only thread reading the socket
+void Mux_channel::read_frame()
+{
+    byte header[MUX_HEADER_SIZE];
+    boost::asio::read(socket_, boost::asio::buffer(header, MUX_HEADER_SIZE));
+
+    uint32_t len = decode_u32(header);
+    uint32_t stream_id = decode_u32(header+4);
+
+    if (len > MUX_MAX_FRAME_SIZE) {
+        throw std::runtime_error("Invalid multiplexed frame size");
+    }
+    if (stream_id >= queues_.size()) {
+        throw std::runtime_error("Invalid multiplexed stream id");
+    }
+
+    vector<byte> payload(len);
+    boost::asio::read(socket_, boost::asio::buffer(payload));
+
+    EXCHANGED_BYTES(MUX_HEADER_SIZE + len)
+    INTERACTION
+
+    lock_guard<mutex> lock(read_mtx_);
+    queues_[stream_id].push_back(move(payload));
+}
+
+void Mux_channel::fail(exception_ptr error)
+{
+    {
+        lock_guard<mutex> lock(read_mtx_);
+        if (!read_error_) {
+            read_error_ = error;
+        }
+        read_cv_.notify_all();
+    }
+
+    boost::system::error_code ec;
+    socket_.shutdown(tcp::socket::shutdown_both, ec);
+}
+
+exception_ptr Mux_channel::error()
+{
+    lock_guard<mutex> lock(read_mtx_);
+    return read_error_;
+}
+
+vector<byte> Mux_channel::receive(uint32_t stream_id)
+{
+    assert(stream_id < queues_.size());
+    unique_lock<mutex> lock(read_mtx_);
+
+    for (;;) {
+        deque<vector<byte>> &q = queues_[stream_id];
+        if (!q.empty()) {
+            vector<byte> payload = move(q.front());
+            q.pop_front();
+            return payload;
+        }
+
+        if (read_error_) {
+            rethrow_exception(read_error_);
+        }
+
+        if (reading_) {
+            // another stream is reading the socket, it will wake us up
+            read_cv_.wait(lock);
+            continue;
+        }
+
+        reading_ = true;
+        lock.unlock();
+
+        exception_ptr error;
+        try {
+            read_frame();
+        } catch (...) {
+            error = current_exception();
+        }
+
+        lock.lock();
+        reading_ = false;
+        if (error && !read_error_) {
+            read_error_ = error;
+        }
+        read_cv_.notify_all();
+    }
+}
+
+void send_int_array_to_socket(Mux_stream &stream, const vector<mpz_class>& m)
+{
+    Protobuf::BigIntArray msg = convert_to_message(m);
+    sendMessageToSocket(stream,msg);
+}
+
+vector<mpz_class> read_int_array_from_socket(Mux_stream &stream)
+{
+    Protobuf::BigIntArray msg = readMessageFromSocket<Protobuf::BigIntArray>(stream);
+    return convert_from_message(msg);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include <boost/asio.hpp>
+#include <gmpxx.h>
+
+#include <net/message_io.hh>
+
+using boost::asio::ip::tcp;
+
+// Multiplexes several logical streams over a single socket.
+// Each frame is a 4 bytes length, a 4 bytes stream id and the payload.
+// There is no dedicated reader thread: a stream waiting for data reads the
+// socket and queues the frames of the other streams until it gets its own.
+// Both ends must open the same n_streams streams, and must only use the socket
+// through the channel while it exists.
+class Mux_channel {
+public:
+    Mux_channel(tcp::socket &socket, size_t n_streams);
+
+    void send(uint32_t stream_id, const std::vector<byte> &payload);
+    std::vector<byte> receive(uint32_t stream_id);
+
+    // Make every pending and future receive throw error, and shut the socket
+    // down so that the stream reading it and the peer are unblocked too.
+    // Only the first error is kept.
+    void fail(std::exception_ptr error);
+    std::exception_ptr error();
+
+protected:
+    void read_frame();
+
+    tcp::socket &socket_;
+
+    std::mutex write_mtx_;
+
+    std::mutex read_mtx_;
+    std::condition_variable read_cv_;
+    bool reading_;
+    std::exception_ptr read_error_;
+    std::vector<std::deque<std::vector<byte>>> queues_;
+};
+
+class Mux_stream {
+public:
+    Mux_stream(Mux_channel &channel, uint32_t id) : channel_(channel), id_(id) {}
+
+    uint32_t id() const { return id_; }
+
+    void send(const std::vector<byte> &payload) { channel_.send(id_, payload); }
+    std::vector<byte> receive() { return channel_.receive(id_); }
+
+protected:
+    Mux_channel &channel_;
+    uint32_t id_;
+};
+
+// same interface as the socket functions of message_io.hh and net_utils.hh
+
+template <class T>
+T readMessageFromSocket(Mux_stream &stream) {
+    std::vector<byte> buf = stream.receive();
+
+    T m;
+    m.ParseFromArray(buf.data(), buf.size());
+    return m;
+}
+
+template <class T>
+void sendMessageToSocket(Mux_stream &stream, const T& msg) {
+    std::vector<byte> buf(msg.ByteSize());
+
+    if (!msg.SerializeToArray(buf.data(), buf.size())) {
+        std::cerr << "Error when serializing" << std::endl;
+        return;
+    }
+    stream.send(buf);
+}
+
+void send_int_array_to_socket(Mux_stream &stream, const std::vector<mpz_class>& m);
+std::vector<mpz_class> read_int_array_from_socket(Mux_stream &stream);
@@ -2,6 +2,9 @@
 #include <net/net_utils.hh>
 #include <gmpxx.h>
 #include <string>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
 
 #include <net/defs.hh>
 
@@ -114,9 +117,9 @@ vector<mpz_class> read_int_array_from_socket(boost::asio::ip::tcp::socket &socke
 }
 
 
-void send_fhe_ctxt_to_socket(boost::asio::ip::tcp::socket &socket, const Ctxt &c)
+void send_fhe_ctxt_to_socket(boost::asio::ip::tcp::socket &socket, const Ctxt &c, WIRE_COMPRESSION compression)
 {
-    Protobuf::FHE_Ctxt msg = convert_to_message(c);
+    Protobuf::FHE_Ctxt msg = convert_to_message(c, compression);
     sendMessageToSocket(socket,msg);
 }
 
@@ -130,7 +133,9 @@ Ctxt read_fhe_ctxt_from_socket(boost::asio::ip::tcp::socket &socket, const FHEPu
 void read_byte_string_from_socket(boost::asio::ip::tcp::socket &socket, unsigned char *buffer, size_t byte_count)
 {
     PAUSE_BENCHMARK
+    START_IO_WAIT
     boost::asio::read(socket, boost::asio::buffer(buffer, byte_count));
+    END_IO_WAIT
     
     EXCHANGED_BYTES(byte_count)
     INTERACTION
@@ -146,7 +151,9 @@ void read_byte_string_from_socket(boost::asio::ip::tcp::socket &socket, char *bu
 void write_byte_string_to_socket(boost::asio::ip::tcp::socket &socket, unsigned char *buffer, size_t byte_count)
 {
     PAUSE_BENCHMARK
+    START_IO_WAIT
     boost::asio::write(socket, boost::asio::buffer(buffer, byte_count));
+    END_IO_WAIT
     
     EXCHANGED_BYTES(byte_count)
     INTERACTION
@@ -181,4 +188,15 @@ void write_block_to_socket(__m128i block, boost::asio::ip::tcp::socket &socket)
     u.v = block;
     
     write_byte_string_to_socket(socket, (unsigned char*)u.a, sizeof(__m128i));
-}
\ No newline at end of file
+}
+
+double socket_rtt_ms(boost::asio::ip::tcp::socket &socket)
+{
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    
+    if (getsockopt(socket.native_handle(), IPPROTO_TCP, TCP_INFO, &info, &len) != 0 || info.tcpi_rtt == 0) {
+        return -1;
+    }
+    return info.tcpi_rtt/1000.0;
+}
@@ -10,6 +10,8 @@
 
 #include <FHE.h>
 
+#include <protobuf/protobuf_conversion.hh>
+
 #include <xmmintrin.h>
 #include <emmintrin.h>
 #include <smmintrin.h>
@@ -37,7 +39,7 @@ void send_int_array_to_socket(boost::asio::ip::tcp::socket &socket, const vector
 vector<mpz_class> read_int_array_from_socket(boost::asio::ip::tcp::socket &socket);
 
 
-void send_fhe_ctxt_to_socket(boost::asio::ip::tcp::socket &socket, const Ctxt &c);
+void send_fhe_ctxt_to_socket(boost::asio::ip::tcp::socket &socket, const Ctxt &c, WIRE_COMPRESSION compression = NO_COMPRESSION);
 Ctxt read_fhe_ctxt_from_socket(boost::asio::ip::tcp::socket &socket, const FHEPubKey &pubkey);
 
 
@@ -47,4 +49,8 @@ void write_byte_string_to_socket(boost::asio::ip::tcp::socket &socket, unsigned
 void write_byte_string_to_socket(boost::asio::ip::tcp::socket &socket, char *buffer, size_t byte_count);
 
 __m128i read_block_from_socket(boost::asio::ip::tcp::socket &socket);
-void write_block_to_socket(__m128i block, boost::asio::ip::tcp::socket &socket);
\ No newline at end of file
+void write_block_to_socket(__m128i block, boost::asio::ip::tcp::socket &socket);
+
+// smoothed round trip time measured by the kernel on the messages already exchanged over the socket, in ms
+// returns a negative value if it is not available yet
+double socket_rtt_ms(boost::asio::ip::tcp::socket &socket);
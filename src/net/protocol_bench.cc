@@ -243,7 +243,7 @@ void Bench_Client::bench_rev_enc_compare(size_t bit_size, unsigned int iteration
 }
 
 
-void Bench_Client::bench_linear_enc_argmax(size_t n_elements, size_t bit_size,unsigned int iterations, COMPARISON_PROTOCOL comparison_prot)
+void Bench_Client::bench_linear_enc_argmax(size_t n_elements, size_t bit_size,unsigned int iterations, COMPARISON_PROTOCOL comparison_prot, vector<vector<Round_timing>> *timings)
 {
     size_t k = n_elements;
     size_t nbits = bit_size;
@@ -264,16 +264,26 @@ void Bench_Client::bench_linear_enc_argmax(size_t n_elements, size_t bit_size,un
             v[i] = server_paillier_->encrypt(v[i]);
         }
         
-        
+        t.lap(); // reset timer
         Linear_EncArgmax_Owner owner(v,nbits,*server_paillier_,rand_state_, lambda_);
+        double setup_time = t.lap_ms();
+        
+        vector<Round_timing> rounds;
         
         RESET_BENCHMARK_TIMER
         t.lap(); // reset timer
         
-        run_linear_enc_argmax(owner,comparison_prot);
+        run_linear_enc_argmax(owner,comparison_prot, (timings ? &rounds : NULL));
         
         cpu_time += GET_BENCHMARK_TIME;
         total_time += t.lap_ms();
+        
+        if (timings) {
+            if (!rounds.empty()) {
+                rounds[0].setup_ms += setup_time;
+            }
+            timings->push_back(rounds);
+        }
     }
     
     cout << "Owner Enc Argmax bench for " << n_elements << " elements, " << iterations << " rounds, bit size=" << bit_size << " using " <<  protocol_string(comparison_prot) << endl;
@@ -285,7 +295,7 @@ void Bench_Client::bench_linear_enc_argmax(size_t n_elements, size_t bit_size,un
 #endif
 }
 
-void Bench_Client::bench_tree_enc_argmax(size_t n_elements, size_t bit_size,unsigned int iterations, COMPARISON_PROTOCOL comparison_prot)
+void Bench_Client::bench_tree_enc_argmax(size_t n_elements, size_t bit_size,unsigned int iterations, COMPARISON_PROTOCOL comparison_prot, vector<vector<Round_timing>> *timings)
 {
     size_t k = n_elements;
     size_t nbits = bit_size;
@@ -306,16 +316,26 @@ void Bench_Client::bench_tree_enc_argmax(size_t n_elements, size_t bit_size,unsi
             v[i] = server_paillier_->encrypt(v[i]);
         }
         
-        
+        t.lap(); // reset timer
         Tree_EncArgmax_Owner owner(v,nbits,*server_paillier_,rand_state_, lambda_);
+        double setup_time = t.lap_ms();
+        
+        vector<Round_timing> rounds;
         
         RESET_BENCHMARK_TIMER
         t.lap(); // reset timer
         
-        run_tree_enc_argmax(owner,comparison_prot);
+        run_tree_enc_argmax(owner,comparison_prot, (timings ? &rounds : NULL));
         
         cpu_time += GET_BENCHMARK_TIME;
         total_time += t.lap_ms();
+        
+        if (timings) {
+            if (!rounds.empty()) {
+                rounds[0].setup_ms += setup_time;
+            }
+            timings->push_back(rounds);
+        }
     }
     
     cout << "Owner Tree Enc Argmax bench for " << n_elements << " elements, " << iterations << " rounds, bit size=" << bit_size << " using " <<  protocol_string(comparison_prot) << endl;
@@ -566,9 +586,6 @@ void Bench_Server_session::run_session()
     } catch (std::exception& e) {
         std::cout << "Exception: " << e.what() << std::endl;
     }
-    
-    // we are done, delete ourself
-    delete this;
 }
 
 /* BENCH CALLS */
@@ -674,7 +691,7 @@ void Bench_Server_session::bench_linear_enc_argmax(size_t n_elements, size_t bit
     double cpu_time = 0.;
     
     for (unsigned int i = 0; i < iterations; i++) {
-        Linear_EncArgmax_Helper helper(bit_size,n_elements,server_->paillier());
+        Linear_EncArgmax_Helper helper(bit_size,n_elements,server_->paillier(),server_->paillier_constants());
         RESET_BENCHMARK_TIMER
         run_linear_enc_argmax(helper,comparison_prot);
         cpu_time += GET_BENCHMARK_TIME;
@@ -689,7 +706,7 @@ void Bench_Server_session::bench_tree_enc_argmax(size_t n_elements, size_t bit_s
     double cpu_time = 0.;
     
     for (unsigned int i = 0; i < iterations; i++) {
-        Tree_EncArgmax_Helper helper(bit_size,n_elements,server_->paillier());
+        Tree_EncArgmax_Helper helper(bit_size,n_elements,server_->paillier(),server_->paillier_constants());
         RESET_BENCHMARK_TIMER
         run_tree_enc_argmax(helper,comparison_prot);
         cpu_time += GET_BENCHMARK_TIME;
@@ -45,8 +45,10 @@ class Bench_Client : public Client{
     void bench_garbled_compare(size_t bit_size, unsigned int iterations);
     void bench_enc_compare(size_t bit_size, unsigned int iterations, COMPARISON_PROTOCOL comparison_prot);
     void bench_rev_enc_compare(size_t bit_size, unsigned int iterations, COMPARISON_PROTOCOL comparison_prot);
-    void bench_linear_enc_argmax(size_t n_elements, size_t bit_size,unsigned int iterations, COMPARISON_PROTOCOL comparison_prot);
-    void bench_tree_enc_argmax(size_t n_elements, size_t bit_size,unsigned int iterations, COMPARISON_PROTOCOL comparison_prot);
+    // if timings is not NULL, the round timings of every iteration are appended to it.
+    // The creation of the owner is in the setup of the first round.
+    void bench_linear_enc_argmax(size_t n_elements, size_t bit_size,unsigned int iterations, COMPARISON_PROTOCOL comparison_prot, vector<vector<Round_timing>> *timings = NULL);
+    void bench_tree_enc_argmax(size_t n_elements, size_t bit_size,unsigned int iterations, COMPARISON_PROTOCOL comparison_prot, vector<vector<Round_timing>> *timings = NULL);
     void bench_change_es(unsigned int iterations);
     void bench_ot(size_t n_elements ,unsigned int iterations);
     
@@ -223,7 +223,7 @@ void Tester_Client::test_fhe()
     
     send_test_query(Test_Request_Request_Type_TEST_FHE);
 
-    Protobuf::FHE_Ctxt m = convert_to_message(c0);
+    Protobuf::FHE_Ctxt m = convert_to_message(c0, compression_);
     sendMessageToSocket<Protobuf::FHE_Ctxt>(socket_,m);
 }
 
@@ -247,7 +247,7 @@ void Tester_Client::test_change_es()
     
     Ctxt c_fhe = change_encryption_scheme(c_gm);
     
-    send_fhe_ctxt_to_socket(socket_, c_fhe);
+    send_fhe_ctxt_to_socket(socket_, c_fhe, compression_);
     for (size_t i = 0; i < bits_query.size(); i++) {
         cout << "[" << bits_query[i] << "]";
     }
@@ -336,7 +336,7 @@ void Tester_Server_session::run_session()
                 case Test_Request_Request_Type_TEST_LINEAR_ENC_ARGMAX:
                 {
                     cout << id_ << ": Test Linear Enc Argmax" << endl;
-                    Linear_EncArgmax_Helper helper(100,5,server_->paillier());
+                    Linear_EncArgmax_Helper helper(100,5,server_->paillier(),server_->paillier_constants());
                     run_linear_enc_argmax(helper,comparison_prot__);
                 }
                     break;
@@ -372,7 +372,7 @@ void Tester_Server_session::run_session()
                 case Test_Request_Request_Type_TEST_TREE_ENC_ARGMAX:
                 {
                     cout << id_ << ": Test Tree Enc Argmax" << endl;
-                    Tree_EncArgmax_Helper helper(100,5,server_->paillier());
+                    Tree_EncArgmax_Helper helper(100,5,server_->paillier(),server_->paillier_constants());
                     run_tree_enc_argmax(helper,comparison_prot__);
                 }
                     break;
@@ -397,9 +397,6 @@ void Tester_Server_session::run_session()
     } catch (std::exception& e) {
         std::cout << "Exception: " << e.what() << std::endl;
     }
-    
-    // we are done, delete ourself
-    delete this;
 }
 
 /* TESTS */
@@ -35,8 +35,8 @@ class  Tester_Server : public Server{
 
 class Tester_Client : public Client{
     public:
-    Tester_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, unsigned int lambda)
-    : Client(io_service,state,Tester_Server::key_deps_descriptor(),keysize,lambda) {};
+    Tester_Client(boost::asio::io_service& io_service, gmp_randstate_t state, unsigned int keysize, unsigned int lambda, const string &session_file = "")
+    : Client(io_service,state,Tester_Server::key_deps_descriptor(),keysize,lambda,session_file) {};
     
     void send_test_query(enum Test_Request_Request_Type type);
 
@@ -8,6 +8,7 @@
 #include <FHE.h>
 #include <EncryptedArray.h>
 #include <util/fhe_util.hh>
+#include <util/util.hh>
 
 #include <net/defs.hh>
 
@@ -17,8 +18,12 @@
 #include <mpc/garbled_comparison.hh>
 #include <mpc/enc_comparison.hh>
 #include <mpc/rev_enc_comparison.hh>
+#include <mpc/enc_argmax.hh>
 #include <mpc/linear_enc_argmax.hh>
 #include <mpc/tree_enc_argmax.hh>
+#include <mpc/tournament_enc_argmax.hh>
+#include <mpc/bitonic_enc_top_k.hh>
+#include <mpc/streaming_enc_argmax.hh>
 
 #include <net/server.hh>
 #include <net/net_utils.hh>
@@ -34,9 +39,11 @@ using boost::asio::ip::tcp;
 using namespace std;
 
 #define OT_SECPARAM 1024
+// pause of an acceptor after a failed accept
+#define ACCEPT_ERROR_BACKOFF_MS 100
 
 Server::Server(gmp_randstate_t state, Key_dependencies_descriptor key_deps_desc, unsigned int keysize, unsigned int lambda)
-: key_deps_desc_(key_deps_desc), paillier_(NULL), gm_(NULL), fhe_context_(NULL), fhe_sk_(NULL), n_clients_(0), threads_per_session_(1), lambda_(lambda)
+: key_deps_desc_(key_deps_desc), paillier_(NULL), paillier_constants_(NULL), gm_(NULL), fhe_context_(NULL), fhe_sk_(NULL), n_clients_(0), crypto_thread_budget_(max(thread::hardware_concurrency(), 1U)), max_sessions_(MAX_CONCURRENT_SESSIONS), session_queue_length_(SESSION_QUEUE_LENGTH), scheduler_(NULL), keysize_(keysize), port_(PORT), n_acceptors_(1), reuse_port_(false), session_tickets_(SESSION_TICKET_CACHE_SIZE), lambda_(lambda)
 {
     gmp_randinit_set(rand_state_, state);
 
@@ -46,6 +53,8 @@ Server::Server(gmp_randstate_t state, Key_dependencies_descriptor key_deps_desc,
 
 Server::~Server()
 {
+    delete scheduler_;
+    delete paillier_constants_;
     delete fhe_sk_;
     delete fhe_context_;
 }
@@ -85,7 +94,9 @@ void Server::init_Paillier(unsigned int keysize)
     }
     
     paillier_ = new Paillier_priv_fast(Paillier_priv_fast::keygen(rand_state_,keysize), rand_state_);
-        
+    
+    // starts filling in the background
+    paillier_constants_ = new Paillier_constants_pool(paillier_->pubkey(), rand_state_);
 }
 
 void Server::init_FHE_context()
@@ -110,36 +121,157 @@ void Server::init_FHE_key()
     fhe_sk_->GenSecKey(FHE_w); // A Hamming-weight-w secret key
 }
 
+void Server::calibrate_cost_model()
+{
+    cout << "Calibrate the comparison cost model" << endl;
+    cost_model_.calibrate(keysize_, COST_MODEL_CALIBRATION_BITS, rand_state_);
+}
+
+unsigned int Server::threads_per_session() const
+{
+    if (scheduler_) {
+        return scheduler_->threads_per_session();
+    }
+    return crypto_thread_budget_;
+}
+
+void Server::set_crypto_thread_budget(unsigned int n)
+{
+    assert(n > 0);
+    crypto_thread_budget_ = n;
+    if (scheduler_) {
+        scheduler_->set_thread_budget(n);
+    }
+}
+
+#ifdef SO_REUSEPORT
+// SO_REUSEPORT, as a settable socket option of asio
+class reuse_port_option {
+public:
+    explicit reuse_port_option(bool enable) : value_(enable ? 1 : 0) {}
+    
+    template <class Protocol> int level(const Protocol&) const { return SOL_SOCKET; }
+    template <class Protocol> int name(const Protocol&) const { return SO_REUSEPORT; }
+    template <class Protocol> const int* data(const Protocol&) const { return &value_; }
+    template <class Protocol> size_t size(const Protocol&) const { return sizeof(value_); }
+    
+private:
+    int value_;
+};
+#endif
+
 void Server::run()
 {
+    calibrate_cost_model();
+
+    scheduler_ = new Session_scheduler(max_sessions_, session_queue_length_, crypto_thread_budget_);
+
     try
     {
-        boost::asio::io_service io_service;
+        boost::asio::io_service &io_service = io_service_;
         
-        tcp::endpoint endpoint(tcp::v4(), PORT);
-        tcp::acceptor acceptor(io_service, endpoint);
+        tcp::endpoint endpoint;
+        if (listen_address_.empty()) {
+            endpoint = tcp::endpoint(tcp::v6(), port_);
+        }else{
+            endpoint = tcp::endpoint(boost::asio::ip::address::from_string(listen_address_), port_);
+        }
+        
+        // several acceptors can only share the port with SO_REUSEPORT
+        bool reuse_port = reuse_port_ || n_acceptors_ > 1;
+        
+        vector<unique_ptr<tcp::acceptor>> acceptors;
+        for (unsigned int i = 0; i < n_acceptors_; i++) {
+            acceptors.emplace_back(open_acceptor(io_service, endpoint, reuse_port));
+            // if the port was chosen by the system, the other acceptors must use it too
+            endpoint = acceptors.back()->local_endpoint();
+        }
+        cout << "Listening on " << endpoint << " with " << n_acceptors_ << " acceptor(s)" << endl;
+        
+        vector<thread> threads;
+        for (size_t i = 1; i < acceptors.size(); i++) {
+            threads.push_back(thread(&Server::accept_loop, this, ref(*acceptors[i])));
+        }
+        accept_loop(*acceptors[0]);
         
-        for (;;)
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+tcp::acceptor* Server::open_acceptor(boost::asio::io_service &io_service, tcp::endpoint &endpoint, bool reuse_port)
+{
+    unique_ptr<tcp::acceptor> acceptor(new tcp::acceptor(io_service));
+    
+    boost::system::error_code ec;
+    acceptor->open(endpoint.protocol(), ec);
+    if (ec && listen_address_.empty()) {
+        // no IPv6 on this host
+        endpoint = tcp::endpoint(tcp::v4(), endpoint.port());
+        acceptor->open(endpoint.protocol());
+    }else if (ec) {
+        throw boost::system::system_error(ec);
+    }
+    
+    if (listen_address_.empty() && endpoint.protocol() == tcp::v6()) {
+        // accept the IPv4 clients too
+        acceptor->set_option(boost::asio::ip::v6_only(false), ec);
+    }
+    acceptor->set_option(tcp::acceptor::reuse_address(true));
+    
+    if (reuse_port) {
+#ifdef SO_REUSEPORT
+        acceptor->set_option(reuse_port_option(true));
+#else
+        throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+    }
+    
+    acceptor->bind(endpoint);
+    acceptor->listen();
+    
+    return acceptor.release();
+}
+
+void Server::accept_loop(tcp::acceptor &acceptor)
+{
+    boost::asio::io_service &io_service = io_service_;
+    
+    while (acceptor.is_open())
+    {
+        // a failed connection must not stop this listener: report it and accept the next one
+        try
         {
             tcp::socket socket(io_service);
             acceptor.accept(socket);
             
             Server_session *c = create_new_server_session(socket);
             
-            cout << "Start new connexion: " << c->id() << endl;
-            thread t (&Server_session::run_session,c);
-            t.detach();
+            if (!scheduler_->submit(c)) {
+                cout << "Refuse connexion: " << c->id() << ", " << scheduler_->queue_length() << " sessions waiting" << endl;
+                delete c;
+                continue;
+            }
+            cout << "Queue new connexion: " << c->id() << endl;
+        }
+        catch (std::exception& e)
+        {
+            boost::system::error_code ec;
+            std::cerr << "Accept error on " << acceptor.local_endpoint(ec) << ": " << e.what() << std::endl;
+            // do not spin if the error persists (e.g. out of file descriptors)
+            this_thread::sleep_for(chrono::milliseconds(ACCEPT_ERROR_BACKOFF_MS));
         }
-    }
-    catch (std::exception& e)
-    {
-        std::cerr << e.what() << std::endl;
     }
 }
 
 
 Server_session::Server_session(Server *server, gmp_randstate_t state, unsigned int id, tcp::socket &socket)
-: server_(server), socket_(std::move(socket)), client_gm_(NULL), client_paillier_(NULL), client_fhe_pk_(NULL), id_(id)
+: server_(server), socket_(std::move(socket)), compression_(NO_COMPRESSION), client_gm_(NULL), client_paillier_(NULL), client_fhe_pk_(NULL), id_(id)
 {
     gmp_randinit_set(rand_state_, state);
 }
@@ -177,7 +309,7 @@ void Server_session::send_fhe_context()
 {
     const FHEcontext &context = server_->fhe_context();
     cout << id_ << ": Send FHE Context" << endl;
-    Protobuf::FHE_Context pk_message = convert_to_message(context);
+    Protobuf::FHE_Context pk_message = convert_to_message(context, compression_);
     
     sendMessageToSocket<Protobuf::FHE_Context>(socket_,pk_message);
 }
@@ -187,7 +319,7 @@ void Server_session::send_fhe_pk()
     const FHEPubKey& publicKey = server_->fhe_sk(); // cast so we only send the public informations
     cout << id_ << ": Send FHE PK" << endl;
 
-    Protobuf::FHE_PK pk_message = get_pk_message(publicKey);
+    Protobuf::FHE_PK pk_message = get_pk_message(publicKey, compression_);
     
     sendMessageToSocket<Protobuf::FHE_PK>(socket_,pk_message);
 
@@ -228,9 +360,65 @@ void Server_session::get_client_pk_fhe()
 }
 
 
+// offer our best compression, the client answers with the one to use
+void Server_session::negotiate_compression()
+{
+    sendIntToSocket(socket_, SUPPORTED_WIRE_COMPRESSION);
+    
+    mpz_class c = readIntFromSocket(socket_);
+    if (c < NO_COMPRESSION || c > SUPPORTED_WIRE_COMPRESSION) {
+        throw std::runtime_error("Invalid wire compression");
+    }
+    compression_ = (WIRE_COMPRESSION)c.get_ui();
+}
+
+// the client sends the ticket of its previous session (if any)
+// if we still know it, we reuse the keys of the client, and the client the ones of the server
+// otherwise, the client gets a new ticket and we do the full key exchange
+bool Server_session::resume_session()
+{
+    Protobuf::Session_Ticket ticket_msg = readMessageFromSocket<Protobuf::Session_Ticket>(socket_);
+
+    Client_keys keys;
+    Protobuf::Session_Ticket_Answer answer;
+
+    if (ticket_msg.has_id() && server_->session_tickets().lookup(ticket_msg.id(), keys)) {
+        answer.set_resumed(true);
+        answer.set_id(ticket_msg.id());
+        sendMessageToSocket(socket_, answer);
+
+        if (keys.has_gm) {
+            client_gm_ = create_from_pk_message(keys.gm_pk,rand_state_);
+        }
+        if (keys.has_paillier) {
+            client_paillier_ = create_from_pk_message(keys.paillier_pk,rand_state_);
+        }
+        if (keys.has_fhe) {
+            client_fhe_pk_ = create_from_pk_message(keys.fhe_pk,server_->fhe_context());
+        }
+        cout << id_ << ": Session resumed" << endl;
+        return true;
+    }
+
+    ticket_ = Session_ticket_cache::new_ticket();
+    answer.set_resumed(false);
+    answer.set_id(ticket_);
+    sendMessageToSocket(socket_, answer);
+    return false;
+}
+
 void Server_session::exchange_keys()
 {
     Key_dependencies_descriptor key_deps_desc = server_->key_deps_desc();
+    bool use_fhe = key_deps_desc.need_server_fhe || key_deps_desc.need_client_fhe;
+
+    if (resume_session()) {
+        if (use_fhe) {
+            negotiate_compression();
+        }
+        return;
+    }
+
     if (key_deps_desc.need_server_gm) {
         send_gm_pk();
     }
@@ -238,16 +426,24 @@ void Server_session::exchange_keys()
         send_paillier_pk();
     }
 
+    Client_keys keys;
+
     if (key_deps_desc.need_client_gm) {
-        get_client_pk_gm();
+        keys.gm_pk = readMessageFromSocket<Protobuf::GM_PK>(socket_);
+        keys.has_gm = true;
+        cout << id_ << ": Received GM PK" << endl;
+        client_gm_ = create_from_pk_message(keys.gm_pk,rand_state_);
     }
     if (key_deps_desc.need_client_paillier) {
-        get_client_pk_paillier();
+        keys.paillier_pk = readMessageFromSocket<Protobuf::Paillier_PK>(socket_);
+        keys.has_paillier = true;
+        cout << id_ << ": Received Paillier PK" << endl;
+        client_paillier_ = create_from_pk_message(keys.paillier_pk,rand_state_);
     }
     
-    if (key_deps_desc.need_server_fhe ||
-        key_deps_desc.need_client_fhe) {
+    if (use_fhe) {
         // if we use FHE, we need to send the context to the client before doing anything
+        negotiate_compression();
         send_fhe_context();
     }
 
@@ -255,9 +451,13 @@ void Server_session::exchange_keys()
         send_fhe_pk();
     }
     if (key_deps_desc.need_client_fhe) {
-        get_client_pk_fhe();
+        keys.fhe_pk = readMessageFromSocket<Protobuf::FHE_PK>(socket_);
+        keys.has_fhe = true;
+        cout << id_ << ": Received FHE PK" << endl;
+        client_fhe_pk_ = create_from_pk_message(keys.fhe_pk,server_->fhe_context());
     }
 
+    server_->session_tickets().store(ticket_, keys);
 }
 
 
@@ -418,13 +618,14 @@ vector<bool> Server_session::multiple_enc_comparison(const vector<mpz_class> &a,
     size_t n = a.size();
     vector<EncCompare_Owner*> owners(n);
     
+    comparison_prot = resolve_comparison_protocol(comparison_prot, l, n, true);
+    
     for (size_t i = 0; i < n; i++) {
         owners[i] = new EncCompare_Owner(create_enc_comparator_owner(l, comparison_prot));
         owners[i]->set_input(a[i],b[i]);
     }
     
-    unsigned int thread_per_job = ceilf(((float)server_->threads_per_session())/n);
-    multiple_exec_enc_comparison_owner(socket_, owners, server_->lambda(), true, thread_per_job);
+    multiple_exec_enc_comparison_owner(socket_, owners, server_->lambda(), true, server_->threads_per_session());
     
     vector<bool> results(n);
     
@@ -441,13 +642,14 @@ void Server_session::multiple_help_enc_comparison(const size_t n, const size_t &
 {
     vector<EncCompare_Helper*> helpers(n);
     
+    comparison_prot = resolve_comparison_protocol(comparison_prot, l, n, false);
+    
     for (size_t i = 0; i < n; i++) {
         helpers[i] = new EncCompare_Helper(create_enc_comparator_helper(l, comparison_prot));
         
     }
     
-    unsigned int thread_per_job = ceilf(((float)server_->threads_per_session())/n);
-    multiple_exec_enc_comparison_helper(socket_, helpers, true, thread_per_job);
+    multiple_exec_enc_comparison_helper(socket_, helpers, true, server_->threads_per_session());
     
     for (size_t i = 0; i < n; i++) {
         delete helpers[i];
@@ -455,19 +657,29 @@ void Server_session::multiple_help_enc_comparison(const size_t n, const size_t &
 }
 
 
+void Server_session::help_threshold_enc_comparison(const size_t m, const size_t &l, COMPARISON_PROTOCOL comparison_prot)
+{
+    comparison_prot = resolve_comparison_protocol(comparison_prot, l, m, false);
+    function<Comparison_protocol_A*()> comparator_creator = comparator_creator_A(l, comparison_prot);
+    
+    Threshold_EncCompare_Helper helper(l, m, server_->paillier(), comparator_creator);
+    exec_threshold_enc_comparison_helper(socket_, helper, true, server_->threads_per_session());
+}
+
 void Server_session::multiple_rev_enc_comparison(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot)
 {
     assert(a.size() == b.size());
     size_t n = a.size();
     vector<Rev_EncCompare_Owner*> owners(n);
     
+    comparison_prot = resolve_comparison_protocol(comparison_prot, l, n, false);
+    
     for (size_t i = 0; i < n; i++) {
         owners[i] = new Rev_EncCompare_Owner(create_rev_enc_comparator_owner(l, comparison_prot));
         owners[i]->set_input(a[i],b[i]);
     }
     
-    unsigned int thread_per_job = ceilf(((float)server_->threads_per_session())/n);
-    multiple_exec_rev_enc_comparison_owner(socket_, owners, server_->lambda(), true, thread_per_job);
+    multiple_exec_rev_enc_comparison_owner(socket_, owners, server_->lambda(), true, server_->threads_per_session());
     
     
     for (size_t i = 0; i < n; i++) {
@@ -481,13 +693,14 @@ vector<bool> Server_session::multiple_help_rev_enc_comparison(const size_t n, co
 {
     vector<Rev_EncCompare_Helper*> helpers(n);
     
+    comparison_prot = resolve_comparison_protocol(comparison_prot, l, n, true);
+    
     for (size_t i = 0; i < n; i++) {
         helpers[i] = new Rev_EncCompare_Helper(create_rev_enc_comparator_helper(l, comparison_prot));
         
     }
     
-    unsigned int thread_per_job = ceilf(((float)server_->threads_per_session())/n);
-    multiple_exec_rev_enc_comparison_helper(socket_, helpers, true, thread_per_job);
+    multiple_exec_rev_enc_comparison_helper(socket_, helpers, true, server_->threads_per_session());
     
     vector<bool> results(n);
     for (size_t i = 0; i < n; i++) {
@@ -498,34 +711,124 @@ vector<bool> Server_session::multiple_help_rev_enc_comparison(const size_t n, co
     return results;
 }
 
-void Server_session::run_linear_enc_argmax(Linear_EncArgmax_Helper &helper, COMPARISON_PROTOCOL comparison_prot)
+vector<mpz_class> Server_session::multiple_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot)
 {
-    size_t nbits = helper.bit_length();
-    function<Comparison_protocol_B*()> comparator_creator;
+    assert(a.size() == b.size());
+    size_t n = a.size();
+    vector<Rev_EncCompare_Owner*> owners(n);
     
-    if (comparison_prot == LSIC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new LSIC_B(0,nbits,server_->gm()); };
-    }else if (comparison_prot == DGK_PROTOCOL){
-        comparator_creator = [this,nbits](){ return new Compare_B(0,nbits,server_->paillier(),server_->gm()); };
-    }else if (comparison_prot == GC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new GC_Compare_B(0,nbits,server_->gm(), rand_state_); };
+    comparison_prot = resolve_comparison_protocol(comparison_prot, l, n, false);
+    
+    for (size_t i = 0; i < n; i++) {
+        owners[i] = new Rev_EncCompare_Owner(create_rev_enc_comparator_owner(l, comparison_prot));
+        owners[i]->set_input(a[i],b[i]);
     }
+    
+    multiple_exec_rev_enc_comparison_owner(socket_, owners, server_->lambda(), false, server_->threads_per_session());
+    
+    vector<mpz_class> results(n);
+    for (size_t i = 0; i < n; i++) {
+        results[i] = owners[i]->encrypted_output();
+        delete owners[i];
+    }
+    
+    return results;
+}
+
+void Server_session::multiple_help_enc_comparison_enc_result(const size_t n, const size_t &l, COMPARISON_PROTOCOL comparison_prot)
+{
+    vector<Rev_EncCompare_Helper*> helpers(n);
+    
+    comparison_prot = resolve_comparison_protocol(comparison_prot, l, n, true);
+    
+    for (size_t i = 0; i < n; i++) {
+        helpers[i] = new Rev_EncCompare_Helper(create_rev_enc_comparator_helper(l, comparison_prot));
+    }
+    
+    multiple_exec_rev_enc_comparison_helper(socket_, helpers, false, server_->threads_per_session());
+    
+    for (size_t i = 0; i < n; i++) {
+        delete helpers[i];
+    }
+}
+
+void Server_session::run_linear_enc_argmax(Linear_EncArgmax_Helper &helper, COMPARISON_PROTOCOL comparison_prot)
+{
+    size_t nbits = helper.bit_length();
+    comparison_prot = resolve_comparison_protocol(comparison_prot, nbits, helper.elements_number()-1, true);
+    function<Comparison_protocol_B*()> comparator_creator = comparator_creator_B(nbits, comparison_prot);
     exec_linear_enc_argmax(socket_, helper, comparator_creator, server_->threads_per_session());
 }
 
 void Server_session::run_tree_enc_argmax(Tree_EncArgmax_Helper &helper, COMPARISON_PROTOCOL comparison_prot)
 {
     size_t nbits = helper.bit_length();
-    function<Comparison_protocol_B*()> comparator_creator;
+    comparison_prot = resolve_comparison_protocol(comparison_prot, nbits, helper.elements_number()-1, true);
+    function<Comparison_protocol_B*()> comparator_creator = comparator_creator_B(nbits, comparison_prot);
+    exec_tree_enc_argmax(socket_, helper, comparator_creator, server_->threads_per_session());
+}
+
+void Server_session::multiple_run_tree_enc_argmax(vector<Tree_EncArgmax_Helper*> &helpers, COMPARISON_PROTOCOL comparison_prot)
+{
+    if (helpers.empty()) {
+        return;
+    }
     
-    if (comparison_prot == LSIC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new LSIC_B(0,nbits,server_->gm()); };
-    }else if (comparison_prot == DGK_PROTOCOL){
-        comparator_creator = [this,nbits](){ return new Compare_B(0,nbits,server_->paillier(),server_->gm()); };
-    }else if (comparison_prot == GC_PROTOCOL) {
-        comparator_creator = [this,nbits](){ return new GC_Compare_B(0,nbits,server_->gm(), rand_state_); };
+    size_t nbits = helpers[0]->bit_length();
+    // the comparisons of all the argmax are run together
+    comparison_prot = resolve_comparison_protocol(comparison_prot, nbits, helpers.size()*(helpers[0]->elements_number()-1), true);
+    function<Comparison_protocol_B*()> comparator_creator = comparator_creator_B(nbits, comparison_prot);
+    multiple_exec_tree_enc_argmax(socket_, helpers, comparator_creator, server_->threads_per_session());
+}
+
+void Server_session::run_enc_top_k(size_t k, size_t nbits, size_t n_top, COMPARISON_PROTOCOL comparison_prot)
+{
+    Bitonic_EncTopK_Helper helper(nbits,k,n_top,server_->paillier(),server_->paillier_constants());
+    
+    // the widest layer is at most k/2 comparisons
+    comparison_prot = resolve_comparison_protocol(comparison_prot, nbits, k/2, true);
+    function<Comparison_protocol_B*()> comparator_creator = comparator_creator_B(nbits, comparison_prot);
+    exec_bitonic_enc_top_k(socket_, helper, comparator_creator, server_->threads_per_session());
+}
+
+void Server_session::run_tournament_enc_argmax(size_t k, size_t nbits, COMPARISON_PROTOCOL comparison_prot, size_t fan_in)
+{
+    comparison_prot = resolve_comparison_protocol(comparison_prot, nbits, k-1, true);
+    function<Comparison_protocol_B*()> comparator_creator = comparator_creator_B(nbits, comparison_prot);
+    
+    if (fan_in == 0) {
+        // the latency of a batch does not depend on its size, the rest is the cost of the comparisons
+        unsigned int n_threads = server_->threads_per_session();
+        double batch_latency = server_->cost_model().estimate(comparison_prot, nbits, 0, n_threads);
+        double comparison_ms = (server_->cost_model().estimate(comparison_prot, nbits, k, n_threads) - batch_latency)/k;
+        
+        // the randomized values and the refresh add a round trip to every round
+        fan_in = plan_tournament_fan_in(k, batch_latency + server_->cost_model().rtt(), comparison_ms);
     }
-    exec_tree_enc_argmax(socket_, helper, comparator_creator, server_->threads_per_session());
+    sendIntToSocket(socket_, mpz_class((unsigned long)fan_in));
+    
+    Tournament_EncArgmax_Helper helper(nbits, k, fan_in, server_->paillier(), server_->paillier_constants());
+    exec_tournament_enc_argmax(socket_, helper, comparator_creator, server_->threads_per_session());
+}
+
+void Server_session::run_streaming_enc_argmax(size_t nbits, COMPARISON_PROTOCOL comparison_prot, size_t chunk_size)
+{
+    // a round compares the new chunk and the maxima of the last round
+    comparison_prot = resolve_comparison_protocol(comparison_prot, nbits, chunk_size, true);
+    function<Comparison_protocol_B*()> comparator_creator = comparator_creator_B(nbits, comparison_prot);
+    
+    Streaming_EncArgmax_Helper helper(nbits, server_->paillier(), server_->paillier_constants());
+    exec_streaming_enc_argmax(socket_, helper, comparator_creator, server_->threads_per_session());
+}
+
+void Server_session::run_enc_argmax(size_t k, size_t nbits, COMPARISON_PROTOCOL comparison_prot)
+{
+    // all the pairs are compared in one batch
+    comparison_prot = resolve_comparison_protocol(comparison_prot, nbits, k*(k-1)/2, true);
+    function<Comparison_protocol_B*()> comparator_creator = comparator_creator_B(nbits, comparison_prot);
+    
+    EncArgmax_Helper helper(nbits, k, server_->paillier(), comparator_creator);
+    exec_enc_argmax(socket_, helper, server_->threads_per_session());
 }
 
 Ctxt Server_session::change_encryption_scheme(const vector<mpz_class> &c_gm)
@@ -539,7 +842,7 @@ Ctxt Server_session::change_encryption_scheme(const vector<mpz_class> &c_gm)
 void Server_session::run_change_encryption_scheme_slots_helper()
 {
     EncryptedArray ea(server_->fhe_context(), server_->fhe_G());
-    exec_change_encryption_scheme_slots_helper(socket_, server_->gm(), server_->fhe_sk(), ea);
+    exec_change_encryption_scheme_slots_helper(socket_, server_->gm(), server_->fhe_sk(), ea, compression_);
 }
 
 
@@ -553,48 +856,76 @@ void Server_session::help_compute_dot_product(const vector<mpz_class> &y, bool e
     exec_help_compute_dot_product(socket_, y, server_->paillier(), encrypted_input);
 }
 
-EncCompare_Owner Server_session::create_enc_comparator_owner(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
+COMPARISON_PROTOCOL Server_session::resolve_comparison_protocol(COMPARISON_PROTOCOL comparison_prot, size_t bit_size, size_t batch_size, bool server_is_b)
 {
-    Comparison_protocol_B *comparator;
+    if (comparison_prot != ADAPTIVE_PROTOCOL) {
+        return comparison_prot;
+    }
+    
+    // DGK needs the Paillier key of the party running B
+    bool dgk_available = server_is_b ? server_->key_deps_desc().need_server_paillier : (client_paillier_ != NULL);
+    
+    // refresh the model with the RTT measured on the messages of the session so far
+    double rtt = socket_rtt_ms(socket_);
+    if (rtt >= 0) {
+        server_->cost_model().update_rtt(rtt);
+    }
     
+    COMPARISON_PROTOCOL prot = server_->cost_model().best_protocol(bit_size, batch_size, server_->threads_per_session(), dgk_available);
+    
+    // no answer: the choice goes out right before the first message of the protocol
+    sendIntToSocket(socket_, mpz_class((unsigned long)prot));
+    
+    return prot;
+}
+
+function<Comparison_protocol_A*()> Server_session::comparator_creator_A(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
+{
     if (comparison_prot == LSIC_PROTOCOL) {
-        comparator = new LSIC_B(0,bit_size,server_->gm());
+        return [this,bit_size](){ return new LSIC_A(0,bit_size,*client_gm_); };
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_B(0,bit_size,server_->paillier(),server_->gm());
+        return [this,bit_size](){ return new Compare_A(0,bit_size,*client_paillier_,*client_gm_,rand_state_); };
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_B(0,bit_size,server_->gm(), rand_state_);
+        return [this,bit_size](){ return new GC_Compare_A(0,bit_size,*client_gm_, rand_state_); };
     }
-
-    return EncCompare_Owner(0,0,bit_size,*client_paillier_,comparator,rand_state_);
+    throw std::runtime_error("Invalid comparison protocol");
 }
 
-EncCompare_Helper Server_session::create_enc_comparator_helper(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
+function<Comparison_protocol_B*()> Server_session::comparator_creator_B(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
 {
-
-    Comparison_protocol_A *comparator;
-    
     if (comparison_prot == LSIC_PROTOCOL) {
-        comparator = new LSIC_A(0,bit_size,*client_gm_);
+        return [this,bit_size](){ return new LSIC_B(0,bit_size,server_->gm()); };
     }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_A(0,bit_size,*client_paillier_,*client_gm_,rand_state_);
+        return [this,bit_size](){ return new Compare_B(0,bit_size,server_->paillier(),server_->gm()); };
     }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_A(0,bit_size,*client_gm_, rand_state_);
+        return [this,bit_size](){ return new GC_Compare_B(0,bit_size,server_->gm(), rand_state_); };
     }
+    throw std::runtime_error("Invalid comparison protocol");
+}
+
+EncCompare_Owner Server_session::create_enc_comparator_owner(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
+{
+    comparison_prot = resolve_comparison_protocol(comparison_prot, bit_size, 1, true);
+
+    Comparison_protocol_B *comparator = comparator_creator_B(bit_size, comparison_prot)();
+
+    return EncCompare_Owner(0,0,bit_size,*client_paillier_,comparator,rand_state_);
+}
+
+EncCompare_Helper Server_session::create_enc_comparator_helper(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
+{
+    comparison_prot = resolve_comparison_protocol(comparison_prot, bit_size, 1, false);
+
+    Comparison_protocol_A *comparator = comparator_creator_A(bit_size, comparison_prot)();
 
     return EncCompare_Helper(bit_size,server_->paillier(),comparator);
 }
 
 Rev_EncCompare_Owner Server_session::create_rev_enc_comparator_owner(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
 {
-    Comparison_protocol_A *comparator;
-    
-    if (comparison_prot == LSIC_PROTOCOL) {
-        comparator = new LSIC_A(0,bit_size,*client_gm_);
-    }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_A(0,bit_size,*client_paillier_,*client_gm_,rand_state_);
-    }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_A(0,bit_size,*client_gm_, rand_state_);
-    }
+    comparison_prot = resolve_comparison_protocol(comparison_prot, bit_size, 1, false);
+
+    Comparison_protocol_A *comparator = comparator_creator_A(bit_size, comparison_prot)();
     
     return Rev_EncCompare_Owner(0,0,bit_size,*client_paillier_,comparator,rand_state_);
 }
@@ -602,15 +933,9 @@ Rev_EncCompare_Owner Server_session::create_rev_enc_comparator_owner(size_t bit_
 
 Rev_EncCompare_Helper Server_session::create_rev_enc_comparator_helper(size_t bit_size, COMPARISON_PROTOCOL comparison_prot)
 {
-    Comparison_protocol_B *comparator;
-    
-    if (comparison_prot == LSIC_PROTOCOL) {
-        comparator = new LSIC_B(0,bit_size,server_->gm());
-    }else if (comparison_prot == DGK_PROTOCOL){
-        comparator = new Compare_B(0,bit_size,server_->paillier(),server_->gm());
-    }else if (comparison_prot == GC_PROTOCOL) {
-        comparator = new GC_Compare_B(0,bit_size,server_->gm(), rand_state_);
-    }
+    comparison_prot = resolve_comparison_protocol(comparison_prot, bit_size, 1, true);
+
+    Comparison_protocol_B *comparator = comparator_creator_B(bit_size, comparison_prot)();
 
     return Rev_EncCompare_Helper(bit_size,server_->paillier(),comparator);
 }
\ No newline at end of file
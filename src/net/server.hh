@@ -2,16 +2,29 @@
 
 #include <gmpxx.h>
 #include <vector>
+#include <atomic>
 #include <boost/asio.hpp>
 
+#include <mpc/lsic.hh>
+#include <mpc/private_comparison.hh>
 #include <mpc/garbled_comparison.hh>
+#include <mpc/enc_comparison.hh>
+#include <mpc/rev_enc_comparison.hh>
+#include <mpc/linear_enc_argmax.hh>
+#include <mpc/tree_enc_argmax.hh>
 
 #include <FHE.h>
 
 #include <crypto/paillier.hh>
+#include <crypto/paillier_pool.hh>
 #include <crypto/gm.hh>
 
 #include <net/key_deps_descriptor.hh>
+#include <net/comparison_cost_model.hh>
+#include <net/session_scheduler.hh>
+#include <net/session_tickets.hh>
+
+#include <protobuf/protobuf_conversion.hh>
 
 using boost::asio::ip::tcp;
 
@@ -39,6 +52,8 @@ public:
     Paillier_priv_fast& paillier() { assert(paillier_!=NULL); return *paillier_; };
     vector<mpz_class> paillier_pk() const { assert(paillier_!=NULL); return paillier_->pubkey(); }
     vector<mpz_class> paillier_sk() const { assert(paillier_!=NULL); return paillier_->privkey(); }
+    // encryptions of 0 and 1 under the server's Paillier key, shared by the sessions
+    Paillier_constants_pool* paillier_constants() { assert(paillier_constants_!=NULL); return paillier_constants_; }
     GM_priv& gm() { assert(gm_!=NULL); return *gm_; };
     vector<mpz_class> gm_pk() const { assert(gm_!=NULL); return gm_->pubkey(); }
     vector<mpz_class> gm_sk() const { assert(gm_!=NULL); return {gm_->pubkey()[0],gm_->pubkey()[1],gm_->privkey()[0],gm_->privkey()[1]}; }
@@ -51,21 +66,67 @@ public:
     
     unsigned int lambda() const { return lambda_; }
     
-    unsigned int threads_per_session() const { return threads_per_session_; }
-    void set_threads_per_session(unsigned int n) { assert(n > 0); threads_per_session_ = n; }
+    /* Sessions scheduling: to be set before run() */
+
+    // number of crypto threads of a session: its share of the budget among the running sessions
+    unsigned int threads_per_session() const;
+    unsigned int crypto_thread_budget() const { return crypto_thread_budget_; }
+    void set_crypto_thread_budget(unsigned int n);
+    void set_max_sessions(unsigned int n) { assert(n > 0); max_sessions_ = n; }
+    // 0 for no limit
+    void set_session_queue_length(size_t n) { session_queue_length_ = n; }
+
+    // NULL until run() is called
+    const Session_scheduler* scheduler() const { return scheduler_; }
+
+    /* Network: to be set before run() */
+
+    // empty for all the interfaces, in IPv6 and IPv4 when the host supports it
+    void set_listen_address(const string &address) { listen_address_ = address; }
+    // 0 to let the system choose
+    void set_port(unsigned short port) { port_ = port; }
+    // each acceptor thread has its own socket bound with SO_REUSEPORT
+    void set_acceptor_threads(unsigned int n) { assert(n > 0); n_acceptors_ = n; }
+    // let other processes listen on the same port (SO_REUSEPORT)
+    void set_reuse_port(bool reuse) { reuse_port_ = reuse; }
+
+    Comparison_cost_model& cost_model() { return cost_model_; }
+    void calibrate_cost_model();
+
+    // keys of the clients that can resume their session
+    Session_ticket_cache& session_tickets() { return session_tickets_; }
 
 protected:
+    tcp::acceptor* open_acceptor(boost::asio::io_service &io_service, tcp::endpoint &endpoint, bool reuse_port);
+    void accept_loop(tcp::acceptor &acceptor);
+
     const Key_dependencies_descriptor key_deps_desc_;
 
     Paillier_priv_fast *paillier_;
+    Paillier_constants_pool *paillier_constants_;
     GM_priv *gm_;
     FHEcontext *fhe_context_;
     FHESecKey *fhe_sk_;
     ZZX fhe_G_;
 
     gmp_randstate_t rand_state_;
-    unsigned int n_clients_;
-    unsigned int threads_per_session_;
+    // incremented by the acceptor threads
+    std::atomic<unsigned int> n_clients_;
+    unsigned int crypto_thread_budget_;
+    unsigned int max_sessions_;
+    size_t session_queue_length_;
+    Session_scheduler *scheduler_;
+    unsigned int keysize_;
+
+    string listen_address_;
+    unsigned short port_;
+    unsigned int n_acceptors_;
+    bool reuse_port_;
+
+    Comparison_cost_model cost_model_;
+
+    boost::asio::io_service io_service_;
+    Session_ticket_cache session_tickets_;
     
     /* statistical security */
     unsigned int lambda_;
@@ -87,7 +148,10 @@ public:
     void get_client_pk_gm();
     void get_client_pk_paillier();
     void get_client_pk_fhe();
+    void negotiate_compression();
     void exchange_keys();
+    // returns true if the client resumed a previous session: its keys are known
+    bool resume_session();
 
     mpz_class run_comparison_protocol_A(Comparison_protocol_A *comparator);
     mpz_class run_lsic_A(LSIC_A *lsic);
@@ -111,9 +175,15 @@ public:
     vector<bool> multiple_enc_comparison(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot);
     void multiple_help_enc_comparison(const size_t n, const size_t &l, COMPARISON_PROTOCOL comparison_prot);
 
+    // help the client to compare a value to m thresholds
+    void help_threshold_enc_comparison(const size_t m, const size_t &l, COMPARISON_PROTOCOL comparison_prot);
+    
     void multiple_rev_enc_comparison(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot);
     vector<bool> multiple_help_rev_enc_comparison(const size_t n, const size_t &l, COMPARISON_PROTOCOL comparison_prot);
 
+    vector<mpz_class> multiple_enc_comparison_enc_result(const vector<mpz_class> &a, const vector<mpz_class> &b, size_t l, COMPARISON_PROTOCOL comparison_prot);
+    void multiple_help_enc_comparison_enc_result(const size_t n, const size_t &l, COMPARISON_PROTOCOL comparison_prot);
+
     mpz_class enc_comparison_enc_result(const mpz_class &a, const mpz_class &b, size_t l, COMPARISON_PROTOCOL comparison_prot);
     void help_enc_comparison_enc_result(const size_t &l, COMPARISON_PROTOCOL comparison_prot);
     
@@ -139,8 +209,26 @@ public:
 
     void run_linear_enc_argmax(Linear_EncArgmax_Helper &helper, COMPARISON_PROTOCOL comparison_prot);
     void run_tree_enc_argmax(Tree_EncArgmax_Helper &helper, COMPARISON_PROTOCOL comparison_prot);
+    void multiple_run_tree_enc_argmax(vector<Tree_EncArgmax_Helper*> &helpers, COMPARISON_PROTOCOL comparison_prot);
+    // top n_top of k values of nbits bits, with a bitonic network
+    void run_enc_top_k(size_t k, size_t nbits, size_t n_top, COMPARISON_PROTOCOL comparison_prot);
+    // tournament argmax of k values of nbits bits
+    // the fan-in is planned with the cost model if fan_in is 0, and sent to the client
+    void run_tournament_enc_argmax(size_t k, size_t nbits, COMPARISON_PROTOCOL comparison_prot, size_t fan_in = 0);
+    // argmax of values of nbits bits streamed by the client
+    // chunk_size is the expected number of candidates per chunk, to choose the comparison protocol
+    void run_streaming_enc_argmax(size_t nbits, COMPARISON_PROTOCOL comparison_prot, size_t chunk_size);
+    // constant round argmax of k values of nbits bits
+    void run_enc_argmax(size_t k, size_t nbits, COMPARISON_PROTOCOL comparison_prot);
     
     /* to build comparators */
+    
+    // choose the protocol for batch_size comparisons of bit_size bits when comparison_prot is ADAPTIVE_PROTOCOL and tell the client (without waiting for an answer)
+    // server_is_b is true iff the server runs party B (the key owner) of the comparison protocol
+    COMPARISON_PROTOCOL resolve_comparison_protocol(COMPARISON_PROTOCOL comparison_prot, size_t bit_size, size_t batch_size, bool server_is_b);
+    // comparators of bit_size bits for a resolved protocol: party A uses the client's keys, party B the server's
+    function<Comparison_protocol_A*()> comparator_creator_A(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
+    function<Comparison_protocol_B*()> comparator_creator_B(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
     EncCompare_Owner create_enc_comparator_owner(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
     EncCompare_Helper create_enc_comparator_helper(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
     Rev_EncCompare_Owner create_rev_enc_comparator_owner(size_t bit_size, COMPARISON_PROTOCOL comparison_prot);
@@ -149,6 +237,8 @@ public:
 protected:
     Server *server_;
     tcp::socket socket_;
+    WIRE_COMPRESSION compression_;
+    string ticket_;
     boost::asio::streambuf input_buf_;
 
     GM *client_gm_;
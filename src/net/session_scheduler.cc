@@ -0,0 +1,146 @@
+#include <net/session_scheduler.hh>
+#include <net/server.hh>
+
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+using namespace std;
+
+static double elapsed_ms(chrono::steady_clock::time_point begin, chrono::steady_clock::time_point end)
+{
+    return chrono::duration<double, milli>(end - begin).count();
+}
+
+Session_scheduler::Session_scheduler(unsigned int max_sessions, size_t max_queue_length, unsigned int thread_budget)
+: max_queue_length_(max_queue_length), thread_budget_(max(thread_budget, 1U)), active_(0), done_(false),
+  admitted_(0), refused_(0), started_(0), completed_(0),
+  total_wait_ms_(0), max_wait_ms_(0), total_service_ms_(0), max_service_ms_(0)
+{
+    if (max_sessions == 0) {
+        max_sessions = 1;
+    }
+
+    for (unsigned int i = 0; i < max_sessions; i++) {
+        workers_.push_back(thread(&Session_scheduler::worker_loop, this));
+    }
+}
+
+Session_scheduler::~Session_scheduler()
+{
+    {
+        lock_guard<mutex> lock(mtx_);
+        done_ = true;
+    }
+    cv_.notify_all();
+
+    for (size_t i = 0; i < workers_.size(); i++) {
+        workers_[i].join();
+    }
+
+    // closes the sockets of the sessions that never started
+    for (size_t i = 0; i < queue_.size(); i++) {
+        delete queue_[i].session;
+    }
+}
+
+bool Session_scheduler::submit(Server_session *session)
+{
+    {
+        lock_guard<mutex> lock(mtx_);
+        if (done_ || (max_queue_length_ > 0 && queue_.size() >= max_queue_length_)) {
+            refused_++;
+            return false;
+        }
+
+        Queued_session q = {session, Clock::now()};
+        queue_.push_back(q);
+        admitted_++;
+    }
+    cv_.notify_one();
+    return true;
+}
+
+size_t Session_scheduler::queue_length() const
+{
+    lock_guard<mutex> lock(mtx_);
+    return queue_.size();
+}
+
+void Session_scheduler::set_thread_budget(unsigned int n)
+{
+    assert(n > 0);
+    thread_budget_ = n;
+}
+
+unsigned int Session_scheduler::threads_per_session() const
+{
+    unsigned int active = max(active_.load(), 1U);
+    return max(thread_budget_.load()/active, 1U);
+}
+
+Session_scheduler_stats Session_scheduler::stats() const
+{
+    lock_guard<mutex> lock(mtx_);
+
+    Session_scheduler_stats s;
+    s.admitted = admitted_;
+    s.refused = refused_;
+    s.completed = completed_;
+    s.mean_queue_wait_ms = (started_ > 0) ? total_wait_ms_/started_ : 0;
+    s.max_queue_wait_ms = max_wait_ms_;
+    s.mean_service_ms = (completed_ > 0) ? total_service_ms_/completed_ : 0;
+    s.max_service_ms = max_service_ms_;
+    return s;
+}
+
+void Session_scheduler::worker_loop()
+{
+    for (;;) {
+        Queued_session q;
+        Clock::time_point start;
+        {
+            unique_lock<mutex> lock(mtx_);
+            cv_.wait(lock, [this](){ return done_ || !queue_.empty(); });
+            if (done_) {
+                return;
+            }
+
+            q = queue_.front();
+            queue_.pop_front();
+
+            start = Clock::now();
+            double wait = elapsed_ms(q.enqueued, start);
+            started_++;
+            total_wait_ms_ += wait;
+            max_wait_ms_ = max(max_wait_ms_, wait);
+
+            active_++;
+        }
+
+        unsigned int id = q.session->id();
+        cout << "Start new connexion: " << id << endl;
+
+        // deleted (and its socket closed) when it is over, even if it throws
+        unique_ptr<Server_session> session(q.session);
+        try {
+            session->run_session();
+        } catch (std::exception& e) {
+            cerr << id << ": " << e.what() << endl;
+        }
+        session.reset();
+
+        {
+            lock_guard<mutex> lock(mtx_);
+            active_--;
+
+            double service = elapsed_ms(start, Clock::now());
+            completed_++;
+            total_service_ms_ += service;
+            max_service_ms_ = max(max_service_ms_, service);
+
+            cout << id << ": waited " << elapsed_ms(q.enqueued, start) << " ms, served in " << service << " ms, " << queue_.size() << " sessions waiting" << endl;
+        }
+    }
+}
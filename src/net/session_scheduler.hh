@@ -0,0 +1,78 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+class Server_session;
+
+struct Session_scheduler_stats {
+    size_t admitted;
+    size_t refused;
+    size_t completed;
+
+    // time spent in the queue and running, in ms, over the started (resp. completed) sessions
+    double mean_queue_wait_ms;
+    double max_queue_wait_ms;
+    double mean_service_ms;
+    double max_service_ms;
+};
+
+// Runs the sessions of a server on at most max_sessions threads.
+// The other sessions wait in a FIFO queue of at most max_queue_length sessions
+// (0 for no limit) and the ones that do not fit are refused.
+// The crypto threads budget is shared by the running sessions: each of them
+// gets budget/active threads, which is recomputed when a session starts or ends.
+class Session_scheduler {
+public:
+    Session_scheduler(unsigned int max_sessions, size_t max_queue_length, unsigned int thread_budget);
+    // waits for the running sessions, the queued ones are dropped
+    ~Session_scheduler();
+
+    Session_scheduler(const Session_scheduler&) = delete;
+    Session_scheduler &operator=(const Session_scheduler &) = delete;
+
+    // queue the session, it will be run and then deleted by the scheduler (run_session must not delete it)
+    // returns false if the queue is full: the session is left to the caller
+    bool submit(Server_session *session);
+
+    unsigned int max_sessions() const { return workers_.size(); }
+    size_t max_queue_length() const { return max_queue_length_; }
+    size_t queue_length() const;
+    unsigned int active_sessions() const { return active_; }
+
+    unsigned int thread_budget() const { return thread_budget_; }
+    void set_thread_budget(unsigned int n);
+    unsigned int threads_per_session() const;
+
+    Session_scheduler_stats stats() const;
+
+protected:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Queued_session {
+        Server_session *session;
+        Clock::time_point enqueued;
+    };
+
+    void worker_loop();
+
+    std::vector<std::thread> workers_;
+    const size_t max_queue_length_;
+    std::atomic<unsigned int> thread_budget_;
+    std::atomic<unsigned int> active_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Queued_session> queue_;
+    bool done_;
+
+    /* metrics, protected by mtx_ */
+    size_t admitted_, refused_, started_, completed_;
+    double total_wait_ms_, max_wait_ms_;
+    double total_service_ms_, max_service_ms_;
+};
@@ -0,0 +1,55 @@
+#include <net/session_tickets.hh>
+#include <net/defs.hh>
+
+#include <stdexcept>
+#include <openssl/rand.h>
+
+using namespace std;
+
+Session_ticket_cache::Session_ticket_cache(size_t capacity)
+: capacity_(capacity)
+{
+}
+
+string Session_ticket_cache::new_ticket()
+{
+    // the ticket designates the keys of a client: it must not be guessable
+    unsigned char buf[SESSION_TICKET_BYTES];
+    if (RAND_bytes(buf, SESSION_TICKET_BYTES) != 1) {
+        throw runtime_error("Could not generate a session ticket");
+    }
+    return string((char *)buf, SESSION_TICKET_BYTES);
+}
+
+bool Session_ticket_cache::lookup(const string &ticket, Client_keys &keys) const
+{
+    lock_guard<mutex> lock(mtx_);
+
+    map<string, Client_keys>::const_iterator it = keys_.find(ticket);
+    if (it == keys_.end()) {
+        return false;
+    }
+    keys = it->second;
+    return true;
+}
+
+void Session_ticket_cache::store(const string &ticket, const Client_keys &keys)
+{
+    lock_guard<mutex> lock(mtx_);
+
+    if (keys_.count(ticket) == 0) {
+        order_.push_back(ticket);
+    }
+    keys_[ticket] = keys;
+
+    while (keys_.size() > capacity_) {
+        keys_.erase(order_.front());
+        order_.pop_front();
+    }
+}
+
+size_t Session_ticket_cache::size() const
+{
+    lock_guard<mutex> lock(mtx_);
+    return keys_.size();
+}
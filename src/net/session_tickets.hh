@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <deque>
+#include <mutex>
+
+#include <proto_src/keys.pb.h>
+#include <proto_src/fhe.pb.h>
+
+// public keys sent by a client during the key exchange
+struct Client_keys {
+    Client_keys() : has_gm(false), has_paillier(false), has_fhe(false) {}
+
+    bool has_gm, has_paillier, has_fhe;
+    Protobuf::GM_PK gm_pk;
+    Protobuf::Paillier_PK paillier_pk;
+    Protobuf::FHE_PK fhe_pk;
+};
+
+// Keys of the clients, indexed by the tickets given to them.
+// The tickets live as long as the server keys: a restarted server does not
+// know the old tickets and the clients go through a full key exchange.
+// When full, the oldest ticket is dropped.
+class Session_ticket_cache {
+public:
+    explicit Session_ticket_cache(size_t capacity);
+
+    // a new random ticket id
+    static std::string new_ticket();
+
+    bool lookup(const std::string &ticket, Client_keys &keys) const;
+    void store(const std::string &ticket, const Client_keys &keys);
+
+    size_t size() const;
+
+protected:
+    const size_t capacity_;
+
+    mutable std::mutex mtx_;
+    std::map<std::string, Client_keys> keys_;
+    std::deque<std::string> order_;
+};
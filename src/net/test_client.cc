@@ -11,7 +11,7 @@
 
 #include <util/util.hh>
 
-static void test_basic_client(const string &hostname)
+static void test_basic_client(const string &hostname, const string &session_file)
 {
     try
     {
@@ -22,11 +22,12 @@ static void test_basic_client(const string &hostname)
         gmp_randinit_default(randstate);
         gmp_randseed_ui(randstate,time(NULL));
         
-        Tester_Client client(io_service, randstate,1024,100);
+        Tester_Client client(io_service, randstate,1024,100,session_file);
         
         client.connect(io_service, hostname);
         
         client.exchange_keys();
+        cout << (client.resumed_session() ? "Resumed session" : "New session") << endl;
 //        client.get_server_pk_fhe();
         
         // server has b = 20
@@ -66,14 +67,15 @@ static void test_basic_client(const string &hostname)
 
 int main(int argc, char* argv[])
 {
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
     {
-        std::cerr << "Usage: client <host>" << std::endl;
+        std::cerr << "Usage: client <host> [session file]" << std::endl;
         return 1;
     }
     string hostname(argv[1]);
+    string session_file = (argc == 3) ? argv[2] : "";
 
-    test_basic_client(hostname);
+    test_basic_client(hostname, session_file);
     
     return 0;
 }
\ No newline at end of file
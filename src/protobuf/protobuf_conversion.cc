@@ -1,6 +1,10 @@
 #include <gmpxx.h>
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <zlib.h>
 
 #include <protobuf/protobuf_conversion.hh>
 
@@ -22,14 +26,24 @@ mpz_class convert_from_message(const Protobuf::BigInt &m)
     return v;
 }
 
+// number of bytes written by mpz_export
+static size_t export_size(const mpz_class &v)
+{
+    if (v == 0) {
+        return 0;
+    }
+    return (mpz_sizeinbase(v.get_mpz_t(),2) + 7)/8;
+}
+
 Protobuf::BigInt convert_to_message(const mpz_class &v)
 {
     Protobuf::BigInt m;
-    void *data;
     size_t data_count;
     
-    data = mpz_export(NULL,&data_count,1,sizeof(char),1,0,v.get_mpz_t());
-    m.set_data(data,data_count);
+    // export directly in the message
+    std::string *data = m.mutable_data();
+    data->resize(export_size(v));
+    mpz_export(&(*data)[0],&data_count,1,sizeof(char),1,0,v.get_mpz_t());
     
     return m;
 }
@@ -37,6 +51,23 @@ Protobuf::BigInt convert_to_message(const mpz_class &v)
 
 std::vector<mpz_class> convert_from_message(const Protobuf::BigIntArray &m)
 {
+    if (m.has_packed_data()) {
+        // count and width come from the peer: check them before allocating
+        uint64_t n = m.count();
+        uint64_t width = m.width();
+        const std::string &data = m.packed_data();
+        if (n > BIGINT_ARRAY_MAX_COUNT || (width == 0 && n != 0)
+            || (n != 0 && width > data.size()/n) || data.size() != n*width) {
+            throw std::runtime_error("Invalid packed big integer array");
+        }
+        
+        std::vector<mpz_class> v(n);
+        for (size_t i = 0; i < n; i++) {
+            mpz_import(v[i].get_mpz_t(),width,1,sizeof(char),1,0,data.data() + i*width);
+        }
+        return v;
+    }
+    
     size_t n = m.values_size();
     std::vector<mpz_class> v(n);
     
@@ -47,7 +78,40 @@ std::vector<mpz_class> convert_from_message(const Protobuf::BigIntArray &m)
     return v;
 }
 
+// approximate overhead of an element of the repeated encoding: tags and lengths of the BigInt and of its data
+#define UNPACKED_ELEMENT_OVERHEAD 4
+
 Protobuf::BigIntArray convert_to_message(const std::vector<mpz_class> &v)
+{
+    // a 0 takes one byte in its slot: a non empty array never has a zero width
+    size_t width = v.empty() ? 0 : 1, unpacked_size = 0;
+    for (size_t i = 0; i < v.size(); i++) {
+        size_t s = export_size(v[i]);
+        width = std::max(width, s);
+        unpacked_size += s + UNPACKED_ELEMENT_OVERHEAD;
+    }
+    
+    // values of very different sizes are better sent one by one
+    if (v.size()*width > unpacked_size) {
+        return convert_to_unpacked_message(v);
+    }
+    
+    Protobuf::BigIntArray m;
+    m.set_count(v.size());
+    m.set_width(width);
+    
+    // the values are exported right-aligned in their slot, the leading bytes stay 0
+    std::string *data = m.mutable_packed_data();
+    data->assign(v.size()*width, 0);
+    for (size_t i = 0; i < v.size(); i++) {
+        size_t data_count;
+        mpz_export(&(*data)[i*width + width - export_size(v[i])],&data_count,1,sizeof(char),1,0,v[i].get_mpz_t());
+    }
+    
+    return m;
+}
+
+Protobuf::BigIntArray convert_to_unpacked_message(const std::vector<mpz_class> &v)
 {
     Protobuf::BigIntArray m;
     
@@ -145,6 +209,52 @@ Protobuf::LSIC_B_Message convert_to_message(const LSIC_Packet_B &p)
     return m;
 }
 
+std::vector<LSIC_Packet_A> convert_from_message(const Protobuf::LSIC_A_Batch_Message &m)
+{
+    size_t n = m.packets_size();
+    std::vector<LSIC_Packet_A> p(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        p[i] = convert_from_message(m.packets(i));
+    }
+    
+    return p;
+}
+
+std::vector<LSIC_Packet_B> convert_from_message(const Protobuf::LSIC_B_Batch_Message &m)
+{
+    size_t n = m.packets_size();
+    std::vector<LSIC_Packet_B> p(n);
+    
+    for (size_t i = 0; i < n; i++) {
+        p[i] = convert_from_message(m.packets(i));
+    }
+    
+    return p;
+}
+
+Protobuf::LSIC_A_Batch_Message convert_to_message(const std::vector<LSIC_Packet_A> &p)
+{
+    Protobuf::LSIC_A_Batch_Message m;
+    
+    for (size_t i = 0; i < p.size(); i++) {
+        *(m.add_packets()) = convert_to_message(p[i]);
+    }
+    
+    return m;
+}
+
+Protobuf::LSIC_B_Batch_Message convert_to_message(const std::vector<LSIC_Packet_B> &p)
+{
+    Protobuf::LSIC_B_Batch_Message m;
+    
+    for (size_t i = 0; i < p.size(); i++) {
+        *(m.add_packets()) = convert_to_message(p[i]);
+    }
+    
+    return m;
+}
+
 mpz_class convert_from_message(const Protobuf::Enc_Compare_Setup_Message &m)
 {
     return convert_from_message(m.c_z());
@@ -165,6 +275,20 @@ Protobuf::Enc_Compare_Setup_Message convert_to_message(const mpz_class &c_z, siz
     return m;
 }
 
+std::vector<mpz_class> convert_from_message(const Protobuf::Enc_Compare_Batch_Setup_Message &m)
+{
+    return convert_from_message(m.c_z());
+}
+
+Protobuf::Enc_Compare_Batch_Setup_Message convert_to_message(const std::vector<mpz_class> &c_z, size_t bit_length)
+{
+    Protobuf::Enc_Compare_Batch_Setup_Message m;
+    *(m.mutable_c_z()) = convert_to_message(c_z);
+    m.set_bit_length(bit_length);
+    
+    return m;
+}
+
 
 GM* create_from_pk_message(const Protobuf::GM_PK &m_pk, gmp_randstate_t state)
 {
@@ -205,24 +329,71 @@ Protobuf::Paillier_PK get_pk_message(const Paillier *paillier)
     return pk_message;
 }
 
+/* the three FHE messages have the same content fields */
+
+template <class M>
+static void set_fhe_content(M &m, const std::string &content, WIRE_COMPRESSION compression)
+{
+    if (compression == ZLIB_COMPRESSION) {
+        uLongf compressed_size = compressBound(content.size());
+        std::string *compressed = m.mutable_compressed_content();
+        compressed->resize(compressed_size);
+        
+        // the text is very redundant: the fastest level already gets most of the gain
+        if (compress2((Bytef *)&(*compressed)[0], &compressed_size, (const Bytef *)content.data(), content.size(), Z_BEST_SPEED) == Z_OK) {
+            compressed->resize(compressed_size);
+            m.set_content_size(content.size());
+            return;
+        }
+        m.clear_compressed_content();
+    }
+    m.set_content(content);
+}
+
+// deflate cannot do better than ~1032:1
+#define ZLIB_MAX_RATIO 1032
+
+template <class M>
+static std::string get_fhe_content(const M &m)
+{
+    if (!m.has_compressed_content()) {
+        return m.content();
+    }
+    
+    // content_size comes from the peer: check it before allocating
+    const std::string &compressed = m.compressed_content();
+    if (m.content_size() > FHE_MAX_CONTENT_SIZE || m.content_size() > ZLIB_MAX_RATIO*(uint64_t)compressed.size()) {
+        throw std::runtime_error("Invalid compressed FHE message size");
+    }
+    
+    std::string content(m.content_size(), 0);
+    uLongf content_size = content.size();
+    
+    if (uncompress((Bytef *)&content[0], &content_size, (const Bytef *)compressed.data(), compressed.size()) != Z_OK
+        || content_size != content.size()) {
+        throw std::runtime_error("Invalid compressed FHE message");
+    }
+    return content;
+}
+
 FHEPubKey* create_from_pk_message(const Protobuf::FHE_PK &m_pk, const FHEcontext &fhe_context)
 {
     FHEPubKey *fhe_pk = new FHEPubKey(fhe_context);
     
-    std::istringstream stream(m_pk.content());
+    std::istringstream stream(get_fhe_content(m_pk));
     stream >> (*fhe_pk);
     
     return fhe_pk;
 }
 
-Protobuf::FHE_PK get_pk_message(const FHEPubKey& pubKey)
+Protobuf::FHE_PK get_pk_message(const FHEPubKey& pubKey, WIRE_COMPRESSION compression)
 {
     Protobuf::FHE_PK pk_message;
 
     std::ostringstream stream;
     stream << pubKey;
     
-    pk_message.set_content(stream.str().c_str());
+    set_fhe_content(pk_message, stream.str(), compression);
     
     return pk_message;
 }
@@ -232,25 +403,25 @@ Ctxt convert_from_message(const Protobuf::FHE_Ctxt &m, const FHEPubKey &pubkey)
 {
     Ctxt c(pubkey);
     
-    std::istringstream stream(m.content());
+    std::istringstream stream(get_fhe_content(m));
     stream >> c;
     
     return c;
 }
 
-Protobuf::FHE_Ctxt convert_to_message(const Ctxt &c)
+Protobuf::FHE_Ctxt convert_to_message(const Ctxt &c, WIRE_COMPRESSION compression)
 {
     Protobuf::FHE_Ctxt m;
     std::ostringstream stream;
     stream << c;
-    m.set_content(stream.str().c_str());
+    set_fhe_content(m, stream.str(), compression);
     
     return m;
 }
 
 FHEcontext* create_from_message(const Protobuf::FHE_Context &message)
 {
-    std::istringstream stream(message.content());
+    std::istringstream stream(get_fhe_content(message));
     
     unsigned long m, p, r;
     vector<long> gens, ords;
@@ -263,14 +434,14 @@ FHEcontext* create_from_message(const Protobuf::FHE_Context &message)
     return context;
 }
 
-Protobuf::FHE_Context convert_to_message(const FHEcontext &c)
+Protobuf::FHE_Context convert_to_message(const FHEcontext &c, WIRE_COMPRESSION compression)
 {
     Protobuf::FHE_Context m;
     std::ostringstream stream;
     writeContextBase(stream, c);
     stream << c;
     
-    m.set_content(stream.str().c_str());
+    set_fhe_content(m, stream.str(), compression);
     
     return m;
 }
@@ -16,7 +16,13 @@ mpz_class convert_from_message(const Protobuf::BigInt &m);
 Protobuf::BigInt convert_to_message(const mpz_class &v);
 
 std::vector<mpz_class> convert_from_message(const Protobuf::BigIntArray &m);
+// uses the packed encoding when it is smaller
 Protobuf::BigIntArray convert_to_message(const std::vector<mpz_class> &v);
+// one BigInt per value
+Protobuf::BigIntArray convert_to_unpacked_message(const std::vector<mpz_class> &v);
+
+// largest packed array accepted from the peer
+#define BIGINT_ARRAY_MAX_COUNT (1UL << 28)
 
 std::vector< std::vector <mpz_class> > convert_from_message(const Protobuf::BigIntMatrix &m);
 Protobuf::BigIntMatrix convert_to_message(const std::vector< std::vector <mpz_class> > &v);
@@ -30,11 +36,19 @@ LSIC_Packet_B convert_from_message(const Protobuf::LSIC_B_Message &m);
 Protobuf::LSIC_A_Message convert_to_message(const LSIC_Packet_A &p);
 Protobuf::LSIC_B_Message convert_to_message(const LSIC_Packet_B &p);
 
+std::vector<LSIC_Packet_A> convert_from_message(const Protobuf::LSIC_A_Batch_Message &m);
+std::vector<LSIC_Packet_B> convert_from_message(const Protobuf::LSIC_B_Batch_Message &m);
+Protobuf::LSIC_A_Batch_Message convert_to_message(const std::vector<LSIC_Packet_A> &p);
+Protobuf::LSIC_B_Batch_Message convert_to_message(const std::vector<LSIC_Packet_B> &p);
+
 /* Setup messages for comparison over encrypted data */
 mpz_class convert_from_message(const Protobuf::Enc_Compare_Setup_Message &m);
 Protobuf::Enc_Compare_Setup_Message convert_to_message_partial(const mpz_class &c_z);
 Protobuf::Enc_Compare_Setup_Message convert_to_message(const mpz_class &c_z, size_t bit_length);
 
+std::vector<mpz_class> convert_from_message(const Protobuf::Enc_Compare_Batch_Setup_Message &m);
+Protobuf::Enc_Compare_Batch_Setup_Message convert_to_message(const std::vector<mpz_class> &c_z, size_t bit_length);
+
 /* GM and Paillier key exchanges */
 
 GM* create_from_pk_message(const Protobuf::GM_PK &m_pk, gmp_randstate_t state);
@@ -45,14 +59,24 @@ Protobuf::Paillier_PK get_pk_message(const Paillier *paillier);
 
 /* FHE context, key and cyphertext */
 
+// compression of the FHE material, agreed on at key exchange
+// the values are ordered: both ends use the smallest of what they support
+typedef enum {
+    NO_COMPRESSION = 0,
+    ZLIB_COMPRESSION = 1
+} WIRE_COMPRESSION;
+
+// largest decompressed FHE object accepted from the peer
+#define FHE_MAX_CONTENT_SIZE (1UL << 30)
+
 FHEPubKey* create_from_pk_message(const Protobuf::FHE_PK &m_pk, const FHEcontext &fhe_context);
-Protobuf::FHE_PK get_pk_message(const FHEPubKey& pubKey);
+Protobuf::FHE_PK get_pk_message(const FHEPubKey& pubKey, WIRE_COMPRESSION compression = NO_COMPRESSION);
 
 Ctxt convert_from_message(const Protobuf::FHE_Ctxt &m, const FHEPubKey &pubkey);
-Protobuf::FHE_Ctxt convert_to_message(const Ctxt &c);
+Protobuf::FHE_Ctxt convert_to_message(const Ctxt &c, WIRE_COMPRESSION compression = NO_COMPRESSION);
 
 FHEcontext* create_from_message(const Protobuf::FHE_Context &m);
-Protobuf::FHE_Context convert_to_message(const FHEcontext &c);
+Protobuf::FHE_Context convert_to_message(const FHEcontext &c, WIRE_COMPRESSION compression = NO_COMPRESSION);
 
 /* Import and export garbled tables */
 
@@ -1,22 +1,121 @@
 #include <protobuf/protobuf_conversion.hh>
 #include <gmpxx.h>
 
+#include <util/util.hh>
+
+#include <EncryptedArray.h>
+
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+// compare the size and the (de)serialization time of the packed and repeated encodings of an array
+static void bench_int_array(const string &name, const vector<mpz_class> &v, unsigned int iterations = 20)
+{
+    Protobuf::BigIntArray packed = convert_to_message(v);
+    Protobuf::BigIntArray unpacked = convert_to_unpacked_message(v);
+
+    assert(convert_from_message(packed) == v);
+    assert(convert_from_message(unpacked) == v);
+
+    string packed_str, unpacked_str;
+
+    Timer t;
+    for (unsigned int i = 0; i < iterations; i++) {
+        convert_to_message(v).SerializeToString(&packed_str);
+        Protobuf::BigIntArray m;
+        m.ParseFromString(packed_str);
+        convert_from_message(m);
+    }
+    double packed_time = t.lap_ms()/iterations;
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        convert_to_unpacked_message(v).SerializeToString(&unpacked_str);
+        Protobuf::BigIntArray m;
+        m.ParseFromString(unpacked_str);
+        convert_from_message(m);
+    }
+    double unpacked_time = t.lap_ms()/iterations;
+
+    cout << name << ": " << v.size() << " values" << endl;
+    cout << "\tpacked:   " << packed_str.size() << " bytes, " << packed_time << " ms" << endl;
+    cout << "\trepeated: " << unpacked_str.size() << " bytes, " << unpacked_time << " ms" << endl;
+}
+
+// the compressed FHE messages must decode to the same objects as the plain ones
+static void test_fhe_compression(gmp_randstate_t randstate)
+{
+    long p = 2, r = 1, d = 1, c = 2, L = 2, w = 64, s = 1, k = 80;
+    long m = FindM(k, L, c, p, d, s, 0, true);
+    
+    FHEcontext context(m, p, r);
+    buildModChain(context, L, c);
+    FHESecKey secretKey(context);
+    const FHEPubKey& publicKey = secretKey;
+    secretKey.GenSecKey(w);
+    
+    EncryptedArray ea(context, makeIrredPoly(p, d));
+    
+    vector<long> bits(ea.size());
+    for (size_t i = 0; i < bits.size(); i++) {
+        bits[i] = gmp_urandomb_ui(randstate,1);
+    }
+    Ctxt ctxt(publicKey);
+    ea.encrypt(ctxt, publicKey, bits);
+    
+    Protobuf::FHE_Ctxt plain_msg = convert_to_message(ctxt, NO_COMPRESSION);
+    Protobuf::FHE_Ctxt compressed_msg = convert_to_message(ctxt, ZLIB_COMPRESSION);
+    assert(compressed_msg.has_compressed_content() && !compressed_msg.has_content());
+    assert(compressed_msg.compressed_content().size() < plain_msg.content().size());
+    
+    // through the wire format
+    string buffer;
+    compressed_msg.SerializeToString(&buffer);
+    Protobuf::FHE_Ctxt received;
+    received.ParseFromString(buffer);
+    
+    vector<long> result;
+    ea.decrypt(convert_from_message(received, publicKey), secretKey, result);
+    assert(result == bits);
+    
+    // the context and the public key
+    FHEcontext *context_copy = create_from_message(convert_to_message(context, ZLIB_COMPRESSION));
+    assert(*context_copy == context);
+    FHEPubKey *pk_copy = create_from_pk_message(get_pk_message(publicKey, ZLIB_COMPRESSION), *context_copy);
+    assert(*pk_copy == publicKey);
+    delete pk_copy;
+    delete context_copy;
+    
+    // a message announcing a huge content must be rejected before the allocation
+    Protobuf::FHE_Ctxt bogus = compressed_msg;
+    bogus.set_content_size(1UL << 40);
+    bool rejected = false;
+    try {
+        convert_from_message(bogus, publicKey);
+    } catch (std::runtime_error &e) {
+        rejected = true;
+    }
+    assert(rejected);
+    
+    cout << "FHE compression: " << plain_msg.content().size() << " -> " << compressed_msg.compressed_content().size() << " bytes" << endl;
+}
 
 int main()
 {
     mpz_class v = 50;
     Protobuf::BigInt m = convert_to_message(v);
     assert(v == convert_from_message(m));
-    
+
     gmp_randstate_t randstate;
     gmp_randinit_default(randstate);
     gmp_randseed_ui(randstate,time(NULL));
-    
+
     auto sk = Paillier_priv::keygen(randstate,2048,0);
     Paillier_priv pp(sk,randstate);
 
     Protobuf::Paillier_PK paillier_pk = get_pk_message(&pp);
-    
+
     Paillier *p = create_from_pk_message(paillier_pk,randstate);
     mpz_class  n = (p->pubkey())[0];
     mpz_class pt0;
@@ -24,5 +123,43 @@ int main()
     mpz_class ct0 = p->encrypt(pt0);
     assert(pp.decrypt(ct0) == pt0);
 
+    // the zero values and the short ones must survive the packing
+    vector<mpz_class> mixed = {0, 1, 255, 256, ct0, 0};
+    assert(convert_from_message(convert_to_message(mixed)) == mixed);
+    assert(convert_from_message(convert_to_message(vector<mpz_class>())).empty());
+    vector<mpz_class> zeros(10, 0);
+    assert(convert_from_message(convert_to_message(zeros)) == zeros);
+
+    // inconsistent packed arrays from the peer are rejected
+    Protobuf::BigIntArray bad;
+    bad.set_count(1U << 31);
+    bad.set_width(0);
+    bad.set_packed_data("");
+    bool rejected = false;
+    try {
+        convert_from_message(bad);
+    } catch (std::runtime_error &e) {
+        rejected = true;
+    }
+    assert(rejected);
+
+    // DGK sized answer: Paillier ciphertexts
+    vector<mpz_class> ciphertexts(256);
+    for (size_t i = 0; i < ciphertexts.size(); i++) {
+        ciphertexts[i] = p->encrypt(i);
+    }
+    bench_int_array("Paillier ciphertexts", ciphertexts);
+
+    // a model with small plaintexts
+    vector<mpz_class> small(1024);
+    for (size_t i = 0; i < small.size(); i++) {
+        mpz_urandomb(small[i].get_mpz_t(),randstate,16);
+    }
+    bench_int_array("16 bits values", small);
+
+    test_fhe_compression(randstate);
+
+    delete p;
+
     return 0;
-}
\ No newline at end of file
+}
@@ -24,4 +24,56 @@
 BenchTimer* BenchTimer::shared_instance__ = NULL;
 unsigned long IOBenchmark::byte_count__ = 0;
 unsigned long IOBenchmark::interaction_count__ = 0;
-#endif
\ No newline at end of file
+std::atomic<uint64_t> IOBenchmark::io_wait_usec__(0);
+std::atomic<uint64_t> IOBenchmark::serialization_usec__(0);
+#endif
+
+void Round_timer::start_round()
+{
+    if (!timings_) {
+        return;
+    }
+    
+    current_ = Round_timing();
+    current_.round = round_++;
+    
+    // the I/O counters are cumulative: store their value at the beginning of the round
+#ifdef BENCHMARK
+    current_.io_wait_ms = IOBenchmark::io_wait_time();
+    current_.serialization_ms = IOBenchmark::serialization_time();
+    current_.bytes = IOBenchmark::byte_count();
+    current_.interactions = IOBenchmark::interaction_count();
+#endif
+    t_.lap();
+}
+
+void Round_timer::end_setup(size_t comparisons)
+{
+    if (timings_) {
+        current_.comparisons = comparisons;
+        current_.setup_ms = t_.lap_ms();
+    }
+}
+
+void Round_timer::end_comparison()
+{
+    if (timings_) {
+        current_.comparison_ms = t_.lap_ms();
+    }
+}
+
+void Round_timer::end_round()
+{
+    if (!timings_) {
+        return;
+    }
+    
+    current_.update_ms = t_.lap_ms();
+#ifdef BENCHMARK
+    current_.io_wait_ms = IOBenchmark::io_wait_time() - current_.io_wait_ms;
+    current_.serialization_ms = IOBenchmark::serialization_time() - current_.serialization_ms;
+    current_.bytes = IOBenchmark::byte_count() - current_.bytes;
+    current_.interactions = IOBenchmark::interaction_count() - current_.interactions;
+#endif
+    timings_->push_back(current_);
+}
\ No newline at end of file
@@ -20,10 +20,12 @@
 
 #pragma once
 
-#ifdef BENCHMARK
-
+#include <vector>
 #include <util/util.hh>
 
+#ifdef BENCHMARK
+
+#include <atomic>
 
 
 class BenchTimer : public ResumableTimer {
@@ -80,6 +82,32 @@ public:
     {
         return interaction_count__;
     }
+    
+    // time spent blocked in the socket calls and in the (de)serialization of
+    // the messages, summed over all the threads
+    static void io_wait(uint64_t usec)
+    {
+        io_wait_usec__ += usec;
+    }
+    
+    static double io_wait_time()
+    {
+        return io_wait_usec__/1000.;
+    }
+    
+    static void serialization(uint64_t usec)
+    {
+        serialization_usec__ += usec;
+    }
+    
+    static double serialization_time()
+    {
+        return serialization_usec__/1000.;
+    }
+    
+private:
+    static std::atomic<uint64_t> io_wait_usec__;
+    static std::atomic<uint64_t> serialization_usec__;
 };
 
 #define BENCHMARK_INIT BenchTimer::create();
@@ -91,6 +119,11 @@ public:
 #define RESET_BYTE_COUNT IOBenchmark::reset();
 #define EXCHANGED_BYTES(n) IOBenchmark::exchanged_bytes(n);
 #define INTERACTION IOBenchmark::interaction();
+
+#define START_IO_WAIT Timer io_wait_timer__;
+#define END_IO_WAIT IOBenchmark::io_wait(io_wait_timer__.lap());
+#define START_SERIALIZATION Timer serialization_timer__;
+#define END_SERIALIZATION IOBenchmark::serialization(serialization_timer__.lap());
 #else
 
 #define PAUSE_BENCHMARK
@@ -101,4 +134,47 @@ public:
 #define EXCHANGED_BYTES(n)
 #define INTERACTION
 
-#endif
\ No newline at end of file
+#define START_IO_WAIT
+#define END_IO_WAIT
+#define START_SERIALIZATION
+#define END_SERIALIZATION
+
+#endif
+
+// Times (in ms) of one round of an interactive protocol, seen by one party.
+// setup, comparison and update are wall clock times and include the I/O:
+// io_wait and serialization are the part of the round spent in the socket
+// calls and in the messages encoding. These two, bytes and interactions are
+// only measured when BENCHMARK is set.
+struct Round_timing {
+    size_t round;
+    size_t comparisons;
+    double setup_ms;
+    double comparison_ms;
+    double update_ms;
+    double io_wait_ms;
+    double serialization_ms;
+    unsigned long bytes;
+    unsigned long interactions;
+};
+
+// Records the phases of the rounds of a protocol: a round starts with
+// start_round, and its setup, comparison and update phases end with
+// end_setup (that gives the number of comparisons of the round),
+// end_comparison and end_round.
+// Nothing is recorded if timings is NULL.
+class Round_timer {
+public:
+    Round_timer(std::vector<Round_timing> *timings) : timings_(timings), round_(0) {}
+    
+    void start_round();
+    void end_setup(size_t comparisons);
+    void end_comparison();
+    void end_round();
+    
+protected:
+    std::vector<Round_timing> *timings_;
+    size_t round_;
+    Round_timing current_;
+    Timer t_;
+};
\ No newline at end of file
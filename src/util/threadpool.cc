@@ -0,0 +1,258 @@
+/*
+ * Copyright 2013-2015 Raphael Bost
+ *
+ * This file is part of ciphermed.
+
+ *  ciphermed is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  ciphermed is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
+ *
+ */
+
+#include <util/threadpool.hh>
+
+#include <algorithm>
+#include <exception>
+
+using namespace std;
+
+// pool and index of the worker running on this thread (NULL for the other threads)
+static thread_local ThreadPool *current_pool__ = NULL;
+static thread_local size_t current_worker__ = 0;
+
+ThreadPool::ThreadPool(size_t n_workers)
+: pending_(0), next_queue_(0), done_(false), events_(0), event_waiters_(0)
+{
+    if (n_workers == 0) {
+        n_workers = 1;
+    }
+
+    for (size_t i = 0; i < n_workers; i++) {
+        queues_.push_back(unique_ptr<Task_queue>(new Task_queue()));
+    }
+    for (size_t i = 0; i < n_workers; i++) {
+        workers_.push_back(thread(&ThreadPool::worker_loop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(sleep_mtx_);
+        done_ = true;
+    }
+    sleep_cv_.notify_all();
+
+    for (size_t i = 0; i < workers_.size(); i++) {
+        workers_[i].join();
+    }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool(thread::hardware_concurrency());
+    return pool;
+}
+
+void ThreadPool::push(Task t)
+{
+    // count the task first so that pending_ never goes below the number of queued tasks
+    {
+        lock_guard<mutex> lock(sleep_mtx_);
+        pending_++;
+        events_++;
+        if (event_waiters_ > 0) {
+            event_cv_.notify_all();
+        }
+    }
+
+    if (current_pool__ == this) {
+        // nested task: keep it local, it will be run next
+        Task_queue &q = *queues_[current_worker__];
+        lock_guard<mutex> lock(q.mtx);
+        q.tasks.push_front(move(t));
+    }else{
+        Task_queue &q = *queues_[next_queue_++ % queues_.size()];
+        lock_guard<mutex> lock(q.mtx);
+        q.tasks.push_back(move(t));
+    }
+
+    sleep_cv_.notify_one();
+}
+
+bool ThreadPool::pop(Task &t)
+{
+    size_t n = queues_.size();
+    size_t first = (current_pool__ == this) ? current_worker__ : 0;
+
+    // own queue first, from the front ...
+    {
+        Task_queue &q = *queues_[first];
+        lock_guard<mutex> lock(q.mtx);
+        if (!q.tasks.empty()) {
+            t = move(q.tasks.front());
+            q.tasks.pop_front();
+            pending_--;
+            return true;
+        }
+    }
+
+    // ... then steal from the back of the others
+    for (size_t i = 1; i < n; i++) {
+        Task_queue &q = *queues_[(first + i) % n];
+        lock_guard<mutex> lock(q.mtx);
+        if (!q.tasks.empty()) {
+            t = move(q.tasks.back());
+            q.tasks.pop_back();
+            pending_--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ThreadPool::run_pending_task()
+{
+    Task t;
+    if (!pop(t)) {
+        return false;
+    }
+    t();
+    signal_event();
+    return true;
+}
+
+bool ThreadPool::is_worker() const
+{
+    return current_pool__ == this;
+}
+
+size_t ThreadPool::events()
+{
+    lock_guard<mutex> lock(sleep_mtx_);
+    return events_;
+}
+
+void ThreadPool::wait_event(size_t seen)
+{
+    unique_lock<mutex> lock(sleep_mtx_);
+    event_waiters_++;
+    event_cv_.wait(lock, [this,seen](){ return events_ != seen; });
+    event_waiters_--;
+}
+
+void ThreadPool::signal_event()
+{
+    lock_guard<mutex> lock(sleep_mtx_);
+    events_++;
+    if (event_waiters_ > 0) {
+        event_cv_.notify_all();
+    }
+}
+
+void ThreadPool::worker_loop(size_t index)
+{
+    current_pool__ = this;
+    current_worker__ = index;
+
+    for (;;) {
+        if (run_pending_task()) {
+            continue;
+        }
+
+        unique_lock<mutex> lock(sleep_mtx_);
+        sleep_cv_.wait(lock, [this](){ return done_ || pending_ > 0; });
+
+        if (done_ && pending_ == 0) {
+            return;
+        }
+    }
+}
+
+// shared with the helpers of a parallel_for: a helper can start after the call returned
+struct Parallel_for_state {
+    Parallel_for_state(size_t begin, size_t end, size_t grain, const function<void(size_t)> &f)
+    : next(begin), end(end), grain(grain), f(f), active(0) {}
+
+    atomic<size_t> next;
+    const size_t end;
+    const size_t grain;
+    // only called while the caller waits
+    const function<void(size_t)> &f;
+
+    exception_ptr error;
+    // callers inside the loop, the caller waits until it is back to 0
+    size_t active;
+    mutex mtx;
+    condition_variable cv;
+};
+
+static void parallel_for_body(Parallel_for_state &s)
+{
+    {
+        lock_guard<mutex> lock(s.mtx);
+        s.active++;
+    }
+
+    try {
+        for (size_t i = s.next.fetch_add(s.grain); i < s.end; i = s.next.fetch_add(s.grain)) {
+            size_t i_end = min(i+s.grain, s.end);
+            for (size_t j = i; j < i_end; j++) {
+                s.f(j);
+            }
+        }
+    } catch (...) {
+        lock_guard<mutex> lock(s.mtx);
+        if (!s.error) {
+            s.error = current_exception();
+        }
+        // make the other callers stop
+        s.next = s.end;
+    }
+
+    lock_guard<mutex> lock(s.mtx);
+    s.active--;
+    s.cv.notify_all();
+}
+
+void ThreadPool::parallel_for(size_t begin, size_t end, const function<void(size_t)> &f, unsigned int max_parallelism, size_t grain)
+{
+    if (begin >= end) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+
+    size_t n_chunks = (end - begin + grain - 1)/grain;
+    size_t n_callers = (max_parallelism == 0) ? size()+1 : max_parallelism;
+    n_callers = min(n_callers, n_chunks);
+
+    shared_ptr<Parallel_for_state> state = make_shared<Parallel_for_state>(begin, end, grain, f);
+
+    // the calling thread is one of the callers
+    for (size_t t = 1; t < n_callers; t++) {
+        push([state](){ parallel_for_body(*state); });
+    }
+
+    parallel_for_body(*state);
+
+    // all the indexes are taken: wait for the helpers still running f,
+    // the ones starting later will find nothing to do
+    unique_lock<mutex> lock(state->mtx);
+    state->cv.wait(lock, [&state](){ return state->active == 0; });
+
+    if (state->error) {
+        rethrow_exception(state->error);
+    }
+}
@@ -7,63 +7,130 @@
  *  it under the terms of the GNU General Public License as published by
  *  the Free Software Foundation, either version 3 of the License, or
  *  (at your option) any later version.
- * 
+ *
  *  ciphermed is distributed in the hope that it will be useful,
  *  but WITHOUT ANY WARRANTY; without even the implied warranty of
  *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  *  GNU General Public License for more details.
- * 
+ *
  *  You should have received a copy of the GNU General Public License
  *  along with ciphermed.  If not, see <http://www.gnu.org/licenses/>. 2
  *
  */
 
-#include <boost/thread/thread.hpp>
-#include <boost/asio.hpp>
+#pragma once
 
-// the actual thread pool
-struct ThreadPool {
-    ThreadPool(std::size_t);
-    template<class F>
-    void enqueue(F f);
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+// Work-stealing thread pool.
+// Every worker has its own deque: it runs its tasks from the front and the
+// idle workers steal from the back. Tasks submitted from a worker go to the
+// front of its own deque, the others are spread over the workers.
+// A worker waiting for a task of the pool (wait()) runs pending tasks in the
+// meantime, so nested parallelism does not deadlock. The other threads (the
+// sessions) only block: they never run the tasks of other callers.
+// parallel_for never waits for a helper that has not started: the caller
+// runs the remaining indexes itself.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t n_workers);
     ~ThreadPool();
-    private:
-    // the io_service we are wrapping
-    boost::asio::io_service service;
-//    using asio_worker = std::unique_ptr<boost::asio::io_service::work>;
-    std::unique_ptr<boost::asio::io_service::work> working;
-    // need to keep track of threads so we can join them
-    std::vector<std::unique_ptr<boost::thread>> workers;
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // process-wide pool, with one worker per hardware thread
+    static ThreadPool& shared();
+
+    size_t size() const { return workers_.size(); }
+
+    template<class F>
+    std::future<typename std::result_of<F()>::type> submit(F f);
+
+    // block until the future is ready, running pending tasks in the meantime if called from a worker
+    template<class T>
+    T wait(std::future<T> &f);
+
+    // call f(i) for i in [begin, end) with at most max_parallelism concurrent callers (including the current thread)
+    // the indexes are handed out dynamically, by chunks of grain
+    void parallel_for(size_t begin, size_t end, const std::function<void(size_t)> &f, unsigned int max_parallelism = 0, size_t grain = 1);
+
+    // run one pending task from the calling thread, returns false if there was none
+    bool run_pending_task();
+
+private:
+    typedef std::function<void()> Task;
+
+    struct Task_queue {
+        std::deque<Task> tasks;
+        std::mutex mtx;
+    };
+
+    void push(Task t);
+    bool pop(Task &t);
+    void worker_loop(size_t index);
+
+    bool is_worker() const;
+    // counter of submitted and completed tasks, to sleep until something happens
+    size_t events();
+    void wait_event(size_t seen);
+    void signal_event();
+
+    std::vector<std::unique_ptr<Task_queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::atomic<size_t> pending_;
+    std::atomic<size_t> next_queue_;
+    std::atomic<bool> done_;
+
+    std::mutex sleep_mtx_;
+    std::condition_variable sleep_cv_;
+
+    // protected by sleep_mtx_
+    size_t events_;
+    size_t event_waiters_;
+    std::condition_variable event_cv_;
 };
 
-// the constructor just launches some amount of workers
-ThreadPool::ThreadPool(size_t threads)
-:service()
-,working(new std::unique_ptr<boost::asio::io_service::work>::element_type(service))
+template<class F>
+std::future<typename std::result_of<F()>::type> ThreadPool::submit(F f)
 {
-    for ( std::size_t i = 0; i < threads; ++i ) {
-        workers.push_back(
-                          std::unique_ptr<boost::thread>(
-                                                         new boost::thread([this]
-                                                                           {
-                                                                               service.run();
-                                                                           })
-                                                         )
-                          );
-    }
-}
+    typedef typename std::result_of<F()>::type R;
 
-// add new work item to the pool
-template<class F>
-void ThreadPool::enqueue(F f) {
-    service.post(f);
+    // std::function needs a copyable callable
+    std::shared_ptr<std::packaged_task<R()>> task = std::make_shared<std::packaged_task<R()>>(f);
+    std::future<R> res = task->get_future();
+
+    push([task](){ (*task)(); });
+
+    return res;
 }
 
-// the destructor joins all threads
-ThreadPool::~ThreadPool() {
-    //service.stop();
-    //for ( std::size_t i = 0; i < workers.size(); ++i )
-    //   workers[i]->join();
-    working.reset();
-    service.run();
+template<class T>
+T ThreadPool::wait(std::future<T> &f)
+{
+    if (!is_worker()) {
+        f.wait();
+        return f.get();
+    }
+
+    // the future may depend on a queued task: keep running them
+    for (;;) {
+        size_t seen = events();
+        if (f.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            break;
+        }
+        if (!run_pending_task()) {
+            wait_event(seen);
+        }
+    }
+    return f.get();
 }